@@ -92,6 +92,12 @@
 #include <strings.h>
 #include <time.h>
 #include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <libgen.h>
 #ifdef _AIX
 #include <pthread.h>
 #endif 
@@ -113,6 +119,7 @@
 #include "ruleset.h"
 #include "parserif.h"
 #include "statsobj.h"
+#include "stream.h"
 
 /* AIXPORT : cs renamed to legacy_cs as clashes with libpthreads variable in complete file*/
 #ifdef _AIX
@@ -136,6 +143,7 @@ DEFobjCurrIf(datetime)
 DEFobjCurrIf(module)
 DEFobjCurrIf(statsobj)
 DEFobjCurrIf(ruleset)
+DEFobjCurrIf(strm)
 
 
 typedef struct configSettings_s {
@@ -202,6 +210,10 @@ static struct cnfparamdescr cnfparamdescr[] = {
 	{ "action.reportsuspension", eCmdHdlrBinary, 0 },
 	{ "action.reportsuspensioncontinuation", eCmdHdlrBinary, 0 },
 	{ "action.resumeinterval", eCmdHdlrInt, 0 },
+	{ "action.resumeasync", eCmdHdlrBinary, 0 },
+	{ "action.perfstats", eCmdHdlrBinary, 0 },
+	{ "action.errorfile", eCmdHdlrGetWord, 0 },
+	{ "action.errorfile.maxsize", eCmdHdlrSize, 0 },
 	{ "action.copymsg", eCmdHdlrBinary, 0 }
 };
 static struct cnfparamblk pblk =
@@ -211,6 +223,22 @@ static struct cnfparamblk pblk =
 	};
 
 
+/* support for action.perfStats: batch size distribution buckets. Each
+ * bucket counts the batches with up to maxSize messages (and more than the
+ * maxSize of the previous bucket).
+ */
+static const struct {
+	const char *name;
+	unsigned maxSize;
+} perfBatchBuckets[ACTION_PERF_NBR_BATCHBUCKETS] = {
+	{ "perf.batchsize.le1", 1 },
+	{ "perf.batchsize.le16", 16 },
+	{ "perf.batchsize.le128", 128 },
+	{ "perf.batchsize.le1024", 1024 },
+	{ "perf.batchsize.gt1024", UINT_MAX }
+};
+
+
 /* primarily a helper for debug purposes, get human-readble name of state */
 /* currently not needed, but may be useful in the future!
 static const char *
@@ -273,6 +301,42 @@ getActNow(action_t * const pThis)
 }
 
 
+/* get a timestamp in microseconds for action.perfStats. Only differences
+ * of these values are meaningful. If possible, we use a monotonic clock so
+ * that clock adjustments do not show up as action processing time.
+ */
+static uint64_t
+actionPerfNow(void)
+{
+#	if _POSIX_TIMERS > 0 && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#	else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+#	endif
+}
+
+/* add the time passed since tStart to a perf counter */
+#define PERF_ADD_ELAPSED(pAction, ctr, mut, tStart) do { \
+	if((pAction)->bPerfStats) { \
+		STATSCOUNTER_ADD((pAction)->ctr, (pAction)->mut, actionPerfNow() - (tStart)); \
+	} \
+} while(0)
+
+static void
+actionPerfCountBatch(action_t *const pThis, const unsigned nMsgs)
+{
+	int i;
+
+	for(i = 0 ; nMsgs > perfBatchBuckets[i].maxSize ; ++i)
+		/* just search */;
+	STATSCOUNTER_INC(pThis->ctrPerfBatch[i], pThis->mutCtrPerfBatch);
+}
+
+
 /* resets action queue parameters to their default values. This happens
  * after each action has been created in order to prevent any wild defaults
  * to be used. It is somewhat against the original spirit of the config file
@@ -341,8 +405,13 @@ rsRetVal actionDestruct(action_t * const pThis)
 	if(pThis->pModData != NULL)
 		pThis->pMod->freeInstance(pThis->pModData);
 
+	if(pThis->pErrFile != NULL)
+		strm.Destruct(&pThis->pErrFile);
+	free(pThis->pszErrFile);
+
 	pthread_mutex_destroy(&pThis->mutAction);
 	pthread_mutex_destroy(&pThis->mutWrkrDataTable);
+	pthread_mutex_destroy(&pThis->mutErrFile);
 	d_free(pThis->pszName);
 	d_free(pThis->ppTpl);
 	d_free(pThis->peParamPassing);
@@ -382,6 +451,10 @@ rsRetVal actionConstruct(action_t **ppThis)
 	CHKmalloc(pThis = (action_t*) calloc(1, sizeof(action_t)));
 	pThis->iResumeInterval = 30;
 	pThis->iResumeRetryCount = 0;
+	pThis->bResumeAsync = 0;
+	pThis->bPerfStats = 0;
+	pThis->pszErrFile = NULL;
+	pThis->errFileMaxSize = 0;
 	pThis->pszName = NULL;
 	pThis->bWriteAllMarkMsgs = 1;
 	pThis->iExecEveryNthOccur = 0;
@@ -398,6 +471,7 @@ rsRetVal actionConstruct(action_t **ppThis)
 	pThis->iActionNbr = iActionNbr;
 	pthread_mutex_init(&pThis->mutAction, NULL);
 	pthread_mutex_init(&pThis->mutWrkrDataTable, NULL);
+	pthread_mutex_init(&pThis->mutErrFile, NULL);
 	INIT_ATOMIC_HELPER_MUT(pThis->mutCAS);
 
 	/* indicate we have a new action */
@@ -444,6 +518,16 @@ actionConstructFinalize(action_t *__restrict__ const pThis, struct nvlst *lst)
 
 			}
 		}
+		/* a parked transactional action would need to hand back its whole
+		 * batch, which then goes to the end of the queue. That breaks
+		 * message order and duplicates already committed messages.
+		 */
+		if(pThis->bResumeAsync) {
+			LogError(0, RS_RET_CONF_PARAM_INVLD, "action '%s': action.resumeAsync "
+				"is not supported for transactional actions - using regular "
+				"(blocking) resume retries", pThis->pszName);
+			pThis->bResumeAsync = 0;
+		}
 	}
 
 
@@ -471,6 +555,30 @@ actionConstructFinalize(action_t *__restrict__ const pThis, struct nvlst *lst)
 	CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("resumed"),
 		ctrType_IntCtr, CTR_FLAG_RESETTABLE, &pThis->ctrResume));
 
+	if(pThis->bPerfStats) {
+		STATSCOUNTER_INIT(pThis->ctrPerfRender, pThis->mutCtrPerfRender);
+		CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("perf.render.us"),
+			ctrType_IntCtr, CTR_FLAG_RESETTABLE, &pThis->ctrPerfRender));
+		STATSCOUNTER_INIT(pThis->ctrPerfExec, pThis->mutCtrPerfExec);
+		CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("perf.exec.us"),
+			ctrType_IntCtr, CTR_FLAG_RESETTABLE, &pThis->ctrPerfExec));
+		STATSCOUNTER_INIT(pThis->ctrPerfRetry, pThis->mutCtrPerfRetry);
+		CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("perf.retry.us"),
+			ctrType_IntCtr, CTR_FLAG_RESETTABLE, &pThis->ctrPerfRetry));
+		INIT_ATOMIC_HELPER_MUT64(pThis->mutCtrPerfBatch);
+		for(int i = 0 ; i < ACTION_PERF_NBR_BATCHBUCKETS ; ++i) {
+			pThis->ctrPerfBatch[i] = 0;
+			CHKiRet(statsobj.AddCounter(pThis->statsobj, (uchar*) perfBatchBuckets[i].name,
+				ctrType_IntCtr, CTR_FLAG_RESETTABLE, &pThis->ctrPerfBatch[i]));
+		}
+	}
+
+	if(pThis->pszErrFile != NULL) {
+		STATSCOUNTER_INIT(pThis->ctrErrFile, pThis->mutCtrErrFile);
+		CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("errorfile.written"),
+			ctrType_IntCtr, CTR_FLAG_RESETTABLE, &pThis->ctrErrFile));
+	}
+
 	CHKiRet(statsobj.ConstructFinalize(pThis->statsobj));
 
 	/* create our queue */
@@ -721,6 +829,8 @@ actionSuspend(action_t * const pThis, wti_t * const pWti)
 	datetime.GetTime(&ttNow);
 	suspendDuration = pThis->iResumeInterval * (getActionNbrResRtry(pWti, pThis) / 10 + 1);
 	pThis->ttResumeRtry = ttNow + suspendDuration;
+	setActionParked(pWti, pThis, 0);
+	pWti->actWrkrInfo[pThis->iActionNbr].iNbrParkedRtry = 0;
 	actionSetState(pThis, pWti, ACT_STATE_SUSP);
 	pThis->ctrSuspendDuration += suspendDuration;
 	if(getActionNbrResRtry(pWti, pThis) == 0) {
@@ -744,6 +854,42 @@ actionSuspend(action_t * const pThis, wti_t * const pWti)
 }
 
 
+/* Park the action until its next resume retry is due. This is done instead of
+ * sleeping inside actionDoRetry() if action.resumeAsync is set. The worker
+ * returns immediately and the messages it was processing stay in the action
+ * queue, which is put on hold until ttResumeRtry (see processBatchMain()).
+ * The queue's hold timer then wakes a worker, which does the next resume
+ * attempt. Note that parking counts as a regular retry, so
+ * action.resumeRetryCount is honored just like in blocking mode.
+ */
+static void
+actionPark(action_t * const pThis, wti_t * const pWti)
+{
+	time_t ttNow;
+
+	datetime.GetTime(&ttNow);
+	pThis->ttResumeRtry = ttNow + pThis->iResumeInterval;
+	setActionParked(pWti, pThis, 1);
+	actionSetState(pThis, pWti, ACT_STATE_SUSP);
+	DBGPRINTF("action '%s' parked, next resume retry=%lld (now %lld), retry %d\n",
+		  pThis->pszName, (long long) pThis->ttResumeRtry, (long long) ttNow,
+		  pWti->actWrkrInfo[pThis->iActionNbr].iNbrParkedRtry);
+}
+
+
+/* check if the action could not take the current message because it is
+ * parked (or about to be parked) for an asynchronous resume. In that case,
+ * the message must be kept in the queue.
+ */
+static inline int
+actionIsParked(action_t *__restrict__ const pThis, wti_t *__restrict__ const pWti)
+{
+	return pThis->bResumeAsync
+	       && (getActionState(pWti, pThis) == ACT_STATE_RTRY
+		   || (getActionState(pWti, pThis) == ACT_STATE_SUSP && getActionParked(pWti, pThis)));
+}
+
+
 /* actually do retry processing. Note that the function receives a timestamp so
  * that we do not need to call the (expensive) time() API.
  * Note that we do the full retry processing here, doing the configured number of
@@ -765,11 +911,13 @@ actionDoRetry(action_t * const pThis, wti_t * const pWti)
 	int iRetries;
 	int iSleepPeriod;
 	int bTreatOKasSusp;
+	const uint64_t tStart = pThis->bPerfStats ? actionPerfNow() : 0;
 	DEFiRet;
 
 	ASSERT(pThis != NULL);
 
-	iRetries = 0;
+	/* in async mode, retries are spread over multiple calls */
+	iRetries = pThis->bResumeAsync ? pWti->actWrkrInfo[pThis->iActionNbr].iNbrParkedRtry : 0;
 	while((*pWti->pbShutdownImmediate == 0) && getActionState(pWti, pThis) == ACT_STATE_RTRY) {
 		DBGPRINTF("actionDoRetry: %s enter loop, iRetries=%d, ResumeInRow %d\n",
 			pThis->pszName, iRetries, getActionResumeInRow(pWti, pThis));
@@ -800,6 +948,9 @@ actionDoRetry(action_t * const pThis, wti_t * const pWti)
 				actionSuspend(pThis, pWti);
 				if(getActionNbrResRtry(pWti, pThis) < 20)
 					incActionNbrResRtry(pWti, pThis);
+			} else if(pThis->bResumeAsync) {
+				pWti->actWrkrInfo[pThis->iActionNbr].iNbrParkedRtry = ++iRetries;
+				actionPark(pThis, pWti);
 			} else {
 				++iRetries;
 				iSleepPeriod = pThis->iResumeInterval;
@@ -815,9 +966,12 @@ actionDoRetry(action_t * const pThis, wti_t * const pWti)
 
 	if(getActionState(pWti, pThis) == ACT_STATE_RDY) {
 		setActionNbrResRtry(pWti, pThis, 0);
+		setActionParked(pWti, pThis, 0);
+		pWti->actWrkrInfo[pThis->iActionNbr].iNbrParkedRtry = 0;
 	}
 
 finalize_it:
+	PERF_ADD_ELAPSED(pThis, ctrPerfRetry, mutCtrPerfRetry, tStart);
 	RETiRet;
 }
 
@@ -1117,8 +1271,10 @@ actionCallDoAction(action_t *__restrict__ const pThis,
 		param[i] = actParam(iparams, pThis->iNumTpls, 0, i).param;
 	}
 
+	const uint64_t tStart = pThis->bPerfStats ? actionPerfNow() : 0;
 	iRet = pThis->pMod->mod.om.doAction(param,
 				            pWti->actWrkrInfo[pThis->iActionNbr].actWrkrData);
+	PERF_ADD_ELAPSED(pThis, ctrPerfExec, mutCtrPerfExec, tStart);
 	iRet = handleActionExecResult(pThis, pWti, iRet);
 	RETiRet;
 }
@@ -1135,9 +1291,11 @@ actionCallCommitTransaction(action_t * const pThis,
 	DBGPRINTF("entering actionCallCommitTransaction[%s], state: %s, nMsgs %u\n",
 		  pThis->pszName, getActStateName(pThis, pWti), nparams);
 
+	const uint64_t tStart = pThis->bPerfStats ? actionPerfNow() : 0;
 	iRet = pThis->pMod->mod.om.commitTransaction(
 		    pWti->actWrkrInfo[pThis->iActionNbr].actWrkrData,
 		    iparams, nparams);
+	PERF_ADD_ELAPSED(pThis, ctrPerfExec, mutCtrPerfExec, tStart);
 	DBGPRINTF("actionCallCommitTransaction[%s] state: %s "
 		"mod commitTransaction returned %d\n",
 		pThis->pszName, getActStateName(pThis, pWti), iRet);
@@ -1216,7 +1374,9 @@ actionTryCommit(action_t *__restrict__ const pThis, wti_t *__restrict__ const pW
 	CHKiRet(doTransaction(pThis, pWti, iparams, nparams));
 
 	if(getActionState(pWti, pThis) == ACT_STATE_ITX) {
+		const uint64_t tStart = pThis->bPerfStats ? actionPerfNow() : 0;
 		iRet = pThis->pMod->mod.om.endTransaction(pWti->actWrkrInfo[pThis->iActionNbr].actWrkrData);
+		PERF_ADD_ELAPSED(pThis, ctrPerfExec, mutCtrPerfExec, tStart);
 		switch(iRet) {
 			case RS_RET_OK:
 				actionCommitted(pThis, pWti);
@@ -1251,48 +1411,242 @@ finalize_it:
 	RETiRet;
 }
 
-/* If a transcation failed, we write the error file (if configured).
- * TODO: implement
+/* open the error file stream (if not already open). The stream uses the
+ * async writer, so the action workers only copy records into its buffer and
+ * never wait for the disk. Rotation is done by the stream itself. Must be
+ * called with mutErrFile locked.
+ */
+static rsRetVal
+actionOpenErrorFile(action_t *__restrict__ const pThis)
+{
+	uchar szNameBuf[MAXFNAME+1];
+	uchar szDirName[MAXFNAME+1];
+	uchar szBaseName[MAXFNAME+1];
+	DEFiRet;
+
+	if(pThis->pErrFile != NULL)
+		FINALIZE;
+
+	/* dirname() and basename() modify their argument, so work on copies */
+	ustrncpy(szNameBuf, pThis->pszErrFile, MAXFNAME);
+	szNameBuf[MAXFNAME] = '\0';
+	ustrncpy(szDirName, (uchar*)dirname((char*)szNameBuf), MAXFNAME);
+	szDirName[MAXFNAME] = '\0';
+	ustrncpy(szNameBuf, pThis->pszErrFile, MAXFNAME);
+	szNameBuf[MAXFNAME] = '\0';
+	ustrncpy(szBaseName, (uchar*)basename((char*)szNameBuf), MAXFNAME);
+	szBaseName[MAXFNAME] = '\0';
+
+	CHKiRet(strm.Construct(&pThis->pErrFile));
+	CHKiRet(strm.SetFName(pThis->pErrFile, szBaseName, ustrlen(szBaseName)));
+	CHKiRet(strm.SetDir(pThis->pErrFile, szDirName, ustrlen(szDirName)));
+	CHKiRet(strm.SettOperationsMode(pThis->pErrFile, STREAMMODE_WRITE_APPEND));
+	CHKiRet(strm.SettOpenMode(pThis->pErrFile, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP));
+	CHKiRet(strm.SetsType(pThis->pErrFile, STREAMTYPE_FILE_SINGLE));
+	/* keep the previous generation only */
+	CHKiRet(strm.SetiRotateSize(pThis->pErrFile, pThis->errFileMaxSize));
+	CHKiRet(strm.SetiRotateMaxFiles(pThis->pErrFile, 1));
+	CHKiRet(strm.SetiFlushInterval(pThis->pErrFile, 1));
+	CHKiRet(strm.ConstructFinalize(pThis->pErrFile));
+
+finalize_it:
+	if(iRet != RS_RET_OK) {
+		LogError(0, iRet, "action '%s': error opening error file %s",
+			pThis->pszName, pThis->pszErrFile);
+		if(pThis->pErrFile != NULL)
+			strm.Destruct(&pThis->pErrFile);
+	}
+	RETiRet;
+}
+
+
+/* Write messages that failed permanently to the error file (if configured).
+ * Each message becomes one JSON record with the action name, the failure
+ * status, the time of failure and the rendered template string(s), so that
+ * records can later be replayed. All records are rendered first and then
+ * handed to the error file stream in one go. If status is NULL, dfltStatus
+ * applies to all messages.
  */
 static void
-actionWriteErrorFile(action_t *__restrict__ const pThis, wti_t *__restrict__ const pWti)
+actionWriteErrorFile(action_t *__restrict__ const pThis, actWrkrIParams_t *const iparams,
+	const rsRetVal *const status, const unsigned nMsgs, const rsRetVal dfltStatus)
 {
+	cstr_t *pBuf = NULL;
+	struct json_object *json = NULL;
+	struct json_object *jparams;
+	char timeBuf[32];
+	struct tm tm;
+	time_t ttNow;
+	rsRetVal localRet;
 	unsigned i;
-	actWrkrInfo_t *const wrkrInfo = &(pWti->actWrkrInfo[pThis->iActionNbr]);
-	const unsigned nMsgs = wrkrInfo->p.tx.currIParam;
+	int j;
+	DEFiRet;
+
+	if(pThis->pszErrFile == NULL) {
+		DBGPRINTF("action '%s': %u messages failed permanently, no error file configured\n",
+			pThis->pszName, nMsgs);
+		FINALIZE;
+	}
+
+	datetime.GetTime(&ttNow);
+	gmtime_r(&ttNow, &tm);
+	strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%dT%H:%M:%SZ", &tm);
 
-	DBGPRINTF("action %d commit failed, writing %u messages to error file\n",
-		pThis->iActionNbr, nMsgs);
+	CHKiRet(cstrConstruct(&pBuf));
 	for(i = 0 ; i < nMsgs ; ++i) {
-		// TODO: get actual param count!
-		dbgprintf("msg %d: '%s'\n", i,
-			actParam(wrkrInfo->p.tx.iparams, 1, i, 0).param);
+		CHKmalloc(json = json_object_new_object());
+		json_object_object_add(json, "action", json_object_new_string((char*) pThis->pszName));
+		json_object_object_add(json, "status",
+			json_object_new_int((status == NULL) ? dfltStatus : status[i]));
+		json_object_object_add(json, "time", json_object_new_string(timeBuf));
+		json_object_object_add(json, "message", json_object_new_string_len(
+			(char*) actParam(iparams, pThis->iNumTpls, i, 0).param,
+			actParam(iparams, pThis->iNumTpls, i, 0).lenStr));
+		if(pThis->iNumTpls > 1) {
+			CHKmalloc(jparams = json_object_new_array());
+			json_object_object_add(json, "params", jparams);
+			for(j = 0 ; j < pThis->iNumTpls ; ++j) {
+				json_object_array_add(jparams, json_object_new_string_len(
+					(char*) actParam(iparams, pThis->iNumTpls, i, j).param,
+					actParam(iparams, pThis->iNumTpls, i, j).lenStr));
+			}
+		}
+		CHKiRet(rsCStrAppendStr(pBuf,
+			(uchar*) json_object_to_json_string_ext(json, JSON_C_TO_STRING_PLAIN)));
+		CHKiRet(cstrAppendChar(pBuf, '\n'));
+		json_object_put(json);
+		json = NULL;
+	}
+	cstrFinalize(pBuf);
+
+	/* the mutex only guards the stream pointer against HUP; the actual
+	 * disk write is done by the stream's async writer.
+	 */
+	pthread_mutex_lock(&pThis->mutErrFile);
+	if(actionOpenErrorFile(pThis) == RS_RET_OK) {
+		/* we do not do real error-handling on the err file, as this finally
+		 * complicates things way to much.
+		 */
+		localRet = strm.Write(pThis->pErrFile, cstrGetSzStrNoNULL(pBuf), cstrLen(pBuf));
+		if(localRet == RS_RET_OK) {
+			STATSCOUNTER_ADD(pThis->ctrErrFile, pThis->mutCtrErrFile, nMsgs);
+		} else {
+			LogError(0, localRet, "action '%s': error writing error file %s",
+				pThis->pszName, pThis->pszErrFile);
+		}
+	}
+	pthread_mutex_unlock(&pThis->mutErrFile);
+
+finalize_it:
+	if(iRet != RS_RET_OK) {
+		LogError(0, iRet, "action '%s': could not render %u failed messages for error file",
+			pThis->pszName, nMsgs);
+	}
+	if(json != NULL)
+		json_object_put(json);
+	if(pBuf != NULL)
+		rsCStrDestruct(&pBuf);
+}
+
+
+/* messages sorted out while isolating the failed messages of a batch */
+typedef struct {
+	actWrkrIParams_t *retry;	/* temporary failure, to be retried */
+	unsigned nRetry;
+	actWrkrIParams_t *dead;		/* permanent failure, for the error file (NULL: not needed) */
+	rsRetVal *deadStatus;
+	unsigned nDead;
+} actFailedMsgs_t;
+
+/* Isolate the messages of a failed (sub-)batch. The batch is split into
+ * halves which are committed on their own; halves that fail again are split
+ * further until we reach single messages. That way, k bad messages in a batch
+ * of n are found with O(k log n) commits, while good parts of the batch are
+ * still committed in bulk. Only hard errors (e.g. RS_RET_DATAFAIL) are
+ * bisected; those messages are discarded after being recorded for the error
+ * file. A (sub-)batch that failed with a temporary error is kept as a whole
+ * for regular retry processing, as splitting it would only mean more commit
+ * attempts against a destination that is down.
+ */
+static void
+actionBisectFailedBatch(action_t *__restrict__ const pThis, wti_t *__restrict__ const pWti,
+	actWrkrIParams_t *const iparams, const unsigned nMsgs, const rsRetVal failRet,
+	actFailedMsgs_t *const failed)
+{
+	const unsigned nLeft = nMsgs / 2;
+	actWrkrIParams_t *half;
+	unsigned nHalf;
+	rsRetVal ret;
+
+	if(failRet == RS_RET_SUSPENDED) {
+		memcpy(&actParam(failed->retry, pThis->iNumTpls, failed->nRetry, 0), iparams,
+			sizeof(actWrkrIParams_t) * pThis->iNumTpls * nMsgs);
+		failed->nRetry += nMsgs;
+		return;
+	}
+
+	if(nMsgs == 1) {
+		if(failed->dead != NULL) {
+			memcpy(&actParam(failed->dead, pThis->iNumTpls, failed->nDead, 0), iparams,
+				sizeof(actWrkrIParams_t) * pThis->iNumTpls);
+			failed->deadStatus[failed->nDead++] = failRet;
+		}
+		return;
+	}
+
+	for(int i = 0 ; i < 2 ; ++i) {
+		half = (i == 0) ? iparams : &actParam(iparams, pThis->iNumTpls, nLeft, 0);
+		nHalf = (i == 0) ? nLeft : nMsgs - nLeft;
+		setActionResumeInRow(pWti, pThis, 0); // make sure we do not trigger OK-as-SUSPEND handling
+		ret = actionTryCommit(pThis, pWti, half, nHalf);
+		DBGPRINTF("action[%s]: bisecting failed batch, sub-batch of %u msgs returned %d\n",
+			pThis->pszName, nHalf, ret);
+		if(ret == RS_RET_SUSPENDED) {
+			/* destination is down, do not try the remaining half either */
+			actionBisectFailedBatch(pThis, pWti, half, (i == 0) ? nMsgs : nHalf, ret, failed);
+			break;
+		} else if(ret != RS_RET_OK) {
+			actionBisectFailedBatch(pThis, pWti, half, nHalf, ret, failed);
+		}
 	}
 }
 
 
 static rsRetVal
 actionTryRemoveHardErrorsFromBatch(action_t *__restrict__ const pThis, wti_t *__restrict__ const pWti,
-	actWrkrIParams_t *const new_iparams, unsigned *new_nMsgs)
+	const rsRetVal failRet, actWrkrIParams_t *const new_iparams, unsigned *new_nMsgs)
 {
 	actWrkrInfo_t *const wrkrInfo = &(pWti->actWrkrInfo[pThis->iActionNbr]);
 	const unsigned nMsgs = wrkrInfo->p.tx.currIParam;
-	actWrkrIParams_t oneParamSet[CONF_OMOD_NUMSTRINGS_MAXSIZE];
-	rsRetVal ret;
+	actFailedMsgs_t failed;
 	DEFiRet;
 
-	*new_nMsgs = 0;
-	for(unsigned i = 0 ; i < nMsgs ; ++i) {
-		setActionResumeInRow(pWti, pThis, 0); // make sure we do not trigger OK-as-SUSPEND handling
-		memcpy(&oneParamSet, &actParam(wrkrInfo->p.tx.iparams, pThis->iNumTpls, i, 0),
-			sizeof(actWrkrIParams_t) * pThis->iNumTpls);
-		ret = actionTryCommit(pThis, pWti, oneParamSet, 1);
-		if(ret == RS_RET_SUSPENDED) {
-			memcpy(new_iparams + *new_nMsgs, &oneParamSet,
-				sizeof(actWrkrIParams_t) * pThis->iNumTpls);
-			++(*new_nMsgs);
-		}
+	failed.retry = new_iparams;
+	failed.nRetry = 0;
+	failed.dead = NULL;
+	failed.deadStatus = NULL;
+	failed.nDead = 0;
+	if(pThis->pszErrFile != NULL) {
+		CHKmalloc(failed.dead = malloc(sizeof(actWrkrIParams_t) * pThis->iNumTpls * nMsgs));
+		CHKmalloc(failed.deadStatus = malloc(sizeof(rsRetVal) * nMsgs));
 	}
+
+	actionBisectFailedBatch(pThis, pWti, wrkrInfo->p.tx.iparams, nMsgs, failRet, &failed);
+	if(failed.nDead > 0)
+		actionWriteErrorFile(pThis, failed.dead, failed.deadStatus, failed.nDead, RS_RET_OK);
+
+finalize_it:
+	if(iRet == RS_RET_OK) {
+		*new_nMsgs = failed.nRetry;
+	} else {
+		/* we could not even bisect - keep the whole batch for regular retry
+		 * processing instead of silently dropping it.
+		 */
+		memcpy(new_iparams, wrkrInfo->p.tx.iparams, sizeof(actWrkrIParams_t) * pThis->iNumTpls * nMsgs);
+		*new_nMsgs = nMsgs;
+	}
+	free(failed.dead);
+	free(failed.deadStatus);
 	RETiRet;
 }
 
@@ -1319,14 +1673,9 @@ actionCommit(action_t *__restrict__ const pThis, wti_t *__restrict__ const pWti)
 		FINALIZE;
 	}
 	DBGPRINTF("actionCommit[%s]: processing...\n", pThis->pszName);
+	if(pThis->bPerfStats)
+		actionPerfCountBatch(pThis, wrkrInfo->p.tx.currIParam);
 
-/* even more TODO:
-	This is the place where retry processing needs to go in. If the action
-	permanently fails, we should - as a new feature - add the capability to
-	write an error file. This is already done be omelasticsearch, and IMHO
-	pretty useful.
-	rgerhards, 2013-11-04
- */
  	/* we now do one try at commiting the whole batch. Usually, this will
 	 * succeed. If so, we are happy and done. If not, we dig into the details
 	 * of finding out if we have a non-temporary error and try to handle this
@@ -1348,16 +1697,17 @@ actionCommit(action_t *__restrict__ const pThis, wti_t *__restrict__ const pWti)
 		iparams = wrkrInfo->p.tx.iparams;
 		nMsgs = wrkrInfo->p.tx.currIParam;
 		if(iRet == RS_RET_DATAFAIL) {
+			actionWriteErrorFile(pThis, iparams, NULL, nMsgs, iRet);
 			FINALIZE;
 		}
 	} else {
 		DBGPRINTF("actionCommit[%s]: somewhat unhappy, full batch of %d msgs returned "
-			"status %d. Trying messages as individual actions.\n",
+			"status %d. Bisecting batch to isolate failing messages.\n",
 			pThis->pszName, wrkrInfo->p.tx.currIParam, iRet);
 		CHKmalloc(iparams = malloc(sizeof(actWrkrIParams_t) * pThis->iNumTpls
 			* wrkrInfo->p.tx.currIParam));
 		needfree_iparams = 1;
-		actionTryRemoveHardErrorsFromBatch(pThis, pWti, iparams, &nMsgs);
+		actionTryRemoveHardErrorsFromBatch(pThis, pWti, iRet, iparams, &nMsgs);
 	}
 
 	if(nMsgs == 0) {
@@ -1383,7 +1733,9 @@ actionCommit(action_t *__restrict__ const pThis, wti_t *__restrict__ const pWti)
 			if(iRet == RS_RET_FORCE_TERM) {
 				ABORT_FINALIZE(RS_RET_FORCE_TERM);
 			} else if(iRet != RS_RET_OK) {
-				actionWriteErrorFile(pThis, pWti);
+				/* a parked action keeps its messages in the queue */
+				if(!actionIsParked(pThis, pWti))
+					actionWriteErrorFile(pThis, iparams, NULL, nMsgs, iRet);
 				bDone = 1;
 			}
 			continue;
@@ -1438,7 +1790,14 @@ processMsgMain(action_t *__restrict__ const pAction,
 {
 	DEFiRet;
 
-	CHKiRet(prepareDoActionParams(pAction, pWti, pMsg, ttNow));
+	if(pAction->bPerfStats) {
+		const uint64_t tStart = actionPerfNow();
+		iRet = prepareDoActionParams(pAction, pWti, pMsg, ttNow);
+		PERF_ADD_ELAPSED(pAction, ctrPerfRender, mutCtrPerfRender, tStart);
+		CHKiRet(iRet);
+	} else {
+		CHKiRet(prepareDoActionParams(pAction, pWti, pMsg, ttNow));
+	}
 
 	if(pAction->isTransactional) {
 		pWti->actWrkrInfo[pAction->iActionNbr].pAction = pAction;
@@ -1451,6 +1810,12 @@ processMsgMain(action_t *__restrict__ const pAction,
 	iRet = actionProcessMessage(pAction,
 				    pWti->actWrkrInfo[pAction->iActionNbr].p.nontx.actParams,
 				    pWti);
+	if(iRet == RS_RET_DATAFAIL && pAction->pszErrFile != NULL
+	   && !pAction->bUsesMsgPassingMode && !pAction->bNeedReleaseBatch) {
+		/* only string parameters can be written to the error file */
+		actionWriteErrorFile(pAction, pWti->actWrkrInfo[pAction->iActionNbr].p.nontx.actParams,
+			NULL, 1, iRet);
+	}
 	if(pAction->bNeedReleaseBatch)
 		releaseDoActionParams(pAction, pWti, 0);
 finalize_it:
@@ -1470,6 +1835,7 @@ processBatchMain(void *__restrict__ const pVoid,
 {
 	action_t *__restrict__ const pAction = (action_t*__restrict__ const) pVoid;
 	int i;
+	unsigned nProcessed = 0;
 	struct syslogTime ttNow;
 	DEFiRet;
 
@@ -1483,11 +1849,27 @@ processBatchMain(void *__restrict__ const pVoid,
 			 * more harmful than continuing.
 			 */
 			processMsgMain(pAction, pWti, pBatch->pElem[i].pMsg, &ttNow);
+			if(actionIsParked(pAction, pWti))
+				break; /* this and all remaining messages stay in the queue */
 			batchSetElemState(pBatch, i, BATCH_STATE_COMM);
+			++nProcessed;
 		}
 	}
+	/* transactional actions count their batches on commit */
+	if(pAction->bPerfStats && !pAction->isTransactional && nProcessed > 0)
+		actionPerfCountBatch(pAction, nProcessed);
 
 	iRet = actionCommit(pAction, pWti);
+
+	/* if the action was parked, we hand the unprocessed messages back to the
+	 * queue (they are re-enqueued when the batch is deleted) and put the queue
+	 * on hold until the next resume retry is due. That way no worker needs to
+	 * sleep. Transactional actions are never parked, see actionConstructFinalize().
+	 */
+	if(actionIsParked(pAction, pWti) && pAction->pQueue->qType != QUEUETYPE_DIRECT
+	   && getActionState(pWti, pAction) == ACT_STATE_SUSP) {
+		qqueueSetDeqHold((qqueue_t*) pWti->pWtp->pUsr, pAction->ttResumeRtry);
+	}
 	RETiRet;
 }
 
@@ -1524,6 +1906,14 @@ actionCallHUPHdlr(action_t * const pAction)
 	DBGPRINTF("Action %p checks HUP hdlr, act level: %p, wrkr level %p\n",
 		pAction, pAction->pMod->doHUP, pAction->pMod->doHUPWrkr);
 
+	if(pAction->pszErrFile != NULL) {
+		/* permit external rotation of the error file; it is reopened on next use */
+		pthread_mutex_lock(&pAction->mutErrFile);
+		if(pAction->pErrFile != NULL)
+			strm.Destruct(&pAction->pErrFile);
+		pthread_mutex_unlock(&pAction->mutErrFile);
+	}
+
 	if(pAction->pMod->doHUP != NULL) {
 		CHKiRet(pAction->pMod->doHUP(pAction->pModData));
 	}
@@ -1858,6 +2248,14 @@ actionApplyCnfParam(action_t * const pAction, struct cnfparamvals * const pvals)
 			pAction->bCopyMsg = (int) pvals[i].val.d.n;
 		} else if(!strcmp(pblk.descr[i].name, "action.resumeinterval")) {
 			pAction->iResumeInterval = pvals[i].val.d.n;
+		} else if(!strcmp(pblk.descr[i].name, "action.resumeasync")) {
+			pAction->bResumeAsync = (sbool) pvals[i].val.d.n;
+		} else if(!strcmp(pblk.descr[i].name, "action.perfstats")) {
+			pAction->bPerfStats = (sbool) pvals[i].val.d.n;
+		} else if(!strcmp(pblk.descr[i].name, "action.errorfile")) {
+			pAction->pszErrFile = (uchar*) es_str2cstr(pvals[i].val.d.estr, NULL);
+		} else if(!strcmp(pblk.descr[i].name, "action.errorfile.maxsize")) {
+			pAction->errFileMaxSize = pvals[i].val.d.n;
 		} else {
 			dbgprintf("action: program error, non-handled "
 			  "param '%s'\n", pblk.descr[i].name);
@@ -2074,6 +2472,7 @@ rsRetVal actionClassInit(void)
 	CHKiRet(objUse(module, CORE_COMPONENT));
 	CHKiRet(objUse(statsobj, CORE_COMPONENT));
 	CHKiRet(objUse(ruleset, CORE_COMPONENT));
+	CHKiRet(objUse(strm, CORE_COMPONENT));
 
 	CHKiRet(regCfSysLineHdlr((uchar *)"actionname", 0, eCmdHdlrGetWord, NULL, &cs.pszActionName, NULL));
 	CHKiRet(regCfSysLineHdlr((uchar *)"actionqueuefilename", 0, eCmdHdlrGetWord, NULL,
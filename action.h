@@ -34,6 +34,9 @@ extern int bActionReportSuspension;
 extern int bActionReportSuspensionCont;
 
 
+/* number of batch size distribution buckets for action.perfStats, see action.c */
+#define ACTION_PERF_NBR_BATCHBUCKETS 5
+
 /* the following struct defines the action object data structure
  */
 struct action_s {
@@ -54,6 +57,7 @@ struct action_s {
 	time_t	ttResumeRtry;	/* when is it time to retry the resume? */
 	int	iResumeInterval;/* resume interval for this action */
 	int	iResumeRetryCount;/* how often shall we retry a suspended action? (-1 --> eternal) */
+	sbool	bResumeAsync;	/* park the action on retry instead of sleeping the worker? */
 	int	iNbrNoExec;	/* number of matches that did not yet yield to an exec */
 	int	iExecEveryNthOccur;/* execute this action only every n-th occurence (with n=0,1 -> always) */
 	int  	iExecEveryNthOccurTO;/* timeout for n-th occurence feature */
@@ -85,6 +89,18 @@ struct action_s {
 	STATSCOUNTER_DEF(ctrSuspend, mutCtrSuspend)
 	STATSCOUNTER_DEF(ctrSuspendDuration, mutCtrSuspendDuration)
 	STATSCOUNTER_DEF(ctrResume, mutCtrResume)
+	/* performance counters, only maintained if bPerfStats is set */
+	sbool	bPerfStats;
+	STATSCOUNTER_DEF(ctrPerfRender, mutCtrPerfRender)	/* usecs in template rendering */
+	STATSCOUNTER_DEF(ctrPerfExec, mutCtrPerfExec)		/* usecs in output module */
+	STATSCOUNTER_DEF(ctrPerfRetry, mutCtrPerfRetry)		/* usecs in retry/suspension handling */
+	STATSCOUNTER_DEF(ctrPerfBatch[ACTION_PERF_NBR_BATCHBUCKETS], mutCtrPerfBatch)
+	/* dead-letter file for messages that failed permanently */
+	uchar	*pszErrFile;	/* name of error file, NULL if not configured */
+	int64	errFileMaxSize;	/* rotate error file when it grows beyond this (0: never) */
+	strm_t	*pErrFile;	/* error file stream, NULL if not (yet) open */
+	pthread_mutex_t mutErrFile;	/* guards pErrFile (lazy open, close on HUP) */
+	STATSCOUNTER_DEF(ctrErrFile, mutCtrErrFile)	/* messages written to error file */
 };
 
 
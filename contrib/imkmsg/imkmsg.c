@@ -48,6 +48,7 @@
 #include "prop.h"
 #include "errmsg.h"
 #include "unicode-helper.h"
+#include "statsobj.h"
 
 MODULE_TYPE_INPUT
 MODULE_TYPE_NOKEEP
@@ -60,6 +61,7 @@ DEFobjCurrIf(glbl)
 DEFobjCurrIf(prop)
 DEFobjCurrIf(net)
 DEFobjCurrIf(errmsg)
+DEFobjCurrIf(statsobj)
 
 /* config settings */
 typedef struct configSettings_s {
@@ -75,6 +77,10 @@ static prop_t *pInputName = NULL;
 /* there is only one global inputName for all messages generated by this module */
 static prop_t *pLocalHostIP = NULL;	/* a pseudo-constant propterty for 127.0.0.1 */
 
+static statsobj_t *modStats;
+STATSCOUNTER_DEF(ctrSubmit, mutCtrSubmit)
+STATSCOUNTER_DEF(ctrLost, mutCtrLost)
+
 static inline void
 initConfigSettings(void)
 {
@@ -84,11 +90,13 @@ initConfigSettings(void)
 
 /* enqueue the the kernel message into the message queue.
  * The provided msg string is not freed - thus must be done
- * by the caller.
+ * by the caller. If pMultiSub is given, the message is added
+ * to that batch, which the caller must flush.
  * rgerhards, 2008-04-12
  */
 static rsRetVal
-enqMsg(uchar *msg, uchar* pszTag, syslog_pri_t pri, struct timeval *tp, struct json_object *json)
+enqMsg(uchar *msg, uchar* pszTag, syslog_pri_t pri, struct timeval *tp, struct json_object *json,
+	multi_submit_t *const pMultiSub)
 {
 	struct syslogTime st;
 	smsg_t *pMsg;
@@ -113,7 +121,14 @@ enqMsg(uchar *msg, uchar* pszTag, syslog_pri_t pri, struct timeval *tp, struct j
 	MsgSetTAG(pMsg, pszTag, ustrlen(pszTag));
 	msgSetPRI(pMsg, pri);
 	pMsg->json = json;
-	CHKiRet(submitMsg(pMsg));
+	STATSCOUNTER_INC(ctrSubmit, mutCtrSubmit);
+	if(pMultiSub == NULL) {
+		CHKiRet(submitMsg2(pMsg));
+	} else {
+		pMultiSub->ppMsgs[pMultiSub->nElem++] = pMsg;
+		if(pMultiSub->nElem == pMultiSub->maxElem)
+			CHKiRet(multiSubmitMsg2(pMultiSub));
+	}
 
 finalize_it:
 	RETiRet;
@@ -141,14 +156,24 @@ rsRetVal imkmsgLogIntMsg(syslog_pri_t priority, char *fmt, ...)
 
 /* log a message from /dev/kmsg
  */
-rsRetVal Syslog(syslog_pri_t priority, uchar *pMsg, struct timeval *tp, struct json_object *json)
+rsRetVal Syslog(syslog_pri_t priority, uchar *pMsg, struct timeval *tp, struct json_object *json,
+	multi_submit_t *pMultiSub)
 {
 	DEFiRet;
-	iRet = enqMsg((uchar*)pMsg, (uchar*) "kernel:", priority, tp, json);
+	iRet = enqMsg((uchar*)pMsg, (uchar*) "kernel:", priority, tp, json, pMultiSub);
 	RETiRet;
 }
 
 
+/* account for kernel messages that were overwritten in the ring buffer
+ * before we could read them (detected by the driver via sequence gaps)
+ */
+void imkmsgCountLost(const unsigned nLost)
+{
+	STATSCOUNTER_ADD(ctrLost, mutCtrLost, nLost);
+}
+
+
 /* helper for some klog drivers which need to know the MaxLine global setting. They can
  * not obtain it themselfs, because they are no modules and can not query the object hander.
  * It would probably be a good idea to extend the interface to support it, but so far
@@ -241,6 +266,7 @@ CODESTARTmodExit
 		prop.Destruct(&pInputName);
 	if(pLocalHostIP != NULL)
 		prop.Destruct(&pLocalHostIP);
+	statsobj.Destruct(&modStats);
 
 	/* release objects we used */
 	objRelease(glbl, CORE_COMPONENT);
@@ -248,6 +274,7 @@ CODESTARTmodExit
 	objRelease(datetime, CORE_COMPONENT);
 	objRelease(prop, CORE_COMPONENT);
 	objRelease(errmsg, CORE_COMPONENT);
+	objRelease(statsobj, CORE_COMPONENT);
 ENDmodExit
 
 
@@ -273,6 +300,19 @@ CODEmodInit_QueryRegCFSLineHdlr
 	CHKiRet(objUse(prop, CORE_COMPONENT));
 	CHKiRet(objUse(net, CORE_COMPONENT));
 	CHKiRet(objUse(errmsg, CORE_COMPONENT));
+	CHKiRet(objUse(statsobj, CORE_COMPONENT));
+
+	/* create the statistics object */
+	CHKiRet(statsobj.Construct(&modStats));
+	CHKiRet(statsobj.SetName(modStats, UCHAR_CONSTANT("imkmsg")));
+	CHKiRet(statsobj.SetOrigin(modStats, UCHAR_CONSTANT("imkmsg")));
+	STATSCOUNTER_INIT(ctrSubmit, mutCtrSubmit);
+	CHKiRet(statsobj.AddCounter(modStats, UCHAR_CONSTANT("submitted"),
+		ctrType_IntCtr, CTR_FLAG_RESETTABLE, &ctrSubmit));
+	STATSCOUNTER_INIT(ctrLost, mutCtrLost);
+	CHKiRet(statsobj.AddCounter(modStats, UCHAR_CONSTANT("lost"),
+		ctrType_IntCtr, CTR_FLAG_RESETTABLE, &ctrLost));
+	CHKiRet(statsobj.ConstructFinalize(modStats));
 
 	/* we need to create the inputName property (only once during our lifetime) */
 	CHKiRet(prop.CreateStringProp(&pInputName, UCHAR_CONSTANT("imkmsg"), sizeof("imkmsg") - 1));
@@ -35,6 +35,7 @@
 #include <sys/klog.h>
 #include <sys/sysinfo.h>
 #include <sys/time.h>
+#include <poll.h>
 #include <json.h>
 
 #include "rsyslog.h"
@@ -49,22 +50,38 @@ static int	fklog = -1;	/* kernel log fd */
 #	define _PATH_KLOG "/dev/kmsg"
 #endif
 
+/* compute the time the system was booted. Kernel records carry their
+ * timestamp as microseconds since boot. We determine this only once per
+ * batch of records, not per message.
+ */
+static void
+getBootTime(struct timeval *const tvBoot)
+{
+	struct sysinfo info;
+
+	sysinfo(&info);
+	gettimeofday(tvBoot, NULL);
+	tvBoot->tv_sec -= info.uptime;
+}
+
+
 /* submit a message to imkmsg Syslog() API. In this function, we parse
  * necessary information from kernel log line, and make json string
- * from the rest.
+ * from the rest. Parsing is done in place, that is buf is modified.
+ * A record looks like:
+ * <pri>,<seq>,<timestamp>,<flags>[,...];<msg>\n[ <KEY>=<value>\n]...
  */
 static void
-submitSyslog(uchar *buf)
+submitSyslog(uchar *buf, const struct timeval *const tvBoot, multi_submit_t *const pMultiSub)
 {
-	long offs = 0;
+	static long long lastSeq = -1;
 	struct timeval tv;
-	struct sysinfo info;
 	unsigned long int timestamp = 0;
-	char name[1024];
-	char value[1024];
-	char msg[1024];
+	uchar *msg;
+	uchar *name;
+	uchar *value;
 	syslog_pri_t priority = 0;
-	long int sequnum = 0;
+	long long sequnum = 0;
 	struct json_object *json = NULL, *jval;
 
 	/* create new json object */
@@ -81,63 +98,62 @@ submitSyslog(uchar *buf)
 		sequnum = (sequnum * 10) + (*buf - '0');
 	}
 	buf++; /* skip , */
-	jval = json_object_new_int(sequnum);
+	jval = json_object_new_int64(sequnum);
 	json_object_object_add(json, "sequnum", jval);
 
+	/* records that were overwritten in the ring buffer before we could read
+	 * them show up as a gap in the sequence numbers.
+	 */
+	if (lastSeq != -1 && sequnum > lastSeq + 1) {
+		imkmsgLogIntMsg(LOG_WARNING, "imkmsg: %lld kernel messages lost due to ring buffer "
+			"overrun (sequence %lld to %lld)", sequnum - lastSeq - 1, lastSeq + 1, sequnum - 1);
+		imkmsgCountLost((unsigned) (sequnum - lastSeq - 1));
+	}
+	lastSeq = sequnum;
+
 	/* get timestamp */
 	for (; isdigit(*buf); buf++) {
 		timestamp = (timestamp * 10) + (*buf - '0');
 	}
 
-	while (*buf != ';') {
+	while (*buf != ';' && *buf != '\0') {
 		buf++; /* skip everything till the first ; */
 	}
-	buf++; /* skip ; */
+	if (*buf != '\0')
+		buf++; /* skip ; */
 
 	/* get message */
-	offs = 0;
-	for (; *buf != '\n' && *buf != '\0'; buf++, offs++) {
-		msg[offs] = *buf;
-	}
-	msg[offs] = '\0';
+	msg = buf;
+	for (; *buf != '\n' && *buf != '\0'; buf++)
+		/* just skip */;
+	if (*buf != '\0') /* message has appended properties, skip \n */
+		*buf++ = '\0';
 	jval = json_object_new_string((char*)msg);
 	json_object_object_add(json, "msg", jval);
 
-	if (*buf != '\0') /* message has appended properties, skip \n */
-		buf++;
-
 	while (*buf) {
 		/* get name of the property */
 		buf++; /* skip ' ' */
-		offs = 0;
-		for (; *buf != '=' && *buf != ' '; buf++, offs++) {
-			name[offs] = *buf;
-		}
-		name[offs] = '\0';
-		buf++; /* skip = or ' ' */;
-
-		offs = 0;
-		for (; *buf != '\n' && *buf != '\0'; buf++, offs++) {
-			value[offs] = *buf;
-		}
-		value[offs] = '\0';
+		name = buf;
+		for (; *buf != '=' && *buf != ' ' && *buf != '\0'; buf++)
+			/* just skip */;
+		if (*buf != '\0')
+			*buf++ = '\0'; /* terminate name, skip = or ' ' */
+
+		value = buf;
+		for (; *buf != '\n' && *buf != '\0'; buf++)
+			/* just skip */;
 		if (*buf != '\0') {
-			buf++; /* another property, skip \n */
+			*buf++ = '\0'; /* another property, skip \n */
 		}
 
 		jval = json_object_new_string((char*)value);
-		json_object_object_add(json, name, jval);
+		json_object_object_add(json, (char*)name, jval);
 	}
 
 	/* calculate timestamp */
-	sysinfo(&info);
-	gettimeofday(&tv, NULL);
-
-	/* get boot time */
-	tv.tv_sec -= info.uptime;
-
-	tv.tv_sec += timestamp / 1000000;
-	tv.tv_usec += timestamp % 1000000;
+	tv.tv_sec = tvBoot->tv_sec + timestamp / 1000000;
+	tv.tv_usec = tvBoot->tv_usec + timestamp % 1000000;
 
 	while (tv.tv_usec < 0) {
 		tv.tv_sec--;
@@ -149,7 +165,7 @@ submitSyslog(uchar *buf)
 		tv.tv_usec -= 1000000;
 	}
 
-	Syslog(priority, (uchar *)msg, &tv, json);
+	Syslog(priority, msg, &tv, json, pMultiSub);
 }
 
 
@@ -161,7 +177,8 @@ klogWillRunPrePrivDrop(modConfData_t *pModConf)
 	char errmsg[2048];
 	DEFiRet;
 
-	fklog = open(_PATH_KLOG, O_RDONLY, 0);
+	/* non-blocking, so that we can drain all available records, see readkmsg() */
+	fklog = open(_PATH_KLOG, O_RDONLY | O_NONBLOCK, 0);
 	if (fklog < 0) {
 		imkmsgLogIntMsg(LOG_ERR, "imkmsg: cannot open kernel log (%s): %s.",
 			_PATH_KLOG, rs_strerror_r(errno, errmsg, sizeof(errmsg)));
@@ -181,10 +198,10 @@ klogWillRunPostPrivDrop(modConfData_t *pModConf)
 	int r;
 	DEFiRet;
 
-	/* this normally returns EINVAL */
+	/* this normally returns EINVAL (or EAGAIN if there is no record yet) */
 	/* on an OpenVZ VM, we get EPERM */
 	r = read(fklog, NULL, 0);
-	if (r < 0 && errno != EINVAL) {
+	if (r < 0 && errno != EINVAL && errno != EAGAIN) {
 		imkmsgLogIntMsg(LOG_ERR, "imkmsg: cannot open kernel log (%s): %s.",
 			_PATH_KLOG, rs_strerror_r(errno, errmsg, sizeof(errmsg)));
 		fklog = -1;
@@ -195,8 +212,12 @@ finalize_it:
 	RETiRet;
 }
 
-/* Read kernel log while data are available, each read() reads one
- * record of printk buffer.
+/* Read kernel log while data are available. Each read() returns exactly one
+ * record of the printk buffer, /dev/kmsg does not permit reading several
+ * records at once. So we wait until the kernel has something for us and then
+ * drain all records that are available without blocking, submitting them as
+ * one batch. This keeps up with bursts (e.g. OOM storms) much better than
+ * enqueueing each record individually.
  */
 static void
 readkmsg(void)
@@ -204,19 +225,38 @@ readkmsg(void)
 	int i;
 	uchar pRcv[8192+1];
 	char errmsg[2048];
+	struct pollfd pfd;
+	struct timeval tvBoot;
+	multi_submit_t multiSub;
+	smsg_t *pMsgs[CONF_NUM_MULTISUB];
+
+	multiSub.ppMsgs = pMsgs;
+	multiSub.maxElem = CONF_NUM_MULTISUB;
+	multiSub.nElem = 0;
+
+	dbgprintf("imkmsg waiting for kernel log line\n");
+	pfd.fd = fklog;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, -1) < 0) {
+		if (errno != EINTR) {
+			imkmsgLogIntMsg(LOG_ERR, "imkmsg: error waiting for kernel log: %s",
+				rs_strerror_r(errno, errmsg, sizeof(errmsg)));
+		}
+		return;
+	}
 
+	getBootTime(&tvBoot);
 	for (;;) {
-		dbgprintf("imkmsg waiting for kernel log line\n");
-
-		/* every read() from the opened device node receives one record of the printk buffer */
 		i = read(fklog, pRcv, 8192);
 
 		if (i > 0) {
 			/* successful read of message of nonzero length */
 			pRcv[i] = '\0';
-		} else if (i == -EPIPE) {
-			imkmsgLogIntMsg(LOG_WARNING,
-					"imkmsg: some messages in circular buffer got overwritten");
+		} else if (i < 0 && errno == EPIPE) {
+			/* records were overwritten before we could read them. The next read
+			 * returns the oldest available one, the number of lost records is
+			 * detected by the sequence number gap in submitSyslog().
+			 */
 			continue;
 		} else {
 			/* something went wrong - error or zero length message */
@@ -230,8 +270,10 @@ readkmsg(void)
 			break;
 		}
 
-		submitSyslog(pRcv);
+		submitSyslog(pRcv, &tvBoot, &multiSub);
 	}
+
+	multiSubmitFlush(&multiSub);
 }
 
 
@@ -257,7 +299,10 @@ rsRetVal klogAfterRun(modConfData_t *pModConf)
 rsRetVal klogLogKMsg(modConfData_t __attribute__((unused)) *pModConf)
 {
 	DEFiRet;
+	if (fklog == -1) /* read error before, do not spin */
+		ABORT_FINALIZE(RS_RET_ERR_OPEN_KLOG);
 	readkmsg();
+finalize_it:
 	RETiRet;
 }
 
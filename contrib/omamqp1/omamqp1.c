@@ -86,6 +86,7 @@ typedef struct _configSettings {
     int idleTimeout;    /* disconnect idle connection (seconds) */
     int reconnectDelay; /* pause before re-connecting (seconds) */
     int maxRetries;   /* drop unrouteable messages after maxRetries attempts */
+    int nLinks;       /* number of sender links to the target */
 } configSettings_t;
 
 
@@ -93,20 +94,42 @@ typedef struct _configSettings {
 
 typedef enum {          // commands sent to protocol thread
     COMMAND_DONE,       // marks command complete
-    COMMAND_SEND,       // send a message to the message bus
     COMMAND_IS_READY,   // is the connection to the message bus active?
     COMMAND_SHUTDOWN    // cleanup and terminate protocol thread.
 } commands_t;
 
 
-typedef struct _threadIPC {
+typedef struct _threadIPC threadIPC_t;
+
+
+/* A message (one batch of log messages) handed to the protocol thread for
+ * sending. It is allocated by the worker thread, which waits until the
+ * protocol thread marks it done and then frees it. If the worker is
+ * cancelled while waiting, the request is marked abandoned and freed by
+ * the protocol thread once it completes. Messages of all workers are
+ * queued, so that several of them can be unsettled at the message bus at
+ * the same time (up to the link credit).
+ */
+typedef struct _sendRequest {
+    struct _sendRequest *next;
+    threadIPC_t *ipc;
+    pn_message_t *message;
+    rsRetVal result;
+    int retries;        // times the message bus released this batch so far
+    sbool done;
+    sbool abandoned;    // worker is gone, protocol thread owns the request
+} sendRequest_t;
+
+
+struct _threadIPC {
     pthread_mutex_t lock;
     pthread_cond_t condition;
+    pthread_mutex_t cmdLock;    // serializes commands issued by workers
     commands_t command;
     rsRetVal result;    // of command
-    pn_message_t *message;
-    uint64_t    tag;    // per message id
-} threadIPC_t;
+    sendRequest_t *sendHead;    // messages waiting for link credit
+    sendRequest_t *sendTail;
+};
 
 
 /* per-instance data */
@@ -118,12 +141,13 @@ typedef struct _instanceData {
     pthread_t thread_id;
     pn_reactor_t *reactor;
     pn_handler_t *handler;
-    pn_message_t *message;
-    int log_count;
 } instanceData;
 
 typedef struct wrkrInstanceData {
         instanceData *pData;
+        pn_message_t *message;  // built per worker, so workers do not serialize
+        int log_count;
+        int retries;    // releases of the current batch, kept across action retries
 } wrkrInstanceData_t;
 
 
@@ -146,8 +170,11 @@ static rsRetVal _launch_protocol_thread(instanceData *pData);
 static rsRetVal _shutdown_thread(instanceData *pData);
 static rsRetVal _issue_command(threadIPC_t *ipc,
                                pn_reactor_t *reactor,
-                               commands_t command,
-                               pn_message_t *message);
+                               commands_t command);
+static rsRetVal _send_message(threadIPC_t *ipc,
+                              pn_reactor_t *reactor,
+                              pn_message_t *message,
+                              int *pRetries);
 static void dispatcher(pn_handler_t *handler,
                        pn_event_t *event,
                        pn_event_type_t type);
@@ -164,7 +191,8 @@ static struct cnfparamdescr actpdescr[] = {
     { "idleTimeout", eCmdHdlrNonNegInt, 0 },
     { "reconnectDelay", eCmdHdlrPositiveInt, 0 },
     { "maxRetries", eCmdHdlrNonNegInt, 0 },
-    { "disableSASL", eCmdHdlrInt, 0 }
+    { "disableSASL", eCmdHdlrInt, 0 },
+    { "links", eCmdHdlrPositiveInt, 0 }
 };
 static struct cnfparamblk actpblk = {
     CNFPARAMBLK_VERSION,
@@ -199,6 +227,7 @@ ENDcreateWrkrInstance
 
 BEGINfreeWrkrInstance
 CODESTARTfreeWrkrInstance
+    if (pWrkrData->message) pn_decref(pWrkrData->message);
 ENDfreeWrkrInstance
 
 
@@ -210,7 +239,6 @@ CODESTARTfreeInstance
     _clean_thread_ipc(&pData->ipc);
     if (pData->reactor) pn_decref(pData->reactor);
     if (pData->handler) pn_decref(pData->handler);
-    if (pData->message) pn_decref(pData->message);
 }
 ENDfreeInstance
 
@@ -229,6 +257,7 @@ CODESTARTdbgPrintInstInfo
     dbgprintf("  idleTimeout=%d\n", cfg->idleTimeout);
     dbgprintf("  reconnectDelay=%d\n", cfg->reconnectDelay);
     dbgprintf("  maxRetries=%d\n", cfg->maxRetries);
+    dbgprintf("  links=%d\n", cfg->nLinks);
     dbgprintf("  running=%d\n", pData->bThreadRunning);
 }
 ENDdbgPrintInstInfo
@@ -239,7 +268,7 @@ CODESTARTtryResume
 {
     // is the link active?
     instanceData *pData = pWrkrData->pData;
-    iRet = _issue_command(&pData->ipc, pData->reactor, COMMAND_IS_READY, NULL);
+    iRet = _issue_command(&pData->ipc, pData->reactor, COMMAND_IS_READY);
 }
 ENDtryResume
 
@@ -248,12 +277,11 @@ BEGINbeginTransaction
 CODESTARTbeginTransaction
 {
     DBGPRINTF("omamqp1: beginTransaction\n");
-    instanceData *pData = pWrkrData->pData;
-    pData->log_count = 0;
-    if (pData->message) pn_decref(pData->message);
-    pData->message = pn_message();
-    CHKmalloc(pData->message);
-    pn_data_t *body = pn_message_body(pData->message);
+    pWrkrData->log_count = 0;
+    if (pWrkrData->message) pn_decref(pWrkrData->message);
+    pWrkrData->message = pn_message();
+    CHKmalloc(pWrkrData->message);
+    pn_data_t *body = pn_message_body(pWrkrData->message);
     pn_data_put_list(body);
     pn_data_enter(body);
 }
@@ -265,13 +293,12 @@ BEGINdoAction
 CODESTARTdoAction
 {
     DBGPRINTF("omamqp1: doAction\n");
-    instanceData *pData = pWrkrData->pData;
-    if (!pData->message) ABORT_FINALIZE(RS_RET_OK);
+    if (!pWrkrData->message) ABORT_FINALIZE(RS_RET_OK);
     pn_bytes_t msg = pn_bytes(strlen((const char *)ppString[0]),
                               (const char *)ppString[0]);
-    pn_data_t *body = pn_message_body(pData->message);
+    pn_data_t *body = pn_message_body(pWrkrData->message);
     pn_data_put_string(body, msg);
-    pData->log_count++;
+    pWrkrData->log_count++;
     iRet = RS_RET_DEFER_COMMIT;
 }
 finalize_it:
@@ -283,13 +310,13 @@ CODESTARTendTransaction
 {
     DBGPRINTF("omamqp1: endTransaction\n");
     instanceData *pData = pWrkrData->pData;
-    if (!pData->message) ABORT_FINALIZE(RS_RET_OK);
-    pn_data_t *body = pn_message_body(pData->message);
+    if (!pWrkrData->message) ABORT_FINALIZE(RS_RET_OK);
+    pn_data_t *body = pn_message_body(pWrkrData->message);
     pn_data_exit(body);
-    pn_message_t *message = pData->message;
-    pData->message = NULL;
-    if (pData->log_count > 0) {
-        CHKiRet(_issue_command(&pData->ipc, pData->reactor, COMMAND_SEND, message));
+    pn_message_t *message = pWrkrData->message;
+    pWrkrData->message = NULL;
+    if (pWrkrData->log_count > 0) {
+        CHKiRet(_send_message(&pData->ipc, pData->reactor, message, &pWrkrData->retries));
     } else {
         DBGPRINTF("omamqp1: no log messages to send\n");
         pn_decref(message);
@@ -342,6 +369,8 @@ CODESTARTnewActInst
             cs->maxRetries = (int) pvals[i].val.d.n;
         } else if (!strcmp(actpblk.descr[i].name, "disableSASL")) {
             cs->bDisableSASL = (int) pvals[i].val.d.n;
+        } else if (!strcmp(actpblk.descr[i].name, "links")) {
+            cs->nLinks = (int) pvals[i].val.d.n;
         } else {
             dbgprintf("omamqp1: program error, unrecognized param '%s', ignored.\n",
                       actpblk.descr[i].name);
@@ -412,14 +441,13 @@ typedef struct {
     threadIPC_t   *ipc;
     pn_reactor_t *reactor;  // AMQP 1.0 protocol engine
     pn_connection_t *conn;
-    pn_link_t *sender;
-    pn_delivery_t *delivery;
+    pn_link_t **senders;    // config->nLinks sender links
+    sendRequest_t *inFlight;    // sent, but not yet settled by the message bus
     char *encode_buffer;
     size_t buffer_size;
     uint64_t tag;
     int msgs_sent;
     int msgs_settled;
-    int retries;
     sbool stopped;
 } protocolState_t;
 
@@ -432,6 +460,7 @@ static void _init_config_settings(configSettings_t *pConfig)
     memset(pConfig, 0, sizeof(configSettings_t));
     pConfig->reconnectDelay = 5;
     pConfig->maxRetries = 10;
+    pConfig->nLinks = 1;
 }
 
 
@@ -451,6 +480,7 @@ static void _init_thread_ipc(threadIPC_t *pIPC)
     memset(pIPC, 0, sizeof(threadIPC_t));
     pthread_mutex_init(&pIPC->lock, NULL);
     pthread_cond_init(&pIPC->condition, NULL);
+    pthread_mutex_init(&pIPC->cmdLock, NULL);
     pIPC->command = COMMAND_DONE;
     pIPC->result = RS_RET_OK;
 }
@@ -459,6 +489,7 @@ static void _clean_thread_ipc(threadIPC_t *ipc)
 {
     pthread_cond_destroy(&ipc->condition);
     pthread_mutex_destroy(&ipc->lock);
+    pthread_mutex_destroy(&ipc->cmdLock);
 }
 
 
@@ -478,6 +509,8 @@ static rsRetVal _new_handler(pn_handler_t **handler,
     pState->buffer_size = 64;  // will grow if not enough
     pState->encode_buffer = (char *)malloc(pState->buffer_size);
     CHKmalloc(pState->encode_buffer);
+    pState->senders = (pn_link_t **)calloc(config->nLinks, sizeof(pn_link_t *));
+    CHKmalloc(pState->senders);
     pState->reactor = reactor;
     pState->stopped = false;
     // these are _references_, don't free them:
@@ -511,32 +544,71 @@ static void _del_handler(pn_handler_t *handler)
 {
     protocolState_t *pState = PROTOCOL_STATE(handler);
     if (pState->encode_buffer) free(pState->encode_buffer);
+    free(pState->senders);
 }
 
 
 // Close the sender and its parent session and connection
 static void _close_connection(protocolState_t *ps)
 {
-  if (ps->sender) {
-      pn_link_close(ps->sender);
-      pn_session_close(pn_link_session(ps->sender));
+  int i;
+  pn_session_t *ssn = NULL;
+  for (i = 0; i < ps->config->nLinks; ++i) {
+      if (ps->senders[i]) {
+          pn_link_close(ps->senders[i]);
+          ssn = pn_link_session(ps->senders[i]);
+      }
   }
+  if (ssn) pn_session_close(ssn);
   if (ps->conn) pn_connection_close(ps->conn);
 }
 
+// complete a list of send requests with the given result
+// must be called with ipc->lock held
+static void _complete_requests(sendRequest_t *req, rsRetVal result)
+{
+    sendRequest_t *next;
+    while (req) {
+        next = req->next;
+        if (req->abandoned) {
+            // its worker was cancelled while waiting, so nobody else frees it
+            pn_decref(req->message);
+            free(req);
+        } else {
+            req->result = result;
+            req->done = true;
+        }
+        req = next;
+    }
+}
+
+// fail all messages not yet settled, e.g. because the connection is gone.
+// must be called with ipc->lock held
+static void _abort_sends(protocolState_t *ps)
+{
+    threadIPC_t *ipc = ps->ipc;
+
+    if (ps->inFlight || ipc->sendHead) {
+        dbgprintf("omamqp1: aborted the message sends in progress\n");
+        _complete_requests(ps->inFlight, RS_RET_SUSPENDED);
+        _complete_requests(ipc->sendHead, RS_RET_SUSPENDED);
+        ps->inFlight = NULL;
+        ipc->sendHead = ipc->sendTail = NULL;
+        pthread_cond_broadcast(&ipc->condition);
+    }
+}
+
 static void _abort_command(protocolState_t *ps)
 {
     threadIPC_t *ipc = ps->ipc;
 
     pthread_mutex_lock(&ipc->lock);
+    _abort_sends(ps);
     switch (ipc->command) {
-    case COMMAND_SEND:
-      dbgprintf("omamqp1: aborted the message send in progress\n");
-      CASE_FALLTHROUGH
     case COMMAND_IS_READY:
       ipc->result = RS_RET_SUSPENDED;
       ipc->command = COMMAND_DONE;
-      pthread_cond_signal(&ipc->condition);
+      pthread_cond_broadcast(&ipc->condition);
       break;
     case COMMAND_SHUTDOWN: // cannot be aborted
     case COMMAND_DONE:
@@ -558,12 +630,29 @@ static void _log_error(const char *message, pn_condition_t *cond)
 }
 
 
+/* is the link active, i.e. open at both ends? */
+static sbool _is_active(pn_link_t *link)
+{
+    return (link
+            && pn_link_state(link) == (PN_LOCAL_ACTIVE | PN_REMOTE_ACTIVE));
+}
+
+
 /* is the link ready to send messages? */
 static sbool _is_ready(pn_link_t *link)
 {
-    return (link
-            && pn_link_state(link) == (PN_LOCAL_ACTIVE | PN_REMOTE_ACTIVE)
-            && pn_link_credit(link) > 0);
+    return (_is_active(link) && pn_link_credit(link) > 0);
+}
+
+
+/* is any of our sender links ready to send messages? */
+static sbool _any_ready(protocolState_t *ps)
+{
+    int i;
+    for (i = 0; i < ps->config->nLinks; ++i) {
+        if (_is_ready(ps->senders[i])) return true;
+    }
+    return false;
 }
 
 
@@ -582,12 +671,13 @@ static void dispatcher(pn_handler_t *handler, pn_event_t *event, pn_event_type_t
         break;
 
     case PN_DELIVERY:
-        // has the message been delivered to the message bus?
-        if (ps->delivery) {
-            assert(ps->delivery == pn_event_delivery(event));
-            if (pn_delivery_updated(ps->delivery)) {
+        // has a message been delivered to the message bus?
+        {
+            pn_delivery_t *dlv = pn_event_delivery(event);
+            sendRequest_t *req = (sendRequest_t *) pn_delivery_get_context(dlv);
+            if (req && pn_delivery_updated(dlv)) {
                 rsRetVal result = RS_RET_IDLE;
-                uint64_t rs = pn_delivery_remote_state(ps->delivery);
+                uint64_t rs = pn_delivery_remote_state(dlv);
                 switch (rs) {
                 case PN_ACCEPTED:
                     DBGPRINTF("omamqp1: Message ACCEPTED by message bus\n");
@@ -602,8 +692,9 @@ static void dispatcher(pn_handler_t *handler, pn_event_t *event, pn_event_type_t
                 case PN_RELEASED:
                 case PN_MODIFIED:
 		// the message bus cannot accept the message.  This may be temporary - retry
-		// up to maxRetries before dropping
-                    if (++ps->retries >= cfg->maxRetries) {
+		// up to maxRetries before dropping. The count is kept per batch, so
+		// releases of other in-flight batches do not count against it.
+                    if (++req->retries >= cfg->maxRetries) {
                       dbgprintf("omamqp1: message bus failed to accept message - dropping\n");
                       result = RS_RET_OK;
                     } else {
@@ -617,25 +708,28 @@ static void dispatcher(pn_handler_t *handler, pn_event_t *event, pn_event_type_t
                 default:
                     // no other terminal states defined, so ignore anything else
                     dbgprintf("omamqp1: unknown delivery state=0x%lX, assuming message accepted\n",
-                              (unsigned long) pn_delivery_remote_state(ps->delivery));
+                              (unsigned long) pn_delivery_remote_state(dlv));
                     result = RS_RET_OK;
                     break;
                 }
 
                 if (result != RS_RET_IDLE) {
-                    // the command is complete
+                    // the message is complete, remove it from the in-flight
+                    // list and wake up its worker. Note that req must not be
+                    // touched after the lock is released.
                     threadIPC_t *ipc = ps->ipc;
+                    sendRequest_t **pp;
                     pthread_mutex_lock(&ipc->lock);
-                    assert(ipc->command == COMMAND_SEND);
-                    ipc->result = result;
-                    ipc->command = COMMAND_DONE;
-                    pthread_cond_signal(&ipc->condition);
+                    for (pp = &ps->inFlight; *pp != NULL && *pp != req; pp = &(*pp)->next)
+                        ;
+                    assert(*pp == req);
+                    *pp = req->next;
+                    req->next = NULL;
+                    _complete_requests(req, result);
+                    pthread_cond_broadcast(&ipc->condition);
                     pthread_mutex_unlock(&ipc->lock);
-                    pn_delivery_settle(ps->delivery);
-                    ps->delivery = NULL;
-                    if (result == RS_RET_OK) {
-                      ps->retries = 0;
-                    }
+                    pn_delivery_set_context(dlv, NULL);
+                    pn_delivery_settle(dlv);
                 }
             }
         }
@@ -671,8 +765,11 @@ static void dispatcher(pn_handler_t *handler, pn_event_t *event, pn_event_type_t
         DBGPRINTF("omamqp1: cleaning up connection resources\n");
         pn_connection_release(pn_event_connection(event));
         ps->conn = NULL;
-        ps->sender = NULL;
-        ps->delivery = NULL;
+        memset(ps->senders, 0, ps->config->nLinks * sizeof(pn_link_t *));
+        // the deliveries are gone with the connection
+        pthread_mutex_lock(&ps->ipc->lock);
+        _abort_sends(ps);
+        pthread_mutex_unlock(&ps->ipc->lock);
         break;
 
 
@@ -700,19 +797,16 @@ static void dispatcher(pn_handler_t *handler, pn_event_t *event, pn_event_type_t
 // wait for the command to complete
 static rsRetVal _issue_command(threadIPC_t *ipc,
                                pn_reactor_t *reactor,
-                               commands_t command,
-                               pn_message_t *message)
+                               commands_t command)
 {
     DEFiRet;
 
     DBGPRINTF("omamqp1: Sending command %d to protocol thread\n", command);
 
+    // there is only one command slot, but there may be several workers
+    pthread_mutex_lock(&ipc->cmdLock);
     pthread_mutex_lock(&ipc->lock);
 
-    if (message) {
-        assert(ipc->message == NULL);
-        ipc->message = message;
-    }
     assert(ipc->command == COMMAND_DONE);
     ipc->command = command;
     pn_reactor_wakeup(reactor);
@@ -720,18 +814,149 @@ static rsRetVal _issue_command(threadIPC_t *ipc,
         pthread_cond_wait(&ipc->condition, &ipc->lock);
     }
     iRet = ipc->result;
-    if (ipc->message) {
-        pn_decref(ipc->message);
-        ipc->message = NULL;
-    }
 
     pthread_mutex_unlock(&ipc->lock);
+    pthread_mutex_unlock(&ipc->cmdLock);
 
     DBGPRINTF("omamqp1: Command %d completed, status=%d\n", command, iRet);
     RETiRet;
 }
 
 
+// cancellation cleanup for _send_message(): the worker was cancelled
+// while waiting, with ipc->lock re-acquired by pthread_cond_wait()
+static void _send_message_cancel(void *arg)
+{
+    sendRequest_t *req = (sendRequest_t *) arg;
+    threadIPC_t *ipc = req->ipc;
+
+    if (req->done) {
+        pn_decref(req->message);
+        free(req);
+    } else {
+        // still queued or in flight, the protocol thread frees it on completion
+        req->abandoned = true;
+    }
+    pthread_mutex_unlock(&ipc->lock);
+}
+
+
+// Queue a message for the protocol thread and wait until the
+// message bus has settled it. Messages of other workers may be
+// sent while we wait, so that the round-trip time to the message
+// bus does not limit throughput to one message per round-trip.
+// *pRetries is the number of times the batch has been released
+// by the message bus so far; it is reset once the batch is done.
+static rsRetVal _send_message(threadIPC_t *ipc,
+                              pn_reactor_t *reactor,
+                              pn_message_t *message,
+                              int *pRetries)
+{
+    sendRequest_t *req;
+    DEFiRet;
+
+    req = calloc(1, sizeof(sendRequest_t));
+    if (req == NULL) {
+        pn_decref(message);
+        ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+    }
+    req->ipc = ipc;
+    req->message = message;
+    req->result = RS_RET_SUSPENDED;
+    req->retries = *pRetries;
+
+    pthread_mutex_lock(&ipc->lock);
+    pthread_cleanup_push(_send_message_cancel, req);
+    if (ipc->sendTail) {
+        ipc->sendTail->next = req;
+    } else {
+        ipc->sendHead = req;
+    }
+    ipc->sendTail = req;
+    pn_reactor_wakeup(reactor);
+    while (!req->done) {
+        pthread_cond_wait(&ipc->condition, &ipc->lock);
+    }
+    pthread_cleanup_pop(0);
+    iRet = req->result;
+    *pRetries = (iRet == RS_RET_SUSPENDED) ? req->retries : 0;
+    pthread_mutex_unlock(&ipc->lock);
+
+    free(req);
+    pn_decref(message);
+    DBGPRINTF("omamqp1: message send completed, status=%d\n", iRet);
+finalize_it:
+    RETiRet;
+}
+
+
+// select the sender link with the most credit, NULL if none has credit
+static pn_link_t *_select_sender(protocolState_t *ps)
+{
+    pn_link_t *best = NULL;
+    int i;
+    for (i = 0; i < ps->config->nLinks; ++i) {
+        if (_is_ready(ps->senders[i])
+            && (best == NULL || pn_link_credit(ps->senders[i]) > pn_link_credit(best))) {
+            best = ps->senders[i];
+        }
+    }
+    return best;
+}
+
+
+// send queued messages as long as we have link credit. The messages
+// complete when the remote updates the delivery (see PN_DELIVERY).
+// must be called with ipc->lock held
+static void _send_queued(protocolState_t *ps)
+{
+    threadIPC_t *ipc = ps->ipc;
+    int i;
+
+    if (ipc->sendHead == NULL) return;
+
+    for (i = 0; i < ps->config->nLinks && !_is_active(ps->senders[i]); ++i)
+        ;
+    if (i == ps->config->nLinks) {
+        // no active link, fail instead of waiting (as we may wait forever)
+        _complete_requests(ipc->sendHead, RS_RET_SUSPENDED);
+        ipc->sendHead = ipc->sendTail = NULL;
+        pthread_cond_broadcast(&ipc->condition);
+        return;
+    }
+
+    pn_link_t *link;
+    while (ipc->sendHead && (link = _select_sender(ps)) != NULL) {
+        DBGPRINTF("omamqp1: Protocol thread sending message\n");
+        sendRequest_t *req = ipc->sendHead;
+        ipc->sendHead = req->next;
+        if (ipc->sendHead == NULL) ipc->sendTail = NULL;
+
+        ++ps->tag;
+        pn_delivery_t *dlv = pn_delivery(link,
+                                         pn_dtag((const char *)&ps->tag, sizeof(ps->tag)));
+        pn_delivery_set_context(dlv, req);
+
+        int rc = 0;
+        size_t len = ps->buffer_size;
+        do {
+            rc = pn_message_encode(req->message, ps->encode_buffer, &len);
+            if (rc == PN_OVERFLOW) {
+                _grow_buffer(ps);
+                len = ps->buffer_size;
+            }
+        } while (rc == PN_OVERFLOW);
+
+        pn_link_send(link, ps->encode_buffer, len);
+        pn_link_advance(link);
+        ++ps->msgs_sent;
+
+        req->next = ps->inFlight;
+        ps->inFlight = req;
+    }
+}
+
+
 // check if a command needs processing
 static void _poll_command(protocolState_t *ps)
 {
@@ -752,50 +977,21 @@ static void _poll_command(protocolState_t *ps)
 
     case COMMAND_IS_READY:
         DBGPRINTF("omamqp1: Protocol thread processing ready query command\n");
-        ipc->result = _is_ready(ps->sender)
+        ipc->result = _any_ready(ps)
                       ? RS_RET_OK
                       : RS_RET_SUSPENDED;
         ipc->command = COMMAND_DONE;
-        pthread_cond_signal(&ipc->condition);
-        break;
-
-    case COMMAND_SEND:
-        if (ps->delivery) break;  // currently processing this command
-        DBGPRINTF("omamqp1: Protocol thread processing send message command\n");
-        if (!_is_ready(ps->sender)) {
-            ipc->result = RS_RET_SUSPENDED;
-            ipc->command = COMMAND_DONE;
-            pthread_cond_signal(&ipc->condition);
-            break;
-        }
-
-        // send the message
-        ++ps->tag;
-        ps->delivery = pn_delivery(ps->sender,
-                                   pn_dtag((const char *)&ps->tag, sizeof(ps->tag)));
-        pn_message_t *message = ipc->message;
-        assert(message);
-
-        int rc = 0;
-        size_t len = ps->buffer_size;
-        do {
-            rc = pn_message_encode(message, ps->encode_buffer, &len);
-            if (rc == PN_OVERFLOW) {
-                _grow_buffer(ps);
-                len = ps->buffer_size;
-            }
-        } while (rc == PN_OVERFLOW);
-
-        pn_link_send(ps->sender, ps->encode_buffer, len);
-        pn_link_advance(ps->sender);
-        ++ps->msgs_sent;
-        // command completes when remote updates the delivery (see PN_DELIVERY)
+        pthread_cond_broadcast(&ipc->condition);
         break;
 
     case COMMAND_DONE:
         break;
     }
 
+    if (!ps->stopped) {
+        _send_queued(ps);
+    }
+
     pthread_mutex_unlock(&ipc->lock);
 }
 
@@ -853,12 +1049,21 @@ static void *amqp1_thread(void *arg)
         pn_connection_open(ps->conn);
         pn_session_t *ssn = pn_session(ps->conn);
         pn_session_open(ssn);
-        ps->sender = pn_sender(ssn, (char *)cfg->target);
-        pn_link_set_snd_settle_mode(ps->sender, PN_SND_UNSETTLED);
         char *addr = (char *)ps->config->target;
-        pn_terminus_set_address(pn_link_target(ps->sender), addr);
-        pn_terminus_set_address(pn_link_source(ps->sender), addr);
-        pn_link_open(ps->sender);
+        for (int i = 0; i < cfg->nLinks; ++i) {
+            // link names must be unique within the session
+            char name[512];
+            if (i == 0) {
+                snprintf(name, sizeof(name), "%s", addr);
+            } else {
+                snprintf(name, sizeof(name), "%s-%d", addr, i);
+            }
+            ps->senders[i] = pn_sender(ssn, name);
+            pn_link_set_snd_settle_mode(ps->senders[i], PN_SND_UNSETTLED);
+            pn_terminus_set_address(pn_link_target(ps->senders[i]), addr);
+            pn_terminus_set_address(pn_link_source(ps->senders[i]), addr);
+            pn_link_open(ps->senders[i]);
+        }
 
         // run the protocol engine until the connection closes or thread is shut down
         sbool engine_running = true;
@@ -883,9 +1088,10 @@ static void *amqp1_thread(void *arg)
     // stop command is now done:
     threadIPC_t *ipc = ps->ipc;
     pthread_mutex_lock(&ipc->lock);
+    _abort_sends(ps);
     ipc->result = RS_RET_OK;
     ipc->command = COMMAND_DONE;
-    pthread_cond_signal(&ipc->condition);
+    pthread_cond_broadcast(&ipc->condition);
     pthread_mutex_unlock(&ipc->lock);
 
     DBGPRINTF("omamqp1: Protocol thread stopped\n");
@@ -915,7 +1121,7 @@ static rsRetVal _shutdown_thread(instanceData *pData)
 
     if (pData->bThreadRunning) {
         DBGPRINTF("omamqp1: shutting down thread...\n");
-        CHKiRet(_issue_command(&pData->ipc, pData->reactor, COMMAND_SHUTDOWN, NULL));
+        CHKiRet(_issue_command(&pData->ipc, pData->reactor, COMMAND_SHUTDOWN));
         pthread_join(pData->thread_id, NULL);
         pData->bThreadRunning = false;
         DBGPRINTF("omamqp1: thread shutdown complete\n");
@@ -1,5 +1,6 @@
 /* omtcl.c
- * invoke a tcl procedure for every message
+ * invoke a tcl procedure for every message (or for every batch, if a batch
+ * procedure is configured)
  *
  * NOTE: read comments in module-template.h for more specifics!
  *
@@ -51,12 +52,20 @@ MODULE_TYPE_NOKEEP
 DEF_OMOD_STATIC_DATA
 
 typedef struct _instanceData {
-	Tcl_Interp * interp;
-	Tcl_Obj * cmdName;
+	char * fileName;	/* Tcl script to load */
+	char * cmdName;		/* proc to call for each message */
+	char * batchCmdName;	/* proc to call with a whole batch (NULL if not set) */
 } instanceData;
 
+/* Tcl interpreters (and objects) must only be used by the thread that
+ * created them. So each worker gets its own interpreter, which permits
+ * omtcl to scale with the number of queue worker threads.
+ */
 typedef struct wrkrInstanceData {
 	instanceData * pData;
+	Tcl_Interp * interp;
+	Tcl_Obj * cmdName;
+	Tcl_Obj * batchCmdName;
 } wrkrInstanceData_t;
 
 BEGINinitConfVars
@@ -65,12 +74,44 @@ ENDinitConfVars
 
 BEGINcreateInstance
 CODESTARTcreateInstance
-	pData->interp = Tcl_CreateInterp();
+	pData->fileName = NULL;
 	pData->cmdName = NULL;
+	pData->batchCmdName = NULL;
 ENDcreateInstance
 
+/* create an interpreter and load the script into it */
+static rsRetVal
+loadScript(instanceData *const pData, Tcl_Interp **const pInterp)
+{
+	Tcl_Interp *interp;
+	DEFiRet;
+
+	CHKmalloc(interp = Tcl_CreateInterp());
+	if (Tcl_EvalFile(interp, pData->fileName) == TCL_ERROR) {
+		LogError(0, RS_RET_CONFIG_ERROR, "Loading Tcl script: %s", Tcl_GetStringResult(interp));
+		Tcl_DeleteInterp(interp);
+		ABORT_FINALIZE(RS_RET_CONFIG_ERROR);
+	}
+	*pInterp = interp;
+
+finalize_it:
+	RETiRet;
+}
+
 BEGINcreateWrkrInstance
 CODESTARTcreateWrkrInstance
+	CHKiRet(loadScript(pWrkrData->pData, &pWrkrData->interp));
+	pWrkrData->cmdName = Tcl_NewStringObj(pWrkrData->pData->cmdName, -1);
+	Tcl_IncrRefCount(pWrkrData->cmdName);
+	if (pWrkrData->pData->batchCmdName != NULL) {
+		pWrkrData->batchCmdName = Tcl_NewStringObj(pWrkrData->pData->batchCmdName, -1);
+		Tcl_IncrRefCount(pWrkrData->batchCmdName);
+	}
+finalize_it:
+	if (iRet != RS_RET_OK) {
+		free(pWrkrData);
+		pWrkrData = NULL;
+	}
 ENDcreateWrkrInstance
 
 BEGINisCompatibleWithFeature
@@ -80,13 +121,19 @@ ENDisCompatibleWithFeature
 
 BEGINfreeInstance
 CODESTARTfreeInstance
-	if(pData->cmdName != NULL)
-		Tcl_DecrRefCount(pData->cmdName);
-	Tcl_DeleteInterp(pData->interp);
+	free(pData->fileName);
+	free(pData->cmdName);
+	free(pData->batchCmdName);
 ENDfreeInstance
 
 BEGINfreeWrkrInstance
 CODESTARTfreeWrkrInstance
+	if (pWrkrData->cmdName != NULL)
+		Tcl_DecrRefCount(pWrkrData->cmdName);
+	if (pWrkrData->batchCmdName != NULL)
+		Tcl_DecrRefCount(pWrkrData->batchCmdName);
+	if (pWrkrData->interp != NULL)
+		Tcl_DeleteInterp(pWrkrData->interp);
 ENDfreeWrkrInstance
 
 BEGINdbgPrintInstInfo
@@ -97,20 +144,69 @@ BEGINtryResume
 CODESTARTtryResume
 ENDtryResume
 
-BEGINdoAction
+BEGINbeginTransaction
+CODESTARTbeginTransaction
+ENDbeginTransaction
+
+/* call a proc with a single argument */
+static rsRetVal
+callProc(wrkrInstanceData_t *const pWrkrData, Tcl_Obj *const cmdName, Tcl_Obj *const arg)
+{
 	Tcl_Obj * objv[2];
-CODESTARTdoAction
-	objv[0] = pWrkrData->pData->cmdName;
-	objv[1] = Tcl_NewStringObj((char*) ppString[0], -1);
-	if (Tcl_EvalObjv(pWrkrData->pData->interp, 2, objv, 0) != TCL_OK) {
+	DEFiRet;
+
+	objv[0] = cmdName;
+	objv[1] = arg;
+	Tcl_IncrRefCount(arg);
+	if (Tcl_EvalObjv(pWrkrData->interp, 2, objv, 0) != TCL_OK) {
 		iRet = RS_RET_ERR;
-		DBGPRINTF("omtcl: %s", Tcl_GetStringResult(pWrkrData->pData->interp));
+		DBGPRINTF("omtcl: %s", Tcl_GetStringResult(pWrkrData->interp));
+	}
+	Tcl_DecrRefCount(arg);
+	RETiRet;
+}
+
+/* If a batch proc is configured, it receives all messages of the transaction
+ * as a single Tcl list. Otherwise, the regular proc is called per message.
+ * Errors are never returned to the core: for a failed transaction, the core
+ * bisects the batch and commits the parts again, which would run the proc
+ * again for messages it may already have processed. So a failing batch proc
+ * drops the whole batch, and a failing per-message proc drops just the
+ * message that caused it.
+ */
+BEGINcommitTransaction
+	Tcl_Obj * list;
+CODESTARTcommitTransaction
+	if (pWrkrData->batchCmdName != NULL) {
+		list = Tcl_NewListObj(0, NULL);
+		for (unsigned i = 0 ; i < nParams ; ++i) {
+			Tcl_ListObjAppendElement(NULL, list,
+				Tcl_NewStringObj((char*) actParam(pParams, 1, i, 0).param, -1));
+		}
+		if (callProc(pWrkrData, pWrkrData->batchCmdName, list) != RS_RET_OK) {
+			LogError(0, RS_RET_ERR, "omtcl: batch proc '%s' failed, %u messages discarded: %s",
+				pWrkrData->pData->batchCmdName, nParams,
+				Tcl_GetStringResult(pWrkrData->interp));
+		}
+	} else {
+		for (unsigned i = 0 ; i < nParams ; ++i) {
+			if (callProc(pWrkrData, pWrkrData->cmdName,
+				Tcl_NewStringObj((char*) actParam(pParams, 1, i, 0).param, -1)) != RS_RET_OK) {
+				LogError(0, RS_RET_ERR, "omtcl: proc '%s' failed, message discarded: %s",
+					pWrkrData->pData->cmdName, Tcl_GetStringResult(pWrkrData->interp));
+			}
+		}
 	}
-ENDdoAction
+ENDcommitTransaction
 
+/* config format is
+ * :omtcl:<script file>,<proc>[,<batch proc>];<template>
+ */
 BEGINparseSelectorAct
 	char fileName[PATH_MAX+1];
 	char buffer[4096];
+	char *batchCmd;
+	Tcl_Interp *interp;
 CODESTARTparseSelectorAct
 CODE_STD_STRING_REQUESTparseSelectorAct(1)
 	if(strncmp((char*) p, ":omtcl:", sizeof(":omtcl:") - 1)) {
@@ -129,14 +225,19 @@ CODE_STD_STRING_REQUESTparseSelectorAct(1)
 	CHKiRet(cflineParseTemplateName(&p, *ppOMSR, 0, 0, (uchar*) "RSYSLOG_FileFormat"));
 
 	CHKiRet(createInstance(&pData));
-	pData->cmdName = Tcl_NewStringObj(buffer, -1);
-	Tcl_IncrRefCount(pData->cmdName);
-
-	// TODO parse arguments: file,procname
-	if (Tcl_EvalFile(pData->interp, fileName) == TCL_ERROR) {
-		LogError(0, RS_RET_CONFIG_ERROR, "Loading Tcl script: %s", Tcl_GetStringResult(pData->interp));
-		ABORT_FINALIZE(RS_RET_CONFIG_ERROR);
+	if ((batchCmd = strchr(buffer, ',')) != NULL) {
+		*batchCmd++ = '\0';
+		if (*batchCmd != '\0')
+			CHKmalloc(pData->batchCmdName = strdup(batchCmd));
 	}
+	CHKmalloc(pData->cmdName = strdup(buffer));
+	CHKmalloc(pData->fileName = strdup(fileName));
+
+	/* check the script now, so that errors are reported at startup. The
+	 * interpreters used for processing are created per worker.
+	 */
+	CHKiRet(loadScript(pData, &interp));
+	Tcl_DeleteInterp(interp);
 
 CODE_STD_FINALIZERparseSelectorAct
 ENDparseSelectorAct
@@ -148,7 +249,7 @@ ENDmodExit
 
 BEGINqueryEtryPt
 CODESTARTqueryEtryPt
-CODEqueryEtryPt_STD_OMOD_QUERIES
+CODEqueryEtryPt_STD_OMODTX_QUERIES
 CODEqueryEtryPt_STD_OMOD8_QUERIES
 ENDqueryEtryPt
 
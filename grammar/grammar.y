@@ -189,9 +189,7 @@ s_act:	  BEGIN_ACTION nvlst ENDOBJ	{ $$ = cnfstmtNewAct($2); }
 	| LEGACY_ACTION			{ $$ = cnfstmtNewLegaAct($1); }
 	| STOP				{ $$ = cnfstmtNew(S_STOP); }
 	| CALL NAME			{ $$ = cnfstmtNewCall($2); }
-	| CALL_INDIRECT expr ';'	{ $$ = cnfstmtNew(S_CALL_INDIRECT);
-					  $$->d.s_call_ind.expr = $2;
-					}
+	| CALL_INDIRECT expr ';'	{ $$ = cnfstmtNewCallIndirect($2); }
 	| CONTINUE			{ $$ = cnfstmtNewContinue(); }
 expr:	  expr AND expr			{ $$ = cnfexprNew(AND, $1, $3); }
 	| expr OR expr			{ $$ = cnfexprNew(OR, $1, $3); }
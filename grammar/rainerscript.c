@@ -55,6 +55,7 @@
 #include "wti.h"
 #include "unicode-helper.h"
 #include "errmsg.h"
+#include "hashtable.h"
 
 #if !defined(_AIX)
 #pragma GCC diagnostic ignored "-Wswitch-enum"
@@ -2519,6 +2520,26 @@ doFuncCall(struct cnffunc *__restrict__ const func, struct svar *__restrict__ co
 		if(bMustFree) free(str);
 		varFreeMembers(&r[0]);
 		break;
+	case CNFFUNC_SD_PARAM:
+		/* picks a single param from the raw STRUCTURED-DATA, so no
+		 * JSON tree needs to be built (as mmpstrucdata does).
+		 */
+		cnfexprEval(func->expr[0], &r[0], usrptr, pWti);
+		cnfexprEval(func->expr[1], &r[1], usrptr, pWti);
+		str = (char*) var2CString(&r[0], &bMustFree);
+		str2 = (char*) var2CString(&r[1], &bMustFree2);
+		if(MsgGetSDParam((smsg_t*) usrptr, (uchar*) str, (uchar*) str2, &resStr, &retval) == RS_RET_OK) {
+			ret->d.estr = es_newStrFromCStr((char*) resStr, retval);
+			free(resStr);
+		} else {
+			ret->d.estr = es_newStr(0);
+		}
+		ret->datatype = 'S';
+		if(bMustFree) free(str);
+		if(bMustFree2) free(str2);
+		varFreeMembers(&r[0]);
+		varFreeMembers(&r[1]);
+		break;
 	default:
 		if(Debug) {
 			char *fname = es_str2cstr(func->fname, NULL);
@@ -3455,6 +3476,7 @@ void
 cnfstmtPrintOnly(struct cnfstmt *stmt, int indent, sbool subtree)
 {
 	char *cstr;
+	int i;
 	switch(stmt->nodetype) {
 	case S_NOP:
 		doIndent(indent); dbgprintf("NOP\n");
@@ -3489,6 +3511,24 @@ cnfstmtPrintOnly(struct cnfstmt *stmt, int indent, sbool subtree)
 			doIndent(indent); dbgprintf("END IF\n");
 		}
 		break;
+	case S_SWITCH:
+		doIndent(indent); dbgprintf("SWITCH [%s, %d branches]\n",
+			stmt->d.s_switch.isChain ? "if/else-if chain" : "if sequence",
+			stmt->d.s_switch.nbranch);
+		if(subtree) {
+			for(i = 0 ; i < stmt->d.s_switch.nbranch ; ++i) {
+				doIndent(indent); dbgprintf("CASE\n");
+				cnfexprPrint(stmt->d.s_switch.expr[i], indent+1);
+				doIndent(indent); dbgprintf("THEN\n");
+				cnfstmtPrint(stmt->d.s_switch.t_then[i], indent+1);
+			}
+			if(stmt->d.s_switch.t_else != NULL) {
+				doIndent(indent); dbgprintf("ELSE\n");
+				cnfstmtPrint(stmt->d.s_switch.t_else, indent+1);
+			}
+			doIndent(indent); dbgprintf("END SWITCH\n");
+		}
+		break;
 	case S_FOREACH:
 		doIndent(indent); dbgprintf("FOREACH %s IN\n", stmt->d.s_foreach.iter->var);
 		cnfexprPrint(stmt->d.s_foreach.iter->collection, indent+1);
@@ -3679,6 +3719,8 @@ static void cnfIteratorDestruct(struct cnfitr *itr);
 static void
 cnfstmtDestruct(struct cnfstmt *stmt)
 {
+	int i;
+
 	switch(stmt->nodetype) {
 	case S_NOP:
 	case S_STOP:
@@ -3701,6 +3743,16 @@ cnfstmtDestruct(struct cnfstmt *stmt)
 			cnfstmtDestructLst(stmt->d.s_if.t_else);
 		}
 		break;
+	case S_SWITCH:
+		hashtable_destroy(stmt->d.s_switch.ht, 1);
+		for(i = 0 ; i < stmt->d.s_switch.nbranch ; ++i) {
+			cnfexprDestruct(stmt->d.s_switch.expr[i]);
+			cnfstmtDestructLst(stmt->d.s_switch.t_then[i]);
+		}
+		free(stmt->d.s_switch.expr);
+		free(stmt->d.s_switch.t_then);
+		cnfstmtDestructLst(stmt->d.s_switch.t_else);
+		break;
 	case S_FOREACH:
 		cnfIteratorDestruct(stmt->d.s_foreach.iter);
 		cnfstmtDestructLst(stmt->d.s_foreach.body);
@@ -3806,6 +3858,16 @@ cnfstmtNewCall(es_str_t *name)
 	return cnfstmt;
 }
 
+struct cnfstmt *
+cnfstmtNewCallIndirect(struct cnfexpr *const expr)
+{
+	struct cnfstmt* cnfstmt;
+	if((cnfstmt = cnfstmtNew(S_CALL_INDIRECT)) != NULL) {
+		cnfstmt->d.s_call_ind.expr = expr;
+	}
+	return cnfstmt;
+}
+
 struct cnfstmt *
 cnfstmtNewReloadLookupTable(struct cnffparamlst *fparams)
 {
@@ -4360,6 +4422,328 @@ removeNOPs(struct cnfstmt *root)
 done:	return newRoot;
 }
 
+/* Hashed dispatch of equality tests against a single property.
+ * Routing configs often consist of long chains like
+ *   if $programname == "a" then ... else if $programname == "b" then ...
+ * (or a list of independent ifs of that kind). Executed as written, each
+ * message is compared against one branch after the other, obtaining the
+ * property again for every comparison. If enough branches compare the same
+ * property against constant strings (or string arrays), we replace them by
+ * a S_SWITCH node, which evaluates the property once and finds the branch(es)
+ * to execute via a hash table.
+ */
+#define SWITCH_MIN_BRANCHES 4
+
+/* hash key: points into the constant strings owned by the switch node or,
+ * for lookups, into the evaluated property value
+ */
+struct cnfswitchkey {
+	const uchar *val;
+	es_size_t len;
+};
+
+/* hash value: all branches whose comparison is true for the key, ascending */
+struct cnfswitchent {
+	int nbranch;
+	int *branch;
+};
+
+static unsigned int
+hashSwitchKey(void *k)
+{
+	const struct cnfswitchkey *const key = (const struct cnfswitchkey*) k;
+	unsigned int hash = 5381;
+	es_size_t i;
+
+	for(i = 0 ; i < key->len ; ++i) {
+		hash = ((hash << 5) + hash) + key->val[i]; /* hash * 33 + c */
+	}
+	return hash;
+}
+
+static int
+keyEqualsSwitchKey(void *key1, void *key2)
+{
+	const struct cnfswitchkey *const k1 = (const struct cnfswitchkey*) key1;
+	const struct cnfswitchkey *const k2 = (const struct cnfswitchkey*) key2;
+	return k1->len == k2->len && !memcmp(k1->val, k2->val, k1->len);
+}
+
+static void
+switchEntDestruct(void *v)
+{
+	struct cnfswitchent *const ent = (struct cnfswitchent*) v;
+	free(ent->branch);
+	free(ent);
+}
+
+/* check if expr is a comparison that can be hashed. If so, return the name
+ * of the property it compares, else NULL. Facility and severity names are
+ * excluded, as the expression optimizer turns them into prifilt() calls.
+ */
+static const char *
+switchableVarName(const struct cnfexpr *const expr)
+{
+	const char *name;
+
+	if(expr->nodetype != CMP_EQ || expr->l->nodetype != 'V'
+	   || (expr->r->nodetype != 'S' && expr->r->nodetype != 'A'))
+		return NULL;
+	name = ((struct cnfvar*)expr->l)->name;
+	if(!strcmp(name, "syslogfacility-text") || !strcmp(name, "syslogseverity-text"))
+		return NULL;
+	return name;
+}
+
+static rsRetVal
+switchAddKey(struct hashtable *const ht, es_str_t *const estr, const int branch, const sbool isChain)
+{
+	struct cnfswitchkey lookup;
+	struct cnfswitchkey *key = NULL;
+	struct cnfswitchent *found;
+	struct cnfswitchent *ent = NULL;
+	int *newbranch;
+	DEFiRet;
+
+	lookup.val = es_getBufAddr(estr);
+	lookup.len = es_strlen(estr);
+	if((found = hashtable_search(ht, &lookup)) != NULL) {
+		/* in a chain, only the first matching branch can ever run */
+		if(isChain || found->branch[found->nbranch-1] == branch)
+			FINALIZE;
+		CHKmalloc(newbranch = realloc(found->branch, (found->nbranch+1) * sizeof(int)));
+		found->branch = newbranch;
+		found->branch[found->nbranch++] = branch;
+		FINALIZE;
+	}
+
+	CHKmalloc(key = malloc(sizeof(struct cnfswitchkey)));
+	*key = lookup;
+	CHKmalloc(ent = calloc(1, sizeof(struct cnfswitchent)));
+	CHKmalloc(ent->branch = malloc(sizeof(int)));
+	ent->branch[0] = branch;
+	ent->nbranch = 1;
+	if(!hashtable_insert(ht, key, ent))
+		ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+
+finalize_it:
+	if(iRet != RS_RET_OK) {
+		free(key);
+		if(ent != NULL)
+			switchEntDestruct(ent);
+	}
+	RETiRet;
+}
+
+/* build the hash table for the comparisons in expr[] */
+static rsRetVal
+switchBuildTable(struct cnfexpr **const expr, const int nbranch, const sbool isChain,
+	struct hashtable **const ppht)
+{
+	struct hashtable *ht;
+	struct cnfarray *arr;
+	int i, j;
+	DEFiRet;
+
+	CHKmalloc(ht = create_hashtable(nbranch < 16 ? 16 : nbranch, hashSwitchKey,
+		keyEqualsSwitchKey, switchEntDestruct));
+	for(i = 0 ; i < nbranch ; ++i) {
+		if(expr[i]->r->nodetype == 'S') {
+			CHKiRet(switchAddKey(ht, ((struct cnfstringval*)expr[i]->r)->estr, i, isChain));
+		} else {
+			arr = (struct cnfarray*) expr[i]->r;
+			for(j = 0 ; j < arr->nmemb ; ++j)
+				CHKiRet(switchAddKey(ht, arr->arr[j], i, isChain));
+		}
+	}
+	*ppht = ht;
+
+finalize_it:
+	if(iRet != RS_RET_OK && ht != NULL)
+		hashtable_destroy(ht, 1);
+	RETiRet;
+}
+
+/* finish a S_SWITCH node whose branches have been moved into it */
+static void
+switchOptimizeBranches(struct cnfstmt *const stmt)
+{
+	int i;
+
+	for(i = 0 ; i < stmt->d.s_switch.nbranch ; ++i) {
+		/* only sorts string arrays, the comparison itself is kept */
+		stmt->d.s_switch.expr[i] = cnfexprOptimize(stmt->d.s_switch.expr[i]);
+		stmt->d.s_switch.t_then[i] = removeNOPs(stmt->d.s_switch.t_then[i]);
+		cnfstmtOptimize(stmt->d.s_switch.t_then[i]);
+	}
+	stmt->d.s_switch.var = stmt->d.s_switch.expr[0]->l;
+	cnfstmtOptimize(stmt->d.s_switch.t_else);
+}
+
+/* try to turn the if/else-if chain starting at stmt into a S_SWITCH node.
+ * Returns 1 if done, 0 if stmt was left untouched.
+ */
+static int
+cnfstmtOptimizeIfChain(struct cnfstmt *const stmt)
+{
+	struct cnfstmt *cur, *next;
+	struct cnfexpr **expr = NULL;
+	struct cnfstmt **t_then = NULL;
+	struct hashtable *ht;
+	const char *varname, *name;
+	int nbranch, i;
+	int r = 0;
+
+	if((varname = switchableVarName(stmt->d.s_if.expr)) == NULL)
+		goto done;
+	for(nbranch = 1, cur = stmt ; ; ++nbranch, cur = next) {
+		cur->d.s_if.t_else = removeNOPs(cur->d.s_if.t_else);
+		next = cur->d.s_if.t_else;
+		if(next == NULL || next->next != NULL || next->nodetype != S_IF
+		   || (name = switchableVarName(next->d.s_if.expr)) == NULL
+		   || strcmp(name, varname))
+			break;
+	}
+	if(nbranch < SWITCH_MIN_BRANCHES)
+		goto done;
+
+	if((expr = malloc(nbranch * sizeof(struct cnfexpr*))) == NULL
+	   || (t_then = malloc(nbranch * sizeof(struct cnfstmt*))) == NULL)
+		goto done;
+	for(i = 0, cur = stmt ; i < nbranch ; ++i, cur = cur->d.s_if.t_else)
+		expr[i] = cur->d.s_if.expr;
+	if(switchBuildTable(expr, nbranch, 1, &ht) != RS_RET_OK)
+		goto done;
+
+	DBGPRINTF("optimizer: change if/else-if chain of %d comparisons of '%s' to SWITCH\n",
+		nbranch, varname);
+	for(i = 0, cur = stmt ; i < nbranch ; ++i, cur = next) {
+		t_then[i] = cur->d.s_if.t_then;
+		next = cur->d.s_if.t_else;
+		if(cur != stmt) {
+			free(cur->printable);
+			free(cur);
+		}
+	}
+	/* cur is now the final else part, if any */
+	stmt->nodetype = S_SWITCH;
+	stmt->d.s_switch.expr = expr;
+	stmt->d.s_switch.t_then = t_then;
+	stmt->d.s_switch.nbranch = nbranch;
+	stmt->d.s_switch.isChain = 1;
+	stmt->d.s_switch.t_else = cur;
+	stmt->d.s_switch.ht = ht;
+	switchOptimizeBranches(stmt);
+	r = 1;
+
+done:
+	if(!r) {
+		free(expr);
+		free(t_then);
+	}
+	return r;
+}
+
+/* try to turn the sequence of independent ifs starting at stmt into a
+ * S_SWITCH node. Returns 1 if done, 0 if stmt was left untouched.
+ */
+static int
+cnfstmtOptimizeIfSeq(struct cnfstmt *const stmt)
+{
+	struct cnfstmt *cur, *next;
+	struct cnfexpr **expr = NULL;
+	struct cnfstmt **t_then = NULL;
+	struct hashtable *ht;
+	const char *varname, *name;
+	int nbranch, i;
+	int r = 0;
+
+	stmt->d.s_if.t_else = removeNOPs(stmt->d.s_if.t_else);
+	if(stmt->d.s_if.t_else != NULL || (varname = switchableVarName(stmt->d.s_if.expr)) == NULL)
+		goto done;
+	for(nbranch = 1, cur = stmt->next ; cur != NULL ; ++nbranch, cur = cur->next) {
+		if(cur->nodetype != S_IF)
+			break;
+		cur->d.s_if.t_else = removeNOPs(cur->d.s_if.t_else);
+		if(cur->d.s_if.t_else != NULL
+		   || (name = switchableVarName(cur->d.s_if.expr)) == NULL
+		   || strcmp(name, varname))
+			break;
+	}
+	if(nbranch < SWITCH_MIN_BRANCHES)
+		goto done;
+
+	if((expr = malloc(nbranch * sizeof(struct cnfexpr*))) == NULL
+	   || (t_then = malloc(nbranch * sizeof(struct cnfstmt*))) == NULL)
+		goto done;
+	for(i = 0, cur = stmt ; i < nbranch ; ++i, cur = cur->next)
+		expr[i] = cur->d.s_if.expr;
+	if(switchBuildTable(expr, nbranch, 0, &ht) != RS_RET_OK)
+		goto done;
+
+	DBGPRINTF("optimizer: change sequence of %d ifs comparing '%s' to SWITCH\n",
+		nbranch, varname);
+	for(i = 0, cur = stmt ; i < nbranch ; ++i, cur = next) {
+		t_then[i] = cur->d.s_if.t_then;
+		next = cur->next;
+		if(cur != stmt) {
+			free(cur->printable);
+			free(cur);
+		}
+	}
+	/* cur is now the statement following the sequence */
+	stmt->next = cur;
+	stmt->nodetype = S_SWITCH;
+	stmt->d.s_switch.expr = expr;
+	stmt->d.s_switch.t_then = t_then;
+	stmt->d.s_switch.nbranch = nbranch;
+	stmt->d.s_switch.isChain = 0;
+	stmt->d.s_switch.t_else = NULL;
+	stmt->d.s_switch.ht = ht;
+	switchOptimizeBranches(stmt);
+	r = 1;
+
+done:
+	if(!r) {
+		free(expr);
+		free(t_then);
+	}
+	return r;
+}
+
+/* execution helper for S_SWITCH: evaluate the property and return the first
+ * branch after branch "after" whose comparison is true, or -1 if there is
+ * none. Pass -1 as "after" to search all branches.
+ */
+int
+cnfstmtSwitchSelect(struct cnfstmt *const stmt, void *const usrptr, wti_t *const pWti, const int after)
+{
+	struct svar val;
+	es_str_t *estr;
+	int bMustFree;
+	struct cnfswitchkey key;
+	struct cnfswitchent *ent;
+	int i;
+	int r = -1;
+
+	cnfexprEval(stmt->d.s_switch.var, &val, usrptr, pWti);
+	estr = var2String(&val, &bMustFree);
+	key.val = es_getBufAddr(estr);
+	key.len = es_strlen(estr);
+	if((ent = hashtable_search(stmt->d.s_switch.ht, &key)) != NULL) {
+		for(i = 0 ; i < ent->nbranch ; ++i) {
+			if(ent->branch[i] > after) {
+				r = ent->branch[i];
+				break;
+			}
+		}
+	}
+	if(bMustFree)
+		es_deleteStr(estr);
+	varFreeMembers(&val);
+	return r;
+}
+
 static void
 cnfstmtOptimizeForeach(struct cnfstmt *stmt)
 {
@@ -4377,6 +4761,9 @@ cnfstmtOptimizeIf(struct cnfstmt *stmt)
 	struct cnffunc *func;
 	struct funcData_prifilt *prifilt;
 
+	if(cnfstmtOptimizeIfChain(stmt))
+		return;
+
 	expr = stmt->d.s_if.expr = cnfexprOptimize(stmt->d.s_if.expr);
 	stmt->d.s_if.t_then = removeNOPs(stmt->d.s_if.t_then);
 	stmt->d.s_if.t_else = removeNOPs(stmt->d.s_if.t_else);
@@ -4509,7 +4896,10 @@ cnfstmtOptimize(struct cnfstmt *root)
 	for(stmt = root ; stmt != NULL ; stmt = stmt->next) {
 		switch(stmt->nodetype) {
 		case S_IF:
-			cnfstmtOptimizeIf(stmt);
+			if(!cnfstmtOptimizeIfSeq(stmt))
+				cnfstmtOptimizeIf(stmt);
+			break;
+		case S_SWITCH: /* result of an earlier optimizer run */
 			break;
 		case S_FOREACH:
 			cnfstmtOptimizeForeach(stmt);
@@ -4659,6 +5049,8 @@ funcName2ID(es_str_t *fname, unsigned short nParams)
 			"but is %d.");
 	} else if(FUNC_NAME("parse_json")) {
 		GENERATE_FUNC("parse_json", 2, CNFFUNC_PARSE_JSON);
+	} else if(FUNC_NAME("sd_param")) {
+		GENERATE_FUNC("sd_param", 2, CNFFUNC_SD_PARAM);
 	} else if(FUNC_NAME("script_error")) {
 		GENERATE_FUNC("script_error", 0, CNFFUNC_SCRIPT_ERROR);
 	} else if(FUNC_NAME("previous_action_suspended")) {
@@ -118,6 +118,7 @@ struct nvlst {
 #define S_FOREACH 4009
 #define S_RELOAD_LOOKUP_TABLE 4010
 #define S_CALL_INDIRECT 4011
+#define S_SWITCH 4012	/* optimizer result: hashed if/else-if chain */
 
 enum cnfFiltType { CNFFILT_NONE, CNFFILT_PRI, CNFFILT_PROP, CNFFILT_SCRIPT };
 const char* cnfFiltType2str(const enum cnfFiltType filttype);
@@ -149,6 +150,15 @@ struct cnfstmt {
 		struct {
 			struct cnfexpr *expr;
 		} s_call_ind;
+		struct {
+			struct cnfexpr *var;	/* property all branches compare, owned by expr[0] */
+			struct cnfexpr **expr;	/* original comparisons, in source order */
+			struct cnfstmt **t_then; /* branch bodies, in source order */
+			int nbranch;
+			sbool isChain;		/* else-if chain: only the first match runs */
+			struct cnfstmt *t_else;	/* chain only: run if no branch matches */
+			struct hashtable *ht;	/* value -> matching branches */
+		} s_switch;
 		struct {
 			uchar pmask[LOG_NFACILITIES+1];	/* priority mask */
 			struct cnfstmt *t_then;
@@ -245,7 +255,8 @@ enum cnffuncid {
 	CNFFUNC_PREVIOUS_ACTION_SUSPENDED,
 	CNFFUNC_SCRIPT_ERROR,
 	CNFFUNC_HTTP_REQUEST,
-	CNFFUNC_IS_TIME
+	CNFFUNC_IS_TIME,
+	CNFFUNC_SD_PARAM
 };
 
 struct cnffunc {
@@ -354,10 +365,12 @@ struct cnfstmt * cnfstmtNewLegaAct(char *actline);
 struct cnfstmt * cnfstmtNewSet(char *var, struct cnfexpr *expr, int force_reset);
 struct cnfstmt * cnfstmtNewUnset(char *var);
 struct cnfstmt * cnfstmtNewCall(es_str_t *name);
+struct cnfstmt * cnfstmtNewCallIndirect(struct cnfexpr *expr);
 struct cnfstmt * cnfstmtNewContinue(void);
 struct cnfstmt * cnfstmtNewReloadLookupTable(struct cnffparamlst *fparams);
 void cnfstmtDestructLst(struct cnfstmt *root);
 void cnfstmtOptimize(struct cnfstmt *root);
+int cnfstmtSwitchSelect(struct cnfstmt *stmt, void *usrptr, wti_t *pWti, int after);
 struct cnfarray* cnfarrayNew(es_str_t *val);
 struct cnfarray* cnfarrayDup(struct cnfarray *old);
 struct cnfarray* cnfarrayAdd(struct cnfarray *ar, es_str_t *val);
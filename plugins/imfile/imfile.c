@@ -36,6 +36,7 @@
 #include <glob.h>
 #include <poll.h>
 #include <fnmatch.h>
+#include <ctype.h>
 #ifdef HAVE_SYS_INOTIFY_H
 #include <sys/inotify.h>
 #include <linux/types.h>
@@ -61,6 +62,7 @@
 #include "stringbuf.h"
 #include "ruleset.h"
 #include "ratelimit.h"
+#include "hashtable.h"
 
 #include <regex.h> // TODO: fix via own module
 
@@ -80,6 +82,8 @@ DEFobjCurrIf(ruleset)
 static int bLegacyCnfModGlobalsPermitted;/* are legacy module-global config parameters permitted? */
 
 #define NUM_MULTISUB 1024 /* default max number of submits */
+#define BULKLOAD_NUM_MULTISUB 16384 /* default max number of submits in bulk load mode */
+#define BULKLOAD_IOBUF_SIZE (1024*1024) /* read buffer size in bulk load mode */
 #define DFLT_PollInterval 10
 
 #define INIT_FILE_TAB_SIZE 4 /* default file table size - is extended as needed, use 2^x value */
@@ -131,6 +135,7 @@ typedef struct lstn_s {
 	sbool discardTruncatedMsg;
 	sbool msgDiscardingError;
 	regex_t end_preg;	/* compiled version of startRegex */
+	strmStartMatch_t *startMatch; /* octet-check version of startRegex (NULL if not possible) */
 	uchar *prevLineSegment;	/* previous line segment (in regex mode) */
 	sbool escapeLF;	/* escape LF inside the MSG content? */
 	sbool reopenOnTruncate;
@@ -138,6 +143,7 @@ typedef struct lstn_s {
 	sbool addCeeTag;
 	sbool freshStartTail; /* read from tail of file on fresh start? */
 	sbool fileNotFoundError;
+	sbool bBulkLoad;	/* read existing data as fast as possible (no fairness, large reads)? */
 	ruleset_t *pRuleset;	/* ruleset to bind listener to (use system default if unspecified) */
 	ratelimit_t *ratelimiter;
 	multi_submit_t multiSub;
@@ -188,6 +194,7 @@ struct instanceConf_s {
 	sbool addMetadata;
 	sbool freshStartTail;
 	sbool fileNotFoundError;
+	sbool bBulkLoad;
 	int maxLinesAtOnce;
 	uint32_t trimLineOverBytes;
 	ruleset_t *pBindRuleset;	/* ruleset to bind listener to (use system default if unspecified) */
@@ -216,6 +223,7 @@ struct modConfData_s {
 	uint8_t opMode;
 	sbool configSetViaV2Method;
 	sbool haveReadTimeouts;	/* use special processing if read timeouts exist */
+	uchar *pszStateDB;	/* name of state database, NULL: use one state file per file */
 };
 static modConfData_t *loadModConf = NULL;/* modConf ptr to use for the current load process */
 static modConfData_t *runModConf = NULL;/* modConf ptr to use for the current load process */
@@ -316,7 +324,8 @@ static struct cnfparamdescr modpdescr[] = {
 	{ "pollinginterval", eCmdHdlrPositiveInt, 0 },
 	{ "readtimeout", eCmdHdlrPositiveInt, 0 },
 	{ "timeoutgranularity", eCmdHdlrPositiveInt, 0 },
-	{ "mode", eCmdHdlrGetWord, 0 }
+	{ "mode", eCmdHdlrGetWord, 0 },
+	{ "statedatabase", eCmdHdlrString, 0 }
 };
 static struct cnfparamblk modpblk =
 	{ CNFPARAMBLK_VERSION,
@@ -348,7 +357,8 @@ static struct cnfparamdescr inppdescr[] = {
 	{ "statefile", eCmdHdlrString, CNFPARAM_DEPRECATED },
 	{ "readtimeout", eCmdHdlrPositiveInt, 0 },
 	{ "freshstarttail", eCmdHdlrBinary, 0},
-	{ "filenotfounderror", eCmdHdlrBinary, 0}
+	{ "filenotfounderror", eCmdHdlrBinary, 0},
+	{ "bulkload", eCmdHdlrBinary, 0}
 };
 static struct cnfparamblk inppblk =
 	{ CNFPARAMBLK_VERSION,
@@ -565,6 +575,479 @@ getStateFileName(lstn_t *const __restrict__ pLstn,
 }
 
 
+/* --- support for the state database --------------------------------------
+ * If module parameter "stateDatabase" is set, the state of all monitored
+ * files is kept in this single file inside the work directory, instead of
+ * in one state file per monitored file. For each file, only the inode and
+ * the offset of the first not yet processed message are recorded. Restarting
+ * from that offset also re-reads partial multi-line messages, so nothing else
+ * needs to be persisted.
+ * The database is an append-only log. Updates are collected in memory and
+ * appended with a single write (and sync) per processing cycle. When the log
+ * has grown well beyond the number of live entries, it is compacted by writing
+ * a new log and renaming it over the old one. A record torn by a crash is
+ * detected on load and everything from it on is ignored.
+ * Record format (the name is length-prefixed, so it may contain any byte):
+ *	s <inode> <offset> <namelen> <name>\n	set state for name
+ *	d <namelen> <name>\n			delete state for name
+ * Note: all of this is only accessed by the input thread, so no locking needed.
+ */
+#define STATEDB_COMPACT_SLACK 1024 /* extra records permitted before compaction */
+
+typedef struct stateDBEntry_s {
+	uchar *pszName;		/* key in hashtable, owned by it */
+	int64 inode;
+	int64 offs;
+	sbool bDeleted;		/* deletion not yet written */
+	sbool bDirty;		/* needs to be written */
+	struct stateDBEntry_s *pNext, *pPrev;	/* list of all entries */
+	struct stateDBEntry_s *pNextDirty;
+} stateDBEntry_t;
+
+static struct {
+	struct hashtable *ht;	/* name -> entry */
+	stateDBEntry_t *pRoot;	/* all entries */
+	stateDBEntry_t *pDirtyRoot;
+	uchar *pszFullName;
+	int fd;
+	unsigned nLive;		/* entries not deleted */
+	unsigned nRecords;	/* records in the on-disk log */
+	sbool bNeedCompact;	/* on-disk log may be damaged (write error), compact on next flush */
+} stateDB = { NULL, NULL, NULL, NULL, -1, 0, 0, 0 };
+
+#undef SYNCCALL
+#if defined(HAVE_FDATASYNC) && !defined(__APPLE__)
+#	define SYNCCALL(x) fdatasync(x)
+#else
+#	define SYNCCALL(x) fsync(x)
+#endif
+
+static void
+stateDBMarkDirty(stateDBEntry_t *const etry)
+{
+	if(!etry->bDirty) {
+		etry->bDirty = 1;
+		etry->pNextDirty = stateDB.pDirtyRoot;
+		stateDB.pDirtyRoot = etry;
+	}
+}
+
+/* finally remove an entry, must not be on the dirty list */
+static void
+stateDBRemoveEntry(stateDBEntry_t *const etry)
+{
+	if(etry->pPrev == NULL)
+		stateDB.pRoot = etry->pNext;
+	else
+		etry->pPrev->pNext = etry->pNext;
+	if(etry->pNext != NULL)
+		etry->pNext->pPrev = etry->pPrev;
+	hashtable_remove(stateDB.ht, etry->pszName); /* also frees the name */
+	free(etry);
+}
+
+/* set (or, if bDelete, delete) the state for the given name. If bMarkDirty
+ * is not set, the change is not written (used when loading the database).
+ */
+static rsRetVal
+stateDBUpdate(const uchar *const pszName, const int64 inode, const int64 offs,
+	const sbool bDelete, const sbool bMarkDirty)
+{
+	stateDBEntry_t *etry;
+	uchar *key;
+	DEFiRet;
+
+	etry = hashtable_search(stateDB.ht, (void*) pszName);
+	if(bDelete) {
+		if(etry == NULL || etry->bDeleted)
+			FINALIZE;
+		--stateDB.nLive;
+		if(bMarkDirty) {
+			etry->bDeleted = 1;
+			stateDBMarkDirty(etry);
+		} else {
+			stateDBRemoveEntry(etry);
+		}
+		FINALIZE;
+	}
+
+	if(etry == NULL) {
+		CHKmalloc(etry = calloc(1, sizeof(stateDBEntry_t)));
+		if((key = ustrdup(pszName)) == NULL) {
+			free(etry);
+			ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+		}
+		if(!hashtable_insert(stateDB.ht, key, etry)) {
+			free(key);
+			free(etry);
+			ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+		}
+		etry->pszName = key;
+		etry->pNext = stateDB.pRoot;
+		if(stateDB.pRoot != NULL)
+			stateDB.pRoot->pPrev = etry;
+		stateDB.pRoot = etry;
+		++stateDB.nLive;
+	} else if(etry->bDeleted) {
+		etry->bDeleted = 0;
+		++stateDB.nLive;
+	}
+	etry->inode = inode;
+	etry->offs = offs;
+	if(bMarkDirty)
+		stateDBMarkDirty(etry);
+
+finalize_it:
+	RETiRet;
+}
+
+static rsRetVal
+stateDBAppendRecord(cstr_t *const pCStr, const stateDBEntry_t *const etry)
+{
+	char numbuf[80];
+	const size_t lenName = ustrlen(etry->pszName);
+	DEFiRet;
+
+	if(etry->bDeleted) {
+		snprintf(numbuf, sizeof(numbuf), "d %zu ", lenName);
+	} else {
+		snprintf(numbuf, sizeof(numbuf), "s %lld %lld %zu ",
+			(long long) etry->inode, (long long) etry->offs, lenName);
+	}
+	CHKiRet(rsCStrAppendStrWithLen(pCStr, (uchar*) numbuf, strlen(numbuf)));
+	CHKiRet(rsCStrAppendStrWithLen(pCStr, etry->pszName, lenName));
+	CHKiRet(cstrAppendChar(pCStr, '\n'));
+
+finalize_it:
+	RETiRet;
+}
+
+static rsRetVal
+stateDBWriteAll(const int fd, cstr_t *const pCStr)
+{
+	const uchar *const buf = rsCStrGetBufBeg(pCStr);
+	const size_t len = cstrLen(pCStr);
+	size_t i;
+	ssize_t r;
+	DEFiRet;
+
+	for(i = 0 ; i < len ; i += r) {
+		r = write(fd, buf + i, len - i);
+		if(r == -1) {
+			if(errno != EINTR)
+				ABORT_FINALIZE(RS_RET_IO_ERROR);
+			r = 0;
+		}
+	}
+	if(SYNCCALL(fd) != 0)
+		ABORT_FINALIZE(RS_RET_IO_ERROR);
+
+finalize_it:
+	RETiRet;
+}
+
+/* the on-disk state now matches the in-memory one: clear dirty list and
+ * drop deleted entries.
+ */
+static void
+stateDBClearDirty(void)
+{
+	stateDBEntry_t *etry, *del;
+
+	for(etry = stateDB.pDirtyRoot ; etry != NULL ; ) {
+		del = etry;
+		etry = etry->pNextDirty;
+		del->bDirty = 0;
+		del->pNextDirty = NULL;
+		if(del->bDeleted)
+			stateDBRemoveEntry(del);
+	}
+	stateDB.pDirtyRoot = NULL;
+}
+
+/* write a new log containing only the live entries and atomically replace
+ * the current one with it.
+ */
+static rsRetVal
+stateDBCompact(void)
+{
+	uchar tmpName[MAXFNAME];
+	stateDBEntry_t *etry;
+	cstr_t *pCStr = NULL;
+	int fd = -1;
+	DEFiRet;
+
+	snprintf((char*) tmpName, sizeof(tmpName), "%s.tmp", stateDB.pszFullName);
+	CHKiRet(rsCStrConstruct(&pCStr));
+	for(etry = stateDB.pRoot ; etry != NULL ; etry = etry->pNext) {
+		if(!etry->bDeleted)
+			CHKiRet(stateDBAppendRecord(pCStr, etry));
+	}
+	if((fd = open((char*) tmpName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)) == -1)
+		ABORT_FINALIZE(RS_RET_IO_ERROR);
+	CHKiRet(stateDBWriteAll(fd, pCStr));
+	close(fd);
+	fd = -1;
+	if(rename((char*) tmpName, (char*) stateDB.pszFullName) != 0)
+		ABORT_FINALIZE(RS_RET_IO_ERROR);
+
+	if(stateDB.fd != -1)
+		close(stateDB.fd);
+	stateDB.fd = open((char*) stateDB.pszFullName, O_WRONLY | O_APPEND | O_CLOEXEC);
+	if(stateDB.fd == -1)
+		ABORT_FINALIZE(RS_RET_IO_ERROR);
+	stateDB.nRecords = stateDB.nLive;
+	stateDB.bNeedCompact = 0;
+	stateDBClearDirty();
+	DBGPRINTF("imfile: state database '%s' compacted, %u entries\n",
+		stateDB.pszFullName, stateDB.nLive);
+
+finalize_it:
+	if(iRet != RS_RET_OK) {
+		LogError(errno, iRet, "imfile: could not write state database '%s'",
+			stateDB.pszFullName);
+		if(fd != -1) {
+			close(fd);
+			unlink((char*) tmpName);
+		}
+	}
+	if(pCStr != NULL)
+		rsCStrDestruct(&pCStr);
+	RETiRet;
+}
+
+/* write all pending updates to the state database. This is called once
+ * per processing cycle, so that updates for many files are written together.
+ */
+static void
+stateDBFlush(void)
+{
+	stateDBEntry_t *etry;
+	cstr_t *pCStr = NULL;
+	unsigned nNew = 0;
+	rsRetVal localRet;
+
+	if(stateDB.ht == NULL || stateDB.pDirtyRoot == NULL)
+		return;
+
+	if(stateDB.bNeedCompact || stateDB.fd == -1
+	   || stateDB.nRecords > 2 * stateDB.nLive + STATEDB_COMPACT_SLACK) {
+		stateDBCompact();
+		return;
+	}
+
+	if(rsCStrConstruct(&pCStr) != RS_RET_OK)
+		return;
+	for(etry = stateDB.pDirtyRoot ; etry != NULL ; etry = etry->pNextDirty) {
+		if(stateDBAppendRecord(pCStr, etry) != RS_RET_OK)
+			goto done;
+		++nNew;
+	}
+	localRet = stateDBWriteAll(stateDB.fd, pCStr);
+	if(localRet == RS_RET_OK) {
+		stateDB.nRecords += nNew;
+		stateDBClearDirty();
+	} else {
+		/* a partial record may have been written, which would hide all
+		 * later ones - so we rewrite the database on the next try.
+		 */
+		LogError(errno, localRet, "imfile: could not write state database '%s'",
+			stateDB.pszFullName);
+		stateDB.bNeedCompact = 1;
+	}
+done:
+	rsCStrDestruct(&pCStr);
+}
+
+/* parse a decimal number followed by a single space */
+static int
+stateDBParseNum(const uchar **const pp, const uchar *const pEnd, int64 *const pVal)
+{
+	const uchar *p = *pp;
+	int64 val = 0;
+
+	if(p == pEnd || !isdigit(*p))
+		return 0;
+	while(p < pEnd && isdigit(*p)) {
+		val = val * 10 + (*p - '0');
+		++p;
+	}
+	if(p == pEnd || *p != ' ')
+		return 0;
+	*pp = p + 1;
+	*pVal = val;
+	return 1;
+}
+
+/* parse the database file content, apply all complete records */
+static rsRetVal
+stateDBParse(const uchar *p, const uchar *const pEnd)
+{
+	int64 inode = 0, offs = 0, lenName;
+	uchar *pszName;
+	sbool bDelete;
+	DEFiRet;
+
+	while(p < pEnd) {
+		if(pEnd - p < 2 || (*p != 's' && *p != 'd') || p[1] != ' ')
+			break;
+		bDelete = (*p == 'd');
+		p += 2;
+		if(!bDelete) {
+			if(!stateDBParseNum(&p, pEnd, &inode) || !stateDBParseNum(&p, pEnd, &offs))
+				break;
+		}
+		if(!stateDBParseNum(&p, pEnd, &lenName) || lenName == 0
+		   || lenName >= pEnd - p || p[lenName] != '\n')
+			break;
+		CHKmalloc(pszName = malloc(lenName + 1));
+		memcpy(pszName, p, lenName);
+		pszName[lenName] = '\0';
+		iRet = stateDBUpdate(pszName, inode, offs, bDelete, 0);
+		free(pszName);
+		CHKiRet(iRet);
+		p += lenName + 1;
+		++stateDB.nRecords;
+	}
+	if(p < pEnd) {
+		LogMsg(0, RS_RET_OK, LOG_WARNING, "imfile: state database '%s' has an incomplete "
+			"or damaged record at its end (probably caused by a crash) - ignored",
+			stateDB.pszFullName);
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+/* open the state database and load its content. It is compacted right away,
+ * which also removes a possibly torn last record from the log.
+ */
+static rsRetVal
+stateDBOpen(const uchar *const pszName)
+{
+	uchar fullName[MAXFNAME];
+	struct stat stat_buf;
+	uchar *buf = NULL;
+	ssize_t r;
+	size_t len = 0;
+	int fd = -1;
+	DEFiRet;
+
+	getFullStateFileName((uchar*) pszName, fullName, sizeof(fullName));
+	CHKmalloc(stateDB.pszFullName = ustrdup(fullName));
+	CHKmalloc(stateDB.ht = create_hashtable(100, hash_from_string, key_equals_string, NULL));
+
+	if((fd = open((char*) fullName, O_RDONLY | O_CLOEXEC)) == -1) {
+		if(errno != ENOENT) {
+			LogError(errno, RS_RET_IO_ERROR, "imfile: could not open state "
+				"database '%s'", fullName);
+			ABORT_FINALIZE(RS_RET_IO_ERROR);
+		}
+		DBGPRINTF("imfile: no state database '%s' exists, starting fresh\n", fullName);
+	} else {
+		if(fstat(fd, &stat_buf) == -1)
+			ABORT_FINALIZE(RS_RET_IO_ERROR);
+		CHKmalloc(buf = malloc(stat_buf.st_size + 1));
+		while(len < (size_t) stat_buf.st_size) {
+			r = read(fd, buf + len, stat_buf.st_size - len);
+			if(r == -1 && errno == EINTR)
+				continue;
+			if(r <= 0)
+				break;
+			len += r;
+		}
+		CHKiRet(stateDBParse(buf, buf + len));
+		DBGPRINTF("imfile: state database '%s' loaded, %u records, %u entries\n",
+			fullName, stateDB.nRecords, stateDB.nLive);
+	}
+	/* on failure, the error is reported and we retry on next flush */
+	stateDBCompact();
+
+finalize_it:
+	if(fd != -1)
+		close(fd);
+	free(buf);
+	RETiRet;
+}
+
+static void
+stateDBClose(void)
+{
+	stateDBEntry_t *etry, *del;
+
+	if(stateDB.ht == NULL)
+		return;
+	stateDBFlush();
+	for(etry = stateDB.pRoot ; etry != NULL ; ) {
+		del = etry;
+		etry = etry->pNext;
+		free(del);
+	}
+	hashtable_destroy(stateDB.ht, 0); /* entries already freed */
+	if(stateDB.fd != -1)
+		close(stateDB.fd);
+	free(stateDB.pszFullName);
+	stateDB.ht = NULL;
+	stateDB.pRoot = NULL;
+	stateDB.pDirtyRoot = NULL;
+	stateDB.pszFullName = NULL;
+	stateDB.fd = -1;
+	stateDB.nLive = stateDB.nRecords = 0;
+	stateDB.bNeedCompact = 0;
+}
+
+/* remove the state of a file, no matter which storage is used */
+static void
+removeState(uchar *const statefn)
+{
+	uchar toDel[MAXFNAME];
+
+	if(stateDB.ht != NULL) {
+		stateDBUpdate(statefn, 0, 0, 1, 1);
+		return;
+	}
+	getFullStateFileName(statefn, toDel, sizeof(toDel));
+	DBGPRINTF("unlinking '%s'\n", toDel);
+	if(unlink((char*)toDel) != 0 && errno != ENOENT) {
+		LogError(errno, RS_RET_ERR, "imfile: could not remove state "
+			"file '%s'", toDel);
+	}
+}
+/* move the state of a file to a new name, no matter which storage is used */
+static void
+renameState(uchar *const statefn_old, uchar *const statefn_new)
+{
+	uchar statefilefull_old[MAXFNAME];
+	uchar statefilefull_new[MAXFNAME];
+	stateDBEntry_t *etry;
+
+	if(stateDB.ht != NULL) {
+		etry = hashtable_search(stateDB.ht, statefn_old);
+		if(etry != NULL && !etry->bDeleted) {
+			DBGPRINTF("state database entry '%s' moved to '%s'\n", statefn_old, statefn_new);
+			stateDBUpdate(statefn_new, etry->inode, etry->offs, 0, 1);
+			stateDBUpdate(statefn_old, 0, 0, 1, 1);
+		}
+		return;
+	}
+
+	getFullStateFileName(statefn_new, statefilefull_new, sizeof(statefilefull_new));
+	getFullStateFileName(statefn_old, statefilefull_old, sizeof(statefilefull_old));
+
+	DBGPRINTF("old statefile '%s' needs to be moved to '%s' first!\n",
+	statefilefull_old, statefilefull_new);
+
+	if(rename((char*) &statefilefull_old, (char*) &statefilefull_new) != 0) {
+		LogError(errno, RS_RET_ERR, "imfile: could not rename statefile "
+			"'%s' into '%s'", statefilefull_old, statefilefull_new);
+	} else {
+		DBGPRINTF("statefile '%s' renamed into '%s'\n", statefilefull_old,
+			statefilefull_new);
+	}
+}
+/* --- end support for the state database ---------------------------------- */
+
+
 /* enqueue the read file line as a message. The provided string is
  * not freed - this must be done by the caller.
  */
@@ -617,6 +1100,26 @@ finalize_it:
 }
 
 
+/* set the listener-specific stream properties that must be applied before
+ * the stream is finalized. Also used as fixup when the stream is read from
+ * the state file.
+ * In bulk load mode, we use a large read buffer and tell the OS that we
+ * read sequentially, so that historical files are read at full disk speed
+ * instead of in small chunks.
+ */
+static rsRetVal ATTR_NONNULL(1, 2)
+setStrmPreFinalizeParams(strm_t *const pStrm, lstn_t *const pLstn)
+{
+	DEFiRet;
+	if(pLstn->bBulkLoad) {
+		CHKiRet(strm.SetsIOBufSize(pStrm, BULKLOAD_IOBUF_SIZE));
+		CHKiRet(strm.SetbSequentialRead(pStrm, 1));
+	}
+finalize_it:
+	RETiRet;
+}
+
+
 /* try to open a file which has a state file. If the state file does not
  * exist or cannot be read, an error is returned.
  */
@@ -661,7 +1164,8 @@ openFileWithStateFile(lstn_t *const __restrict__ pLstn)
 	CHKiRet(strm.ConstructFinalize(psSF));
 
 	/* read back in the object */
-	CHKiRet(obj.Deserialize(&pLstn->pStrm, (uchar*) "strm", psSF, NULL, pLstn));
+	CHKiRet(obj.Deserialize(&pLstn->pStrm, (uchar*) "strm", psSF,
+		(rsRetVal(*)(obj_t*,void*))setStrmPreFinalizeParams, pLstn));
 	DBGPRINTF("deserialized state file, state file base name '%s', "
 		  "configured base name '%s'\n", pLstn->pStrm->pszFName,
 		  pLstn->pszFileName);
@@ -696,17 +1200,12 @@ finalize_it:
 	RETiRet;
 }
 
-/* try to open a file for which no state file exists. This function does NOT
- * check if a state file actually exists or not -- this must have been
- * checked before calling it.
- */
+/* construct a fresh stream for the monitored file, positioned at its beginning */
 static rsRetVal
-openFileWithoutStateFile(lstn_t *const __restrict__ pLstn)
+constructLstnStrm(lstn_t *const __restrict__ pLstn)
 {
 	DEFiRet;
-	struct stat stat_buf;
 
-	DBGPRINTF("clean startup withOUT state file for '%s'\n", pLstn->pszFileName);
 	if(pLstn->pStrm != NULL)
 		strm.Destruct(&pLstn->pStrm);
 	CHKiRet(strm.Construct(&pLstn->pStrm));
@@ -714,8 +1213,69 @@ openFileWithoutStateFile(lstn_t *const __restrict__ pLstn)
 	CHKiRet(strm.SetsType(pLstn->pStrm, STREAMTYPE_FILE_MONITOR));
 	CHKiRet(strm.SetFName(pLstn->pStrm, pLstn->pszFileName, strlen((char*) pLstn->pszFileName)));
 	CHKiRet(strm.SetFileNotFoundError(pLstn->pStrm, pLstn->fileNotFoundError));
+	CHKiRet(setStrmPreFinalizeParams(pLstn->pStrm, pLstn));
 	CHKiRet(strm.ConstructFinalize(pLstn->pStrm));
 
+finalize_it:
+	RETiRet;
+}
+
+
+/* try to open a file whose state is kept in the state database. If there is
+ * no entry for the file, RS_RET_FILE_NOT_FOUND is returned. If the entry
+ * belongs to a different file (inode changed) or the file has been truncated,
+ * the entry is ignored and reading starts at the begin of the file.
+ */
+static rsRetVal ATTR_NONNULL(1)
+openFileWithStateDB(lstn_t *const __restrict__ pLstn)
+{
+	DEFiRet;
+	struct stat stat_buf;
+	stateDBEntry_t *etry;
+	uchar statefile[MAXFNAME];
+
+	uchar *const statefn = getStateFileName(pLstn, statefile, sizeof(statefile), NULL);
+	etry = hashtable_search(stateDB.ht, statefn);
+	if(etry == NULL || etry->bDeleted) {
+		DBGPRINTF("no state database entry '%s' exists for '%s'\n", statefn, pLstn->pszFileName);
+		ABORT_FINALIZE(RS_RET_FILE_NOT_FOUND);
+	}
+
+	CHKiRet(constructLstnStrm(pLstn));
+	if(stat((char*) pLstn->pszFileName, &stat_buf) == -1) {
+		DBGPRINTF("state database: cannot stat '%s', starting at begin of file\n",
+			pLstn->pszFileName);
+	} else if(etry->inode != 0 && (int64) stat_buf.st_ino != etry->inode) {
+		DBGPRINTF("state database: '%s' has new inode, starting at begin of file\n",
+			pLstn->pszFileName);
+	} else if(etry->offs > (int64) stat_buf.st_size) {
+		DBGPRINTF("state database: '%s' was truncated, starting at begin of file\n",
+			pLstn->pszFileName);
+	} else {
+		DBGPRINTF("state database: resuming '%s' at offset %lld\n",
+			pLstn->pszFileName, (long long) etry->offs);
+		pLstn->pStrm->iCurrOffs = etry->offs;
+		CHKiRet(strm.SeekCurrOffs(pLstn->pStrm));
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* try to open a file for which no state file exists. This function does NOT
+ * check if a state file actually exists or not -- this must have been
+ * checked before calling it.
+ */
+static rsRetVal
+openFileWithoutStateFile(lstn_t *const __restrict__ pLstn)
+{
+	DEFiRet;
+	struct stat stat_buf;
+
+	DBGPRINTF("clean startup withOUT state file for '%s'\n", pLstn->pszFileName);
+	CHKiRet(constructLstnStrm(pLstn));
+
 	/* As a state file not exist, this is a fresh start. seek to file end
 	 * when freshStartTail is on.
 	 */
@@ -738,14 +1298,21 @@ openFile(lstn_t *const __restrict__ pLstn)
 {
 	DEFiRet;
 
-	CHKiRet_Hdlr(openFileWithStateFile(pLstn)) {
-		CHKiRet(openFileWithoutStateFile(pLstn));
+	if(stateDB.ht != NULL) {
+		CHKiRet_Hdlr(openFileWithStateDB(pLstn)) {
+			CHKiRet(openFileWithoutStateFile(pLstn));
+		}
+	} else {
+		CHKiRet_Hdlr(openFileWithStateFile(pLstn)) {
+			CHKiRet(openFileWithoutStateFile(pLstn));
+		}
 	}
 
 	DBGPRINTF("breopenOnTruncate %d for '%s'\n",
 		pLstn->reopenOnTruncate, pLstn->pszFileName);
 	CHKiRet(strm.SetbReopenOnTruncate(pLstn->pStrm, pLstn->reopenOnTruncate));
 	strmSetReadTimeout(pLstn->pStrm, pLstn->readTimeout);
+	strmSetStartMatch(pLstn->pStrm, pLstn->startMatch);
 
 finalize_it:
 	RETiRet;
@@ -858,6 +1425,7 @@ createInstance(instanceConf_t **const pinst)
 	inst->addCeeTag = 0;
 	inst->freshStartTail = 0;
 	inst->fileNotFoundError = 1;
+	inst->bBulkLoad = 0;
 	inst->readTimeout = loadModConf->readTimeout;
 
 	/* node created, let's add to config */
@@ -1074,8 +1642,10 @@ lstnDel(lstn_t *pLstn)
 	free(pLstn->pszTag);
 	free(pLstn->pszStateFile);
 	free(pLstn->pszBaseName);
-	if(pLstn->startRegex != NULL)
+	if(pLstn->startRegex != NULL) {
 		regfree(&pLstn->end_preg);
+		free(pLstn->startMatch);
+	}
 #ifdef HAVE_INOTIFY_INIT
 	if (pLstn->movedfrom_statefile != NULL)
 		free(pLstn->movedfrom_statefile);
@@ -1147,11 +1717,13 @@ addListner(instanceConf_t *const inst)
 	pThis->multiSub.nElem = 0;
 	pThis->iSeverity = inst->iSeverity;
 	pThis->iFacility = inst->iFacility;
-	pThis->maxLinesAtOnce = inst->maxLinesAtOnce;
+	/* bulk load reads each file to its end, without fairness limit */
+	pThis->maxLinesAtOnce = inst->bBulkLoad ? 0 : inst->maxLinesAtOnce;
 	pThis->trimLineOverBytes = inst->trimLineOverBytes;
 	pThis->iPersistStateInterval = inst->iPersistStateInterval;
 	pThis->readMode = inst->readMode;
 	pThis->startRegex = inst->startRegex; /* no strdup, as it is read-only */
+	pThis->startMatch = NULL;
 	if(pThis->startRegex != NULL) {
 		const int errcode = regcomp(&pThis->end_preg, (char*)pThis->startRegex, REG_EXTENDED);
 		if(errcode != 0) {
@@ -1160,6 +1732,7 @@ addListner(instanceConf_t *const inst)
 			LogError(0, NO_ERRCODE, "imfile: %s\n", errbuff);
 			ABORT_FINALIZE(RS_RET_ERR);
 		}
+		CHKiRet(strmCompileStartMatch(pThis->startRegex, &pThis->startMatch));
 	}
 	pThis->discardTruncatedMsg = inst->discardTruncatedMsg;
 	pThis->msgDiscardingError = inst->msgDiscardingError;
@@ -1172,6 +1745,7 @@ addListner(instanceConf_t *const inst)
 	pThis->readTimeout = inst->readTimeout;
 	pThis->freshStartTail = inst->freshStartTail;
 	pThis->fileNotFoundError = inst->fileNotFoundError;
+	pThis->bBulkLoad = inst->bBulkLoad;
 	pThis->pRuleset = inst->pBindRuleset;
 	pThis->nRecords = 0;
 	pThis->pStrm = NULL;
@@ -1196,6 +1770,7 @@ BEGINnewInpInst
 	struct cnfparamvals *pvals;
 	instanceConf_t *inst;
 	int i;
+	sbool bMultiSubSet = 0;
 CODESTARTnewInpInst
 	DBGPRINTF("newInpInst (imfile)\n");
 
@@ -1265,8 +1840,11 @@ CODESTARTnewInpInst
 			inst->iPersistStateInterval = pvals[i].val.d.n;
 		} else if(!strcmp(inppblk.descr[i].name, "maxsubmitatonce")) {
 			inst->nMultiSub = pvals[i].val.d.n;
+			bMultiSubSet = 1;
 		} else if(!strcmp(inppblk.descr[i].name, "readtimeout")) {
 			inst->readTimeout = pvals[i].val.d.n;
+		} else if(!strcmp(inppblk.descr[i].name, "bulkload")) {
+			inst->bBulkLoad = (sbool) pvals[i].val.d.n;
 		} else {
 			DBGPRINTF("program error, non-handled "
 			  "param '%s'\n", inppblk.descr[i].name);
@@ -1278,6 +1856,8 @@ CODESTARTnewInpInst
 			"at the same time --- remove one of them");
 			ABORT_FINALIZE(RS_RET_PARAM_NOT_PERMITTED);
 	}
+	if(inst->bBulkLoad && !bMultiSubSet)
+		inst->nMultiSub = BULKLOAD_NUM_MULTISUB;
 	if(inst->readTimeout != 0)
 		loadModConf->haveReadTimeouts = 1;
 	iRet = checkInstance(inst);
@@ -1297,6 +1877,7 @@ CODESTARTbeginCnfLoad
 	loadModConf->readTimeout = 0; /* default: no timeout */
 	loadModConf->timeoutGranularity = 1000; /* default: 1 second */
 	loadModConf->haveReadTimeouts = 0; /* default: no timeout */
+	loadModConf->pszStateDB = NULL; /* default: one state file per monitored file */
 	bLegacyCnfModGlobalsPermitted = 1;
 	/* init legacy config vars */
 	cs.pszFileName = NULL;
@@ -1344,6 +1925,8 @@ CODESTARTsetModCnf
 		} else if(!strcmp(modpblk.descr[i].name, "timeoutgranularity")) {
 			/* note: we need ms, thus "* 1000" */
 			loadModConf->timeoutGranularity = (int) pvals[i].val.d.n * 1000;
+		} else if(!strcmp(modpblk.descr[i].name, "statedatabase")) {
+			loadModConf->pszStateDB = (uchar*) es_str2cstr(pvals[i].val.d.estr, NULL);
 		} else if(!strcmp(modpblk.descr[i].name, "mode")) {
 			if(!es_strconstcmp(pvals[i].val.d.estr, "polling"))
 				loadModConf->opMode = OPMODE_POLLING;
@@ -1453,6 +2036,7 @@ CODESTARTfreeCnf
 		inst = inst->next;
 		free(del);
 	}
+	free(pModConf->pszStateDB);
 ENDfreeCnf
 
 
@@ -1489,6 +2073,7 @@ doPolling(void)
 			}
 		} while(bHadFileData == 1 && glbl.GetGlobalInputTermState() == 0);
 		  /* warning: do...while()! */
+		stateDBFlush();
 
 		/* Note: the additional 10ns wait is vitally important. It guards rsyslog
 		 * against totally hogging the CPU if the users selects a polling interval
@@ -1897,11 +2482,14 @@ lstnDup(lstn_t ** ppExisting,
 	pThis->iPersistStateInterval = existing->iPersistStateInterval;
 	pThis->readMode = existing->readMode;
 	pThis->startRegex = existing->startRegex; /* no strdup, as it is read-only */
-	if(pThis->startRegex != NULL) // TODO: make this a single function with better error handling
+	pThis->startMatch = NULL;
+	if(pThis->startRegex != NULL) { // TODO: make this a single function with better error handling
 		if(regcomp(&pThis->end_preg, (char*)pThis->startRegex, REG_EXTENDED)) {
 			DBGPRINTF("error regex compile\n");
 			ABORT_FINALIZE(RS_RET_ERR);
 		}
+		CHKiRet(strmCompileStartMatch(pThis->startRegex, &pThis->startMatch));
+	}
 	pThis->discardTruncatedMsg = existing->discardTruncatedMsg;
 	pThis->msgDiscardingError = existing->msgDiscardingError;
 	pThis->bRMStateOnDel = existing->bRMStateOnDel;
@@ -1913,6 +2501,7 @@ lstnDup(lstn_t ** ppExisting,
 	pThis->readTimeout = existing->readTimeout;
 	pThis->freshStartTail = existing->freshStartTail;
 	pThis->fileNotFoundError = existing->fileNotFoundError;
+	pThis->bBulkLoad = existing->bBulkLoad;
 	pThis->pRuleset = existing->pRuleset;
 	pThis->nRecords = 0;
 	pThis->pStrm = NULL;
@@ -2173,8 +2762,8 @@ in_removeFile(const int dirIdx, lstn_t *const __restrict__ pLstn, const sbool bR
 	DBGPRINTF("remove listener '%s', dirIdx %d\n", pLstn->pszFileName, dirIdx);
 	if(bRemoveStateFile == TRUE && pLstn->bRMStateOnDel) {
 		statefn = getStateFileName(pLstn, statefile, sizeof(statefile), NULL);
-		/* Get full path and file name */
-		getFullStateFileName(statefn, toDel, sizeof(toDel));
+		ustrncpy(toDel, statefn, sizeof(toDel) - 1);
+		toDel[sizeof(toDel) - 1] = '\0';
 		bDoRMState = 1;
 	} else {
 		bDoRMState = 0;
@@ -2185,11 +2774,7 @@ in_removeFile(const int dirIdx, lstn_t *const __restrict__ pLstn, const sbool bR
 	lstnDel(pLstn);
 	fileTableDelFile(&dirs[dirIdx].active, pLstn);
 	if(bDoRMState) {
-		DBGPRINTF("unlinking '%s'\n", toDel);
-		if(unlink((char*)toDel) != 0) {
-			LogError(errno, RS_RET_ERR, "imfile: could not remove state "
-				"file '%s'", toDel);
-		}
+		removeState(toDel);
 	}
 
 	wd = wdmapLookupListner(pLstn);
@@ -2226,8 +2811,6 @@ in_handleDirEventFileCREATE(struct inotify_event *const ev, const int dirIdx)
 	int ftIdx;
 	char fullfn[MAXFNAME];
 	uchar statefile_new[MAXFNAME];
-	uchar statefilefull_old[MAXFNAME];
-	uchar statefilefull_new[MAXFNAME];
 	uchar* pszDir = NULL;
 	int dirIdxFinal = dirIdx;
 	ftIdx = fileTableSearch(&dirs[dirIdxFinal].active, (uchar*)ev->name);
@@ -2296,21 +2879,7 @@ in_handleDirEventFileCREATE(struct inotify_event *const ev, const int dirIdx)
 				snprintf(fullfn, MAXFNAME, "%s/%s", (pszDir == NULL) ? dirs[dirIdxFinal].dirName
 					: pszDir, (uchar*)ev->name);
 				getStateFileName(NULL, statefile_new, sizeof(statefile_new), (uchar*)fullfn);
-				getFullStateFileName(statefile_new, statefilefull_new, sizeof(statefilefull_new));
-				getFullStateFileName(pLstn->movedfrom_statefile, statefilefull_old,
-					sizeof(statefilefull_old));
-
-				DBGPRINTF("old statefile '%s' needs to be moved to '%s' first!\n",
-				statefilefull_old, statefilefull_new);
-
-//				openStateFileAndMigrate(pLstn, &statefilefull_old[0], &statefilefull_new[0]);
-				if(rename((char*) &statefilefull_old, (char*) &statefilefull_new) != 0) {
-					LogError(errno, RS_RET_ERR, "imfile: could not rename statefile "
-						"'%s' into '%s'", statefilefull_old, statefilefull_new);
-				} else {
-					DBGPRINTF("statefile '%s' renamed into '%s'\n", statefilefull_old,
-						statefilefull_new);
-				}
+				renameState(pLstn->movedfrom_statefile, statefile_new);
 
 				/* Free statefile memory */
 				free(pLstn->movedfrom_statefile);
@@ -2553,6 +3122,7 @@ dbgprintf("post setuInitialWatches\n");
 			} while(r  == -1 && errno == EINTR);
 			if(r == 0) {
 				in_do_timeout_processing();
+				stateDBFlush();
 				continue;
 			} else if (r == -1) {
 				LogError(errno, RS_RET_INTERNAL_ERROR,
@@ -2585,6 +3155,7 @@ dbgprintf("post setuInitialWatches\n");
 			in_processEvent(ev);
 			currev += sizeof(struct inotify_event) + ev->len;
 		}
+		stateDBFlush();
 	}
 
 finalize_it:
@@ -2638,7 +3209,6 @@ fen_printevent(int event)
 static rsRetVal ATTR_NONNULL(1)
 fen_removeFile(lstn_t *pLstn)
 {
-	struct stat statFile;
 	uchar statefile[MAXFNAME];
 	uchar toDel[MAXFNAME];
 	int bDoRMState;
@@ -2658,8 +3228,8 @@ fen_removeFile(lstn_t *pLstn)
 
 	if(pLstn->bRMStateOnDel) {
 		statefn = getStateFileName(pLstn, statefile, sizeof(statefile), NULL);
-		/* Get full path and file name */
-		getFullStateFileName(statefn, toDel, sizeof(toDel));
+		ustrncpy(toDel, statefn, sizeof(toDel) - 1);
+		toDel[sizeof(toDel) - 1] = '\0';
 		bDoRMState = 1;
 	} else {
 		bDoRMState = 0;
@@ -2680,11 +3250,7 @@ fen_removeFile(lstn_t *pLstn)
 	}
 
 	if(bDoRMState) {
-		DBGPRINTF("fen_removeFile unlinking '%s'\n", toDel);
-		if((stat((const char*) toDel, &statFile) == 0) && unlink((char*)toDel) != 0) {
-			LogError(errno, RS_RET_ERR, "fen_removeFile: could not remove state "
-				"file \"%s\": %s", toDel);
-		}
+		removeState(toDel);
 	}
 finalize_it:
 	RETiRet;
@@ -3109,6 +3675,7 @@ do_fen(void)
 						": %d\n", portEvent.portev_source);
 			}
 		}
+		stateDBFlush();
 
 		DBGPRINTF("do_fen loop end... \n");
 	}
@@ -3181,6 +3748,9 @@ CODESTARTwillRun
 	CHKiRet(prop.SetString(pInputName, UCHAR_CONSTANT("imfile"), sizeof("imfile") - 1));
 	CHKiRet(prop.ConstructFinalize(pInputName));
 
+	if(runModConf->pszStateDB != NULL)
+		CHKiRet(stateDBOpen(runModConf->pszStateDB));
+
 finalize_it:
 ENDwillRun
 
@@ -3198,6 +3768,14 @@ persistStrmState(lstn_t *pLstn)
 	uchar statefile[MAXFNAME];
 
 	uchar *const statefn = getStateFileName(pLstn, statefile, sizeof(statefile), NULL);
+	if(stateDB.ht != NULL) {
+		/* written to disk on next stateDBFlush() */
+		DBGPRINTF("persisting state for '%s' to state database, key '%s'\n",
+			  pLstn->pszFileName, statefn);
+		CHKiRet(stateDBUpdate(statefn, (int64) pLstn->pStrm->inode,
+			pLstn->pStrm->strtOffs, 0, 1));
+		FINALIZE;
+	}
 	DBGPRINTF("persisting state for '%s' to file '%s'\n",
 		  pLstn->pszFileName, statefn);
 	CHKiRet(strm.Construct(&psSF));
@@ -3238,6 +3816,7 @@ CODESTARTafterRun
 		/* Note: lstnDel() reasociates root! */
 		lstnDel(runModConf->pRootLstn);
 	}
+	stateDBClose();
 
 	if(pInputName != NULL)
 		prop.Destruct(&pInputName);
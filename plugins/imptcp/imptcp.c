@@ -290,6 +290,7 @@ struct ptcpsess_s {
 	prop_t *peerName;	/* host name we received messages from */
 	prop_t *peerIP;
 //--- END from tcps_sess.h
+	struct sender_stats_accum senderStats; /* for senders.keepTrack */
 };
 
 
@@ -371,6 +372,7 @@ destructSess(ptcpsess_t *pSess)
 {
 	free(pSess->pMsg);
 	free(pSess->epd);
+	statsSenderAccumExit(&pSess->senderStats);
 	prop.Destruct(&pSess->peerName);
 	prop.Destruct(&pSess->peerIP);
 	/* TODO: make these inits compile-time switch depending: */
@@ -1133,7 +1135,7 @@ DataRcvdUncompressed(ptcpsess_t *pThis, char *pData, size_t iLen, struct syslogT
 	iRet = multiSubmitFlush(&multiSub);
 
 	if(glblSenderKeepTrack)
-		statsRecordSender(propGetSzStr(pThis->peerName), nMsgs, ttGenTime);
+		statsAccumSender(propGetSzStr(pThis->peerName), &pThis->senderStats, nMsgs, ttGenTime);
 
 finalize_it:
 	RETiRet;
@@ -1357,6 +1359,7 @@ addSess(ptcplstn_t *pLstn, int sock, prop_t *peerName, prop_t *peerIP)
 	pSess->bAtStrtOfFram = 1;
 	pSess->peerName = peerName;
 	pSess->peerIP = peerIP;
+	statsSenderAccumInit(&pSess->senderStats);
 	pSess->compressionMode = pLstn->pSrv->compressionMode;
 
 	/* add to start of server's listener list */
@@ -112,6 +112,12 @@ struct instanceConf_s {
 	struct {
 		statsobj_t *stats;	/* listener stats */
 		STATSCOUNTER_DEF(ctrSubmit, mutCtrSubmit)
+		/* properties of the last sender, re-used as long as it does not
+		 * change. Safe without locking, as librelp calls us from the single
+		 * engine thread only.
+		 */
+		prop_t *pRcvFrom;
+		prop_t *pRcvFromIP;
 	} data;
 };
 
@@ -228,7 +234,6 @@ onAuthErr(void *pUsr, char *authinfo, char* errmesg, __attribute__((unused)) rel
 static relpRetVal
 onSyslogRcv(void *pUsr, uchar *pHostname, uchar *pIP, uchar *msg, size_t lenMsg)
 {
-	prop_t *pProp = NULL;
 	smsg_t *pMsg;
 	instanceConf_t *inst = (instanceConf_t*) pUsr;
 	DEFiRet;
@@ -240,11 +245,11 @@ onSyslogRcv(void *pUsr, uchar *pHostname, uchar *pIP, uchar *msg, size_t lenMsg)
 	MsgSetRuleset(pMsg, inst->pBindRuleset);
 	pMsg->msgFlags  = PARSE_HOSTNAME | NEEDS_PARSING;
 
-	/* TODO: optimize this, we can store it inside the session */
-	MsgSetRcvFromStr(pMsg, pHostname, ustrlen(pHostname), &pProp);
-	CHKiRet(prop.Destruct(&pProp));
-	CHKiRet(MsgSetRcvFromIPStr(pMsg, pIP, ustrlen(pIP), &pProp));
-	CHKiRet(prop.Destruct(&pProp));
+	/* messages of a session arrive in bursts, so the props of the previous
+	 * message can usually be re-used; only a changed sender needs new ones.
+	 */
+	MsgSetRcvFromStr(pMsg, pHostname, ustrlen(pHostname), &inst->data.pRcvFrom);
+	CHKiRet(MsgSetRcvFromIPStr(pMsg, pIP, ustrlen(pIP), &inst->data.pRcvFromIP));
 	CHKiRet(submitMsg2(pMsg));
 	STATSCOUNTER_INC(inst->data.ctrSubmit, inst->data.mutCtrSubmit);
 
@@ -285,6 +290,8 @@ createInstance(instanceConf_t **pinst)
 	inst->myCertFile = NULL;
 	inst->myPrivKeyFile = NULL;
 	inst->maxDataSize = glbl.GetMaxLine();
+	inst->data.pRcvFrom = NULL;
+	inst->data.pRcvFromIP = NULL;
 
 	/* node created, let's add to config */
 	if(loadModConf->tail == NULL) {
@@ -670,6 +677,10 @@ CODESTARTfreeCnf
 		free(inst->pristring);
 		free(inst->authmode);
 		prop.Destruct(&inst->pInputName);
+		if(inst->data.pRcvFrom != NULL)
+			prop.Destruct(&inst->data.pRcvFrom);
+		if(inst->data.pRcvFromIP != NULL)
+			prop.Destruct(&inst->data.pRcvFromIP);
 		statsobj.Destruct(&(inst->data.stats));
 		for(i = 0 ; i <  inst->permittedPeers.nmemb ; ++i) {
 			free(inst->permittedPeers.name[i]);
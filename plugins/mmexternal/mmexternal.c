@@ -448,6 +448,13 @@ tryRestart(wrkrInstanceData_t *pWrkrData)
  * note that we do not try to run block-free. If the users fears something
  * may block (and this not be acceptable), the action should be run on its
  * own action queue.
+ * Note that the exchange with the program is necessarily lock-step: the rule
+ * engine executes the complete script for one message before it processes
+ * the next message of the batch, so the modifications must be applied before
+ * doAction() returns. Writing further messages ahead of their replies
+ * (pipelining) is thus not possible. Parallelism is gained by running more
+ * worker threads, as each worker has its own instance of the program (unless
+ * forceSingleInstance is set).
  */
 static rsRetVal
 callExtProg(wrkrInstanceData_t *__restrict__ const pWrkrData, smsg_t *__restrict__ const pMsg)
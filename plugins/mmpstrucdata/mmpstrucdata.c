@@ -172,13 +172,38 @@ CODESTARTtryResume
 ENDtryResume
 
 
+/* create the JSON string for a PARAM-VALUE. The value is taken directly
+ * from the SD buffer. Only if it contains escape sequences, a copy is
+ * needed, and this is sized to the actual value (so there is no limit on
+ * value size).
+ */
 static rsRetVal
-parsePARAM_VALUE(uchar *sdbuf, int lenbuf, int *curridx, uchar *fieldbuf)
+parsePARAM_VALUE(uchar *sdbuf, int lenbuf, int *curridx, struct json_object **jval)
 {
 	int i, j;
+	int start;
+	int bHaveEsc = 0;
+	uchar *fieldbuf = NULL;
 	DEFiRet;
-	i = *curridx;
+	i = start = *curridx;
+	while(i < lenbuf && sdbuf[i] != '"') {
+		if(sdbuf[i] == '\\') {
+			bHaveEsc = 1;
+			if(i+1 < lenbuf)
+				++i;
+		}
+		++i;
+	}
+	*curridx = i;
+
+	if(!bHaveEsc) {
+		*jval = json_object_new_string_len((char*)sdbuf+start, i-start);
+		FINALIZE;
+	}
+
+	CHKmalloc(fieldbuf = MALLOC(i-start + 1));
 	j = 0;
+	i = start;
 	while(i < lenbuf && sdbuf[i] != '"') {
 		if(sdbuf[i] == '\\') {
 			if(++i == lenbuf) {
@@ -200,8 +225,9 @@ parsePARAM_VALUE(uchar *sdbuf, int lenbuf, int *curridx, uchar *fieldbuf)
 			fieldbuf[j++] = sdbuf[i++];
 		}
 	}
-	fieldbuf[j] = '\0';
-	*curridx = i;
+	*jval = json_object_new_string_len((char*)fieldbuf, j);
+finalize_it:
+	free(fieldbuf);
 	RETiRet;
 }
 
@@ -230,8 +256,7 @@ parseSD_PARAM(uchar *sdbuf, int lenbuf, int *curridx, struct json_object *jroot)
 {
 	int i;
 	uchar pName[33];
-	uchar pVal[32*1024];
-	struct json_object *jval;
+	struct json_object *jval = NULL;
 	DEFiRet;
 	
 	i = *curridx;
@@ -244,17 +269,19 @@ parseSD_PARAM(uchar *sdbuf, int lenbuf, int *curridx, struct json_object *jroot)
 		ABORT_FINALIZE(RS_RET_STRUC_DATA_INVLD);
 	}
 	++i;
-	CHKiRet(parsePARAM_VALUE(sdbuf, lenbuf, &i, pVal));
+	CHKiRet(parsePARAM_VALUE(sdbuf, lenbuf, &i, &jval));
 	if(sdbuf[i] != '"') {
 		ABORT_FINALIZE(RS_RET_STRUC_DATA_INVLD);
 	}
 	++i;
 
-	jval = json_object_new_string((char*)pVal);
 	json_object_object_add(jroot, (char*)pName, jval);
+	jval = NULL;
 
 	*curridx = i;
 finalize_it:
+	if(jval != NULL)
+		json_object_put(jval);
 	RETiRet;
 }
 
@@ -8,6 +8,11 @@
  * features (no MIME, no nothing). It is assumed that proper firewalling
  * and/or STMP server configuration is used together with this module.
  *
+ * SMTP sessions are kept open and re-used for subsequent messages by
+ * default (session.reuse), so that message bursts do not result in one
+ * TCP connection per message. If digest.enable is set, all messages of a
+ * batch are sent as the body of a single mail.
+ *
  * NOTE: read comments in module-template.h to understand how this file
  *       works!
  *
@@ -52,6 +57,7 @@
 #include "datetime.h"
 #include "glbl.h"
 #include "parserif.h"
+#include "stringbuf.h"
 
 MODULE_TYPE_OUTPUT
 MODULE_TYPE_NOKEEP
@@ -79,6 +85,9 @@ typedef struct _instanceData {
 	int8_t iMode;	/* 0 - smtp, 1 - sendmail */
 	sbool bHaveSubject; /* is a subject configured? (if so, it is the second string provided by rsyslog core) */
 	sbool bEnableBody; /* is a body configured? (if so, it is the second string provided by rsyslog core) */
+	sbool bReuseSession; /* keep the SMTP session open for the next message? */
+	sbool bDigest; /* send all messages of a batch as a single mail? */
+	int iSessionIdleTimeout; /* max seconds an unused session is re-used after */
 	union {
 		struct {
 			uchar *pszSrv;
@@ -97,8 +106,13 @@ typedef struct wrkrInstanceData {
 			size_t lenRcvBuf;
 			size_t iRcvBuf;	/* current index into the rcvBuf (buf empty if iRcvBuf == lenRcvBuf) */
 			int sock;	/* socket to this server (most important when we do multiple msgs per mail) */
+			time_t tLastUse;	/* time the session was last used (for idle timeout) */
 			} smtp;
 	} md;	/* mode-specific data */
+	cstr_t *digestBody;	/* body of the digest being built for the current batch */
+	uchar *digestSubject;	/* subject of the digest (the first message's subject) */
+	unsigned nDigestMsgs;	/* number of messages in current digest */
+	sbool bDigestNeedsNL;	/* last digest entry did not end with a line break */
 } wrkrInstanceData_t;
 
 typedef struct configSettings_s {
@@ -121,6 +135,9 @@ static struct cnfparamdescr actpdescr[] = {
 	{ "subject.template", eCmdHdlrGetWord, 0 },
 	{ "subject.text", eCmdHdlrString, 0 },
 	{ "body.enable", eCmdHdlrBinary, 0 },
+	{ "session.reuse", eCmdHdlrBinary, 0 },
+	{ "session.idletimeout", eCmdHdlrPositiveInt, 0 },
+	{ "digest.enable", eCmdHdlrBinary, 0 },
 	{ "template", eCmdHdlrGetWord, 0 }
 };
 static struct cnfparamblk actpblk =
@@ -259,11 +276,15 @@ finalize_it:
 BEGINcreateInstance
 CODESTARTcreateInstance
 	pData->constSubject = NULL;
+	pData->bReuseSession = 1;
+	pData->iSessionIdleTimeout = 60;
+	pData->bDigest = 0;
 ENDcreateInstance
 
 
 BEGINcreateWrkrInstance
 CODESTARTcreateWrkrInstance
+	pWrkrData->md.smtp.sock = -1;
 ENDcreateWrkrInstance
 
 
@@ -286,8 +307,26 @@ CODESTARTfreeInstance
 ENDfreeInstance
 
 
+/* reset digest buffer (e.g. at start of a new batch) */
+static void
+digestReset(wrkrInstanceData_t *const pWrkrData)
+{
+	if(pWrkrData->digestBody != NULL)
+		cstrDestruct(&pWrkrData->digestBody);
+	free(pWrkrData->digestSubject);
+	pWrkrData->digestSubject = NULL;
+	pWrkrData->nDigestMsgs = 0;
+	pWrkrData->bDigestNeedsNL = 0;
+}
+
+
+/* forward definition, needed to cleanly shut down the session */
+static void sessionClose(wrkrInstanceData_t *pWrkrData);
+
 BEGINfreeWrkrInstance
 CODESTARTfreeWrkrInstance
+	sessionClose(pWrkrData);
+	digestReset(pWrkrData);
 ENDfreeWrkrInstance
 
 
@@ -391,6 +430,8 @@ serverConnect(wrkrInstanceData_t *pWrkrData)
 		ABORT_FINALIZE(RS_RET_IO_ERROR);
 	}
 	
+	pWrkrData->md.smtp.iRcvBuf = 0;
+	pWrkrData->md.smtp.lenRcvBuf = 0;
 	if((pWrkrData->md.smtp.sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol)) == -1) {
 		DBGPRINTF("couldn't create send socket, reason %s", rs_strerror_r(errno, errStr, sizeof(errStr)));
 		ABORT_FINALIZE(RS_RET_IO_ERROR);
@@ -583,18 +624,13 @@ mkSMTPTimestamp(uchar *pszBuf, size_t lenBuf)
 }
 
 
-/* send a message via SMTP
- * rgerhards, 2008-04-04
+/* open a new SMTP session: connect and greet the server
  */
 static rsRetVal
-sendSMTP(wrkrInstanceData_t *pWrkrData, uchar *body, uchar *subject)
+sessionOpen(wrkrInstanceData_t *pWrkrData)
 {
 	DEFiRet;
 	int iState; /* SMTP state */
-	instanceData *pData;
-	uchar szDateBuf[64];
-	
-	pData = pWrkrData->pData;
 
 	CHKiRet(serverConnect(pWrkrData));
 	CHKiRet(readResponse(pWrkrData, &iState, 220));
@@ -605,11 +641,87 @@ sendSMTP(wrkrInstanceData_t *pWrkrData, uchar *body, uchar *subject)
 	CHKiRet(Send(pWrkrData->md.smtp.sock, "\r\n", sizeof("\r\n") - 1));
 	CHKiRet(readResponse(pWrkrData, &iState, 250));
 
+finalize_it:
+	if(iRet != RS_RET_OK)
+		serverDisconnect(pWrkrData);
+	RETiRet;
+}
+
+
+/* politely end the SMTP session, if one is open. Errors are ignored, as
+ * we close the connection in any case.
+ */
+static void
+sessionClose(wrkrInstanceData_t *pWrkrData)
+{
+	int iState;
+
+	if(pWrkrData->md.smtp.sock == -1)
+		return;
+	if(Send(pWrkrData->md.smtp.sock, "QUIT\r\n", sizeof("QUIT\r\n") - 1) == RS_RET_OK)
+		readResponse(pWrkrData, &iState, 221);
+	serverDisconnect(pWrkrData);
+}
+
+
+/* start the mail transaction */
+static rsRetVal
+sendMailFrom(wrkrInstanceData_t *pWrkrData)
+{
+	DEFiRet;
+	int iState; /* SMTP state */
+	instanceData *pData = pWrkrData->pData;
+
 	CHKiRet(Send(pWrkrData->md.smtp.sock, "MAIL FROM:<", sizeof("MAIL FROM:<") - 1));
 	CHKiRet(Send(pWrkrData->md.smtp.sock, (char*)pData->md.smtp.pszFrom, strlen((char*)pData->md.smtp.pszFrom)));
 	CHKiRet(Send(pWrkrData->md.smtp.sock, ">\r\n", sizeof(">\r\n") - 1));
 	CHKiRet(readResponse(pWrkrData, &iState, 250));
 
+finalize_it:
+	RETiRet;
+}
+
+
+/* send a message via SMTP
+ * If session re-use is enabled, an existing session is used if it has not
+ * been idle for too long. Servers may nevertheless have closed it in the
+ * meantime. So if a re-used session fails on MAIL FROM, we retry once with
+ * a new one. Later failures are not retried here, because the server may
+ * already have accepted the mail and we do not want to create duplicates.
+ * rgerhards, 2008-04-04
+ */
+static rsRetVal
+sendSMTP(wrkrInstanceData_t *pWrkrData, uchar *body, uchar *subject)
+{
+	DEFiRet;
+	int iState; /* SMTP state */
+	instanceData *pData;
+	uchar szDateBuf[64];
+	time_t tCurr;
+	int bReused;
+	
+	pData = pWrkrData->pData;
+
+	datetime.GetTime(&tCurr);
+	if(pWrkrData->md.smtp.sock != -1
+	   && tCurr - pWrkrData->md.smtp.tLastUse > pData->iSessionIdleTimeout) {
+		DBGPRINTF("ommail: SMTP session idle for too long, closing it\n");
+		sessionClose(pWrkrData);
+	}
+
+	bReused = (pWrkrData->md.smtp.sock != -1);
+	if(!bReused)
+		CHKiRet(sessionOpen(pWrkrData));
+
+	iRet = sendMailFrom(pWrkrData);
+	if(iRet != RS_RET_OK && bReused) {
+		DBGPRINTF("ommail: re-used SMTP session failed with %d, opening a new one\n", iRet);
+		serverDisconnect(pWrkrData);
+		CHKiRet(sessionOpen(pWrkrData));
+		iRet = sendMailFrom(pWrkrData);
+	}
+	CHKiRet(iRet);
+
 	CHKiRet(WriteRcpts(pWrkrData, (uchar*)"RCPT TO", sizeof("RCPT TO") - 1, 250));
 
 	CHKiRet(Send(pWrkrData->md.smtp.sock, "DATA\r\n",   sizeof("DATA\r\n") - 1));
@@ -643,13 +755,18 @@ sendSMTP(wrkrInstanceData_t *pWrkrData, uchar *body, uchar *subject)
 	CHKiRet(Send(pWrkrData->md.smtp.sock, "\r\n.\r\n",   sizeof("\r\n.\r\n") - 1));
 	CHKiRet(readResponse(pWrkrData, &iState, 250));
 
-	CHKiRet(Send(pWrkrData->md.smtp.sock, "QUIT\r\n",   sizeof("QUIT\r\n") - 1));
-	CHKiRet(readResponse(pWrkrData, &iState, 221));
-
-	/* we are finished, a new connection is created for each request, so let's close it now */
-	CHKiRet(serverDisconnect(pWrkrData));
+	if(pData->bReuseSession) {
+		pWrkrData->md.smtp.tLastUse = tCurr;
+	} else {
+		/* a new connection is created for each request, so let's close it now */
+		sessionClose(pWrkrData);
+	}
 	
 finalize_it:
+	if(iRet != RS_RET_OK) {
+		/* we do not know the state of the SMTP dialogue, so we must not re-use it */
+		serverDisconnect(pWrkrData);
+	}
 	RETiRet;
 }
 
@@ -675,8 +792,19 @@ finalize_it:
 ENDtryResume
 
 
+BEGINbeginTransaction
+CODESTARTbeginTransaction
+	digestReset(pWrkrData);
+ENDbeginTransaction
+
+
+/* In digest mode, messages are only collected here and the mail is sent
+ * when the batch is complete, in endTransaction. Otherwise, each message is
+ * sent (and thus committed) immediately.
+ */
 BEGINdoAction
 	uchar *subject;
+	size_t lenMsg;
 	const instanceData *const __restrict__ pData = pWrkrData->pData;
 CODESTARTdoAction
 	DBGPRINTF("ommail doAction()\n");
@@ -688,14 +816,48 @@ CODESTARTdoAction
 	else
 		subject = (uchar*)"message from rsyslog";
 
+	if(pData->bDigest) {
+		if(pWrkrData->digestBody == NULL) {
+			CHKiRet(cstrConstruct(&pWrkrData->digestBody));
+			CHKmalloc(pWrkrData->digestSubject = (uchar*) strdup((char*) subject));
+		}
+		/* entries must not run together if the template has no trailing LF */
+		if(pWrkrData->bDigestNeedsNL)
+			CHKiRet(cstrAppendChar(pWrkrData->digestBody, '\n'));
+		CHKiRet(rsCStrAppendStr(pWrkrData->digestBody, ppString[0]));
+		lenMsg = strlen((char*) ppString[0]);
+		pWrkrData->bDigestNeedsNL = (lenMsg > 0 && ppString[0][lenMsg-1] != '\n');
+		++pWrkrData->nDigestMsgs;
+		iRet = RS_RET_DEFER_COMMIT;
+		FINALIZE;
+	}
+
 	iRet = sendSMTP(pWrkrData, ppString[0], subject);
 	if(iRet != RS_RET_OK) {
 		DBGPRINTF("error sending mail, suspending\n");
 		iRet = RS_RET_SUSPENDED;
 	}
+finalize_it:
 ENDdoAction
 
 
+BEGINendTransaction
+CODESTARTendTransaction
+	if(pWrkrData->digestBody == NULL)
+		FINALIZE;
+
+	DBGPRINTF("ommail: sending digest of %u messages\n", pWrkrData->nDigestMsgs);
+	cstrFinalize(pWrkrData->digestBody);
+	iRet = sendSMTP(pWrkrData, rsCStrGetSzStrNoNULL(pWrkrData->digestBody), pWrkrData->digestSubject);
+	digestReset(pWrkrData);
+	if(iRet != RS_RET_OK) {
+		DBGPRINTF("error sending digest mail, suspending\n");
+		iRet = RS_RET_SUSPENDED;
+	}
+finalize_it:
+ENDendTransaction
+
+
 
 static inline void
 setInstParamDefaults(instanceData *pData)
@@ -747,6 +909,12 @@ CODESTARTnewActInst
 			pData->constSubject = (uchar*)es_str2cstr(pvals[i].val.d.estr, NULL);
 		} else if(!strcmp(actpblk.descr[i].name, "body.enable")) {
 			pData->bEnableBody =  (int) pvals[i].val.d.n;
+		} else if(!strcmp(actpblk.descr[i].name, "session.reuse")) {
+			pData->bReuseSession = (sbool) pvals[i].val.d.n;
+		} else if(!strcmp(actpblk.descr[i].name, "session.idletimeout")) {
+			pData->iSessionIdleTimeout = (int) pvals[i].val.d.n;
+		} else if(!strcmp(actpblk.descr[i].name, "digest.enable")) {
+			pData->bDigest = (sbool) pvals[i].val.d.n;
 		} else if(!strcmp(actpblk.descr[i].name, "template")) {
 			pData->tplName = (uchar*)es_str2cstr(pvals[i].val.d.estr, NULL);
 		} else {
@@ -861,6 +1029,7 @@ CODEqueryEtryPt_STD_OMOD_QUERIES
 CODEqueryEtryPt_STD_CONF2_OMOD_QUERIES
 CODEqueryEtryPt_STD_OMOD8_QUERIES
 CODEqueryEtryPt_STD_CONF2_CNFNAME_QUERIES 
+CODEqueryEtryPt_TXIF_OMOD_QUERIES /* we support the transactional interface! */
 ENDqueryEtryPt
 
 
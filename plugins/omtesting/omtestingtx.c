@@ -0,0 +1,299 @@
+/* omtestingtx.c
+ *
+ * This module is a testing aid for the action transaction engine. It is not
+ * meant to be used in production. It implements the commitTransaction()
+ * interface and writes each committed batch to a file. Batches which contain
+ * a message matching "datafail.match" fail as a whole with RS_RET_DATAFAIL,
+ * just like a database or bulk-indexing output would on a poison record.
+ * Optionally, each commit attempt is logged to "commitlog", so that testbench
+ * scripts can check how the core handles failed batches.
+ *
+ * If built with OMTESTING_NONTX, the same module is provided as
+ * "omtestingnontx", which uses the plain doAction() interface and fails
+ * single messages instead of batches.
+ *
+ * Parameters:
+ * file           - file the messages of committed batches are written to
+ * template       - template to use (default RSYSLOG_FileFormat)
+ * datafail.match - substring; batches with a message containing it fail
+ * commitlog      - optional; one line "commit <nMsgs> <rc>" per attempt
+ * suspendfile    - optional; the action is suspended while this file exists
+ *
+ * NOTE: read comments in module-template.h to understand how this file
+ *       works!
+ *
+ * Copyright 2018 Adiscon GmbH.
+ *
+ * This file is part of rsyslog.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "config.h"
+#include "rsyslog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "conf.h"
+#include "syslogd-types.h"
+#include "module-template.h"
+#include "errmsg.h"
+
+MODULE_TYPE_OUTPUT
+MODULE_TYPE_NOKEEP
+#ifdef OMTESTING_NONTX
+MODULE_CNFNAME("omtestingnontx")
+#else
+MODULE_CNFNAME("omtestingtx")
+#endif
+
+/* internal structures
+ */
+DEF_OMOD_STATIC_DATA
+
+typedef struct _instanceData {
+	uchar *fileName;
+	uchar *commitLog;
+	uchar *failMatch;
+	uchar *suspendFile;
+	uchar *tplName;
+	pthread_mutex_t mut;	/* serializes file writes between workers */
+} instanceData;
+
+typedef struct wrkrInstanceData {
+	instanceData *pData;
+} wrkrInstanceData_t;
+
+/* tables for interfacing with the v6 config system */
+/* action (instance) parameters */
+static struct cnfparamdescr actpdescr[] = {
+	{ "file", eCmdHdlrGetWord, CNFPARAM_REQUIRED },
+	{ "commitlog", eCmdHdlrGetWord, 0 },
+	{ "datafail.match", eCmdHdlrString, 0 },
+	{ "suspendfile", eCmdHdlrGetWord, 0 },
+	{ "template", eCmdHdlrGetWord, 0 }
+};
+static struct cnfparamblk actpblk =
+	{ CNFPARAMBLK_VERSION,
+	  sizeof(actpdescr)/sizeof(struct cnfparamdescr),
+	  actpdescr
+	};
+
+
+BEGINcreateInstance
+CODESTARTcreateInstance
+	pthread_mutex_init(&pData->mut, NULL);
+ENDcreateInstance
+
+
+BEGINcreateWrkrInstance
+CODESTARTcreateWrkrInstance
+ENDcreateWrkrInstance
+
+
+BEGINisCompatibleWithFeature
+CODESTARTisCompatibleWithFeature
+ENDisCompatibleWithFeature
+
+
+BEGINfreeInstance
+CODESTARTfreeInstance
+	free(pData->fileName);
+	free(pData->commitLog);
+	free(pData->failMatch);
+	free(pData->suspendFile);
+	free(pData->tplName);
+	pthread_mutex_destroy(&pData->mut);
+ENDfreeInstance
+
+
+BEGINfreeWrkrInstance
+CODESTARTfreeWrkrInstance
+ENDfreeWrkrInstance
+
+
+BEGINdbgPrintInstInfo
+CODESTARTdbgPrintInstInfo
+	dbgprintf("omtestingtx: file '%s', datafail.match '%s'\n", pData->fileName,
+		pData->failMatch == NULL ? "(none)" : (char*) pData->failMatch);
+ENDdbgPrintInstInfo
+
+
+/* check if the action shall behave as suspended (see "suspendfile") */
+static int
+isSuspended(const instanceData *const pData)
+{
+	return pData->suspendFile != NULL && access((char*) pData->suspendFile, F_OK) == 0;
+}
+
+
+BEGINtryResume
+CODESTARTtryResume
+	if(isSuspended(pWrkrData->pData))
+		iRet = RS_RET_SUSPENDED;
+ENDtryResume
+
+
+static void
+writeCommitLog(instanceData *const pData, const unsigned nParams, const rsRetVal ret)
+{
+	FILE *fp;
+
+	if(pData->commitLog == NULL)
+		return;
+	if((fp = fopen((char*) pData->commitLog, "a")) == NULL) {
+		LogError(errno, RS_RET_FILE_OPEN_ERROR, "omtestingtx: cannot open commit log '%s'",
+			pData->commitLog);
+		return;
+	}
+	fprintf(fp, "commit %u %d\n", nParams, ret);
+	fclose(fp);
+}
+
+
+#ifndef OMTESTING_NONTX
+BEGINbeginTransaction
+CODESTARTbeginTransaction
+	/* nothing to do, everything is done in commitTransaction() */
+ENDbeginTransaction
+
+
+BEGINcommitTransaction
+	instanceData *const pData = pWrkrData->pData;
+	FILE *fp = NULL;
+CODESTARTcommitTransaction
+	pthread_mutex_lock(&pData->mut);
+	if(isSuspended(pData))
+		ABORT_FINALIZE(RS_RET_SUSPENDED);
+	if(pData->failMatch != NULL) {
+		for(unsigned i = 0 ; i < nParams ; ++i) {
+			if(strstr((char*) actParam(pParams, 1, i, 0).param, (char*) pData->failMatch) != NULL) {
+				DBGPRINTF("omtestingtx: msg %u of %u matches, failing batch\n", i, nParams);
+				ABORT_FINALIZE(RS_RET_DATAFAIL);
+			}
+		}
+	}
+
+	if((fp = fopen((char*) pData->fileName, "a")) == NULL) {
+		LogError(errno, RS_RET_FILE_OPEN_ERROR, "omtestingtx: cannot open '%s'", pData->fileName);
+		ABORT_FINALIZE(RS_RET_SUSPENDED);
+	}
+	for(unsigned i = 0 ; i < nParams ; ++i) {
+		fputs((char*) actParam(pParams, 1, i, 0).param, fp);
+	}
+
+finalize_it:
+	if(fp != NULL)
+		fclose(fp);
+	writeCommitLog(pData, nParams, iRet);
+	pthread_mutex_unlock(&pData->mut);
+ENDcommitTransaction
+
+#else /* #ifndef OMTESTING_NONTX */
+
+BEGINdoAction
+	instanceData *const pData = pWrkrData->pData;
+	FILE *fp = NULL;
+CODESTARTdoAction
+	pthread_mutex_lock(&pData->mut);
+	if(isSuspended(pData))
+		ABORT_FINALIZE(RS_RET_SUSPENDED);
+	if(pData->failMatch != NULL && strstr((char*) ppString[0], (char*) pData->failMatch) != NULL) {
+		DBGPRINTF("omtestingnontx: msg matches, failing it\n");
+		ABORT_FINALIZE(RS_RET_DATAFAIL);
+	}
+
+	if((fp = fopen((char*) pData->fileName, "a")) == NULL) {
+		LogError(errno, RS_RET_FILE_OPEN_ERROR, "omtestingnontx: cannot open '%s'", pData->fileName);
+		ABORT_FINALIZE(RS_RET_SUSPENDED);
+	}
+	fputs((char*) ppString[0], fp);
+
+finalize_it:
+	if(fp != NULL)
+		fclose(fp);
+	writeCommitLog(pData, 1, iRet);
+	pthread_mutex_unlock(&pData->mut);
+ENDdoAction
+#endif /* #ifndef OMTESTING_NONTX */
+
+
+BEGINnewActInst
+	struct cnfparamvals *pvals;
+	int i;
+CODESTARTnewActInst
+	if((pvals = nvlstGetParams(lst, &actpblk, NULL)) == NULL) {
+		ABORT_FINALIZE(RS_RET_MISSING_CNFPARAMS);
+	}
+
+	CHKiRet(createInstance(&pData));
+
+	CODE_STD_STRING_REQUESTnewActInst(1)
+	for(i = 0 ; i < actpblk.nParams ; ++i) {
+		if(!pvals[i].bUsed)
+			continue;
+		if(!strcmp(actpblk.descr[i].name, "file")) {
+			pData->fileName = (uchar*)es_str2cstr(pvals[i].val.d.estr, NULL);
+		} else if(!strcmp(actpblk.descr[i].name, "commitlog")) {
+			pData->commitLog = (uchar*)es_str2cstr(pvals[i].val.d.estr, NULL);
+		} else if(!strcmp(actpblk.descr[i].name, "datafail.match")) {
+			pData->failMatch = (uchar*)es_str2cstr(pvals[i].val.d.estr, NULL);
+		} else if(!strcmp(actpblk.descr[i].name, "suspendfile")) {
+			pData->suspendFile = (uchar*)es_str2cstr(pvals[i].val.d.estr, NULL);
+		} else if(!strcmp(actpblk.descr[i].name, "template")) {
+			pData->tplName = (uchar*)es_str2cstr(pvals[i].val.d.estr, NULL);
+		} else {
+			dbgprintf("omtestingtx: program error, non-handled "
+			  "param '%s'\n", actpblk.descr[i].name);
+		}
+	}
+
+	CHKiRet(OMSRsetEntry(*ppOMSR, 0, (uchar*) strdup((pData->tplName == NULL) ?
+		"RSYSLOG_FileFormat" : (char*) pData->tplName), OMSR_NO_RQD_TPL_OPTS));
+CODE_STD_FINALIZERnewActInst
+	cnfparamvalsDestruct(pvals, &actpblk);
+ENDnewActInst
+
+
+NO_LEGACY_CONF_parseSelectorAct
+
+
+BEGINmodExit
+CODESTARTmodExit
+ENDmodExit
+
+
+BEGINqueryEtryPt
+CODESTARTqueryEtryPt
+#ifdef OMTESTING_NONTX
+CODEqueryEtryPt_STD_OMOD_QUERIES
+#else
+CODEqueryEtryPt_STD_OMODTX_QUERIES
+#endif
+CODEqueryEtryPt_STD_OMOD8_QUERIES
+CODEqueryEtryPt_STD_CONF2_OMOD_QUERIES
+ENDqueryEtryPt
+
+
+BEGINmodInit()
+CODESTARTmodInit
+	*ipIFVersProvided = CURR_MOD_IF_VERSION; /* we only support the current interface specification */
+CODEmodInit_QueryRegCFSLineHdlr
+ENDmodInit
+/*
+ * vi:set ai:
+ */
@@ -33,6 +33,7 @@
 #include <stdlib.h>
 #define SYSLOG_NAMES
 #include <string.h>
+#include <strings.h>
 #include <assert.h>
 #include <ctype.h>
 #include <sys/socket.h>
@@ -850,6 +851,8 @@ msgBaseConstruct(smsg_t **ppThis)
 	pM->pszTIMESTAMP_MySQL = NULL;
 	pM->pszTIMESTAMP_PgSQL = NULL;
 	pM->pszStrucData = NULL;
+	pM->pSDIdx = NULL;
+	pM->nSDIdx = 0;
 	pM->pCSAPPNAME = NULL;
 	pM->pCSPROCID = NULL;
 	pM->pCSMSGID = NULL;
@@ -999,6 +1002,7 @@ CODESTARTobjDestruct(msg)
 		free(pThis->pszTIMESTAMP_MySQL);
 		free(pThis->pszTIMESTAMP_PgSQL);
 		free(pThis->pszStrucData);
+		free(pThis->pSDIdx);
 		if(pThis->iLenPROGNAME >= CONF_PROGNAME_BUFSIZE)
 			free(pThis->PROGNAME.ptr);
 		if(pThis->pCSAPPNAME != NULL)
@@ -2562,6 +2566,8 @@ rsRetVal MsgSetStructuredData(smsg_t * const pMsg, const char* pszStrucData)
 	DEFiRet;
 	ISOBJ_TYPE_assert(pMsg, msg);
 	free(pMsg->pszStrucData);
+	free(pMsg->pSDIdx);
+	pMsg->pSDIdx = NULL;
 	CHKmalloc(pMsg->pszStrucData = (uchar*)strdup(pszStrucData));
 	pMsg->lenStrucData = strlen(pszStrucData);
 finalize_it:
@@ -2584,6 +2590,143 @@ MsgGetStructuredData(smsg_t * const pM, uchar **pBuf, rs_size_t *len)
 	MsgUnlock(pM);
 }
 
+/* unescape an RFC5424 PARAM-VALUE into buf, which must be able to
+ * hold at least len+1 bytes. Only \", \\ and \] are escape sequences,
+ * all other backslashes are kept as-is. Returns the resulting length.
+ */
+static int
+unescapeSDParamValue(const uchar *const val, const int len, uchar *const buf)
+{
+	int i, j;
+	for(i = 0, j = 0 ; i < len ; ++i) {
+		if(val[i] == '\\' && i+1 < len
+		   && (val[i+1] == '"' || val[i+1] == '\\' || val[i+1] == ']')) {
+			++i;
+		}
+		buf[j++] = val[i];
+	}
+	buf[j] = '\0';
+	return j;
+}
+
+
+/* build the SD-PARAM index of the message, so that MsgGetSDParam() does
+ * not need to scan the raw STRUCTURED-DATA on each call. If the SD is
+ * malformed, the params up to the error are indexed and nSDIdx is
+ * negated. Must be called with the message locked.
+ */
+static rsRetVal
+buildSDIdx(smsg_t *const pM)
+{
+	const uchar *const sd = pM->pszStrucData;
+	const int lenSD = (sd == NULL) ? 0 : pM->lenStrucData;
+	sdParamIdx_t *idx;
+	int nIdx = 0;
+	int maxIdx = 0;
+	int i = 0;
+	int sdidStart, lenSdid;
+	int nameStart;
+	int bInvld = 0;
+	DEFiRet;
+
+	/* there can be no more params than '=' characters */
+	for(i = 0 ; i < lenSD ; ++i) {
+		if(sd[i] == '=')
+			++maxIdx;
+	}
+	CHKmalloc(idx = malloc(sizeof(sdParamIdx_t) * (maxIdx + 1)));
+
+	i = 0;
+	while(i < lenSD && sd[i] == '[') {
+		sdidStart = ++i;
+		while(i < lenSD && sd[i] != ' ' && sd[i] != ']')
+			++i;
+		lenSdid = i - sdidStart;
+		while(i < lenSD && sd[i] == ' ') {
+			while(i < lenSD && sd[i] == ' ')
+				++i;
+			nameStart = i;
+			while(i < lenSD && sd[i] != '=' && sd[i] != ' ' && sd[i] != ']')
+				++i;
+			if(i+1 >= lenSD || sd[i] != '=' || sd[i+1] != '"') {
+				bInvld = 1;
+				goto done;
+			}
+			idx[nIdx].offsSdid = sdidStart;
+			idx[nIdx].lenSdid = lenSdid;
+			idx[nIdx].offsName = nameStart;
+			idx[nIdx].lenName = i - nameStart;
+			i += 2;
+			idx[nIdx].offsVal = i;
+			while(i < lenSD && sd[i] != '"') {
+				if(sd[i] == '\\')
+					++i;
+				++i;
+			}
+			if(i >= lenSD) {
+				bInvld = 1;
+				goto done;
+			}
+			idx[nIdx].lenVal = i - idx[nIdx].offsVal;
+			++nIdx;
+			++i; /* eat '"' */
+		}
+		if(i >= lenSD || sd[i] != ']') {
+			bInvld = 1;
+			goto done;
+		}
+		++i; /* eat ']' */
+	}
+
+done:
+	pM->pSDIdx = idx;
+	pM->nSDIdx = bInvld ? -nIdx - 1 : nIdx;
+finalize_it:
+	RETiRet;
+}
+
+
+/* obtain the value of a single SD-PARAM from the STRUCTURED-DATA, without
+ * building a JSON tree for it. The param locations are indexed on first
+ * use, so that multiple calls for the same message do not rescan the SD.
+ * SD-ID and PARAM-NAME are compared case-insensitively, just like
+ * mmpstrucdata lower-cases them.
+ * On success, *ppVal is a newly allocated, unescaped string which the
+ * caller must free. If the message does not contain the param,
+ * RS_RET_NOT_FOUND is returned.
+ */
+rsRetVal
+MsgGetSDParam(smsg_t *const pM, const uchar *const sdid, const uchar *const param,
+	uchar **const ppVal, int *const pLenVal)
+{
+	const int lenSdid = strlen((const char*)sdid);
+	const int lenParam = strlen((const char*)param);
+	const sdParamIdx_t *idx;
+	int nIdx;
+	int i;
+	DEFiRet;
+
+	MsgLock(pM);
+	if(pM->pSDIdx == NULL)
+		CHKiRet(buildSDIdx(pM));
+	nIdx = (pM->nSDIdx < 0) ? -pM->nSDIdx - 1 : pM->nSDIdx;
+	for(i = 0 ; i < nIdx ; ++i) {
+		idx = pM->pSDIdx + i;
+		if(idx->lenSdid == lenSdid && idx->lenName == lenParam
+		   && !strncasecmp((char*)pM->pszStrucData + idx->offsSdid, (char*)sdid, lenSdid)
+		   && !strncasecmp((char*)pM->pszStrucData + idx->offsName, (char*)param, lenParam)) {
+			CHKmalloc(*ppVal = MALLOC(idx->lenVal + 1));
+			*pLenVal = unescapeSDParamValue(pM->pszStrucData + idx->offsVal, idx->lenVal, *ppVal);
+			FINALIZE;
+		}
+	}
+	iRet = (pM->nSDIdx < 0) ? RS_RET_STRUC_DATA_INVLD : RS_RET_NOT_FOUND;
+
+finalize_it:
+	MsgUnlock(pM);
+	RETiRet;
+}
+
 /* get the "programname" as sz string
  * rgerhards, 2005-10-19
  */
@@ -5054,6 +5197,8 @@ MsgAddToStructuredData(smsg_t * const pMsg, uchar *toadd, rs_size_t len)
 	}
 	pMsg->pszStrucData[newlen] = '\0';
 	pMsg->lenStrucData = newlen;
+	free(pMsg->pSDIdx); /* must be rebuilt */
+	pMsg->pSDIdx = NULL;
 finalize_it:
 	RETiRet;
 }
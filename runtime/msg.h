@@ -37,6 +37,18 @@
 #include "template.h"
 #include "atomic.h"
 
+/* location of a single SD-PARAM inside the raw STRUCTURED-DATA. The index
+ * of all params is built on first use by MsgGetSDParam().
+ */
+typedef struct sdParamIdx_s {
+	uint16_t offsSdid;
+	uint16_t lenSdid;
+	uint16_t offsName;
+	uint16_t lenName;
+	uint16_t offsVal;	/* still escaped */
+	uint16_t lenVal;
+} sdParamIdx_t;
+
 /* rgerhards 2004-11-08: The following structure represents a
  * syslog message. 
  *
@@ -89,6 +101,8 @@ struct msg {
 	char *pszTIMESTAMP_PgSQL;/* TIMESTAMP as PgSQL formatted string (always 21 characters) */
 	uchar *pszStrucData;    /* STRUCTURED-DATA */
 	uint16_t lenStrucData;	/* (cached) length of STRUCTURED-DATA */
+	sdParamIdx_t *pSDIdx;	/* (cached) SD-PARAM index, NULL if not yet built */
+	int	nSDIdx;		/* number of entries in pSDIdx, -1 if SD is malformed after the last one */
 	cstr_t *pCSAPPNAME;	/* APP-NAME */
 	cstr_t *pCSPROCID;	/* PROCID */
 	cstr_t *pCSMSGID;	/* MSGID */
@@ -186,6 +200,7 @@ rsRetVal MsgSetFlowControlType(smsg_t *pMsg, flowControl_t eFlowCtl);
 rsRetVal MsgSetStructuredData(smsg_t *const pMsg, const char* pszStrucData);
 rsRetVal MsgAddToStructuredData(smsg_t *pMsg, uchar *toadd, rs_size_t len);
 void MsgGetStructuredData(smsg_t *pM, uchar **pBuf, rs_size_t *len);
+rsRetVal MsgGetSDParam(smsg_t *pM, const uchar *sdid, const uchar *param, uchar **ppVal, int *pLenVal);
 rsRetVal msgSetFromSockinfo(smsg_t *pThis, struct sockaddr_storage *sa);
 void MsgSetRcvFrom(smsg_t *pMsg, prop_t*);
 void MsgSetRcvFromStr(smsg_t *const pMsg, const uchar* pszRcvFrom, const int, prop_t **);
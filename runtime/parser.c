@@ -620,6 +620,7 @@ ParseMsg(smsg_t *pMsg)
 	rsRetVal localRet = RS_RET_ERR;
 	parserList_t *pParserList;
 	parser_t *pParser;
+	ruleset_t *pRuleset;
 	sbool bIsSanitized;
 	sbool bPRIisParsed;
 	static int iErrMsgRateLimiter = 0;
@@ -630,6 +631,18 @@ ParseMsg(smsg_t *pMsg)
 
 	CHKiRet(uncompressMessage(pMsg));
 
+	/* raw passthrough (e.g. for pure archiving): the message is neither sanitized
+	 * nor parsed. All of the raw message becomes the MSG part, header properties
+	 * keep their defaults.
+	 */
+	pRuleset = (pMsg->pRuleset == NULL) ? ourConf->rulesets.pDflt : pMsg->pRuleset;
+	if(pRuleset != NULL && pRuleset->bSkipParsing) {
+		msgSetPRI(pMsg, DEFUPRI);
+		MsgSetMSGoffs(pMsg, 0);
+		pMsg->msgFlags &= ~NEEDS_PARSING;
+		FINALIZE;
+	}
+
 	/* we take the risk to print a non-sanitized string, because this is the best we can get
 	 * (and that functionality is too important for debugging to drop it...).
 	 */
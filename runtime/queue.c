@@ -111,6 +111,9 @@ static struct cnfparamdescr cnfpdescr[] = {
 	{ "queue.size", eCmdHdlrSize, 0 },
 	{ "queue.dequeuebatchsize", eCmdHdlrInt, 0 },
 	{ "queue.maxdiskspace", eCmdHdlrSize, 0 },
+	{ "queue.secondaryspooldirectory", eCmdHdlrGetWord, 0 },
+	{ "queue.primarymaxdiskspace", eCmdHdlrSize, 0 },
+	{ "queue.secondarymaxdiskspace", eCmdHdlrSize, 0 },
 	{ "queue.highwatermark", eCmdHdlrInt, 0 },
 	{ "queue.lowwatermark", eCmdHdlrInt, 0 },
 	{ "queue.fulldelaymark", eCmdHdlrInt, 0 },
@@ -132,7 +135,11 @@ static struct cnfparamdescr cnfpdescr[] = {
 	{ "queue.dequeuetimebegin", eCmdHdlrInt, 0 },
 	{ "queue.dequeuetimeend", eCmdHdlrInt, 0 },
 	{ "queue.cry.provider", eCmdHdlrGetWord, 0 },
-	{ "queue.samplinginterval", eCmdHdlrInt, 0 }
+	{ "queue.samplinginterval", eCmdHdlrInt, 0 },
+	{ "queue.adaptiveworkers", eCmdHdlrBinary, 0 },
+	{ "queue.adaptiveworkers.maxlatency", eCmdHdlrPositiveInt, 0 },
+	{ "queue.dequeuerate.messages", eCmdHdlrNonNegInt, 0 },
+	{ "queue.dequeuerate.bytes", eCmdHdlrSize, 0 }
 };
 static struct cnfparamblk pblk =
 	{ CNFPARAMBLK_VERSION,
@@ -276,6 +283,10 @@ qqueueDbgPrint(qqueue_t *pThis)
 	dbgoprint((obj_t*) pThis, "queue.size: %d\n", pThis->iMaxQueueSize);
 	dbgoprint((obj_t*) pThis, "queue.dequeuebatchsize: %d\n", pThis->iDeqBatchSize);
 	dbgoprint((obj_t*) pThis, "queue.maxdiskspace: %lld\n", pThis->sizeOnDiskMax);
+	dbgoprint((obj_t*) pThis, "queue.secondaryspooldirectory: '%s'\n",
+		(pThis->pszSpoolDir2 == NULL) ? "[NONE]" : (char*)pThis->pszSpoolDir2);
+	dbgoprint((obj_t*) pThis, "queue.primarymaxdiskspace: %lld\n", pThis->sizeOnDiskMax1);
+	dbgoprint((obj_t*) pThis, "queue.secondarymaxdiskspace: %lld\n", pThis->sizeOnDiskMax2);
 	dbgoprint((obj_t*) pThis, "queue.highwatermark: %d\n", pThis->iHighWtrMrk);
 	dbgoprint((obj_t*) pThis, "queue.lowwatermark: %d\n", pThis->iLowWtrMrk);
 	dbgoprint((obj_t*) pThis, "queue.fulldelaymark: %d\n", pThis->iFullDlyMrk);
@@ -291,11 +302,15 @@ qqueueDbgPrint(qqueue_t *pThis)
 	dbgoprint((obj_t*) pThis, "queue.timeoutenqueue: %d\n", pThis->toEnq);
 	dbgoprint((obj_t*) pThis, "queue.timeoutworkerthreadshutdown: %d\n", pThis->toWrkShutdown);
 	dbgoprint((obj_t*) pThis, "queue.workerthreadminimummessages: %d\n", pThis->iMinMsgsPerWrkr);
+	dbgoprint((obj_t*) pThis, "queue.adaptiveworkers: %d\n", pThis->bAdaptiveWrkrs);
+	dbgoprint((obj_t*) pThis, "queue.adaptiveworkers.maxlatency: %d\n", pThis->iAdaptMaxLatency);
 	dbgoprint((obj_t*) pThis, "queue.maxfilesize: %lld\n", pThis->iMaxFileSize);
 	dbgoprint((obj_t*) pThis, "queue.saveonshutdown: %d\n", pThis->bSaveOnShutdown);
 	dbgoprint((obj_t*) pThis, "queue.dequeueslowdown: %d\n", pThis->iDeqSlowdown);
 	dbgoprint((obj_t*) pThis, "queue.dequeuetimebegin: %d\n", pThis->iDeqtWinFromHr);
 	dbgoprint((obj_t*) pThis, "queue.dequeuetimeend: %d\n", pThis->iDeqtWinToHr);
+	dbgoprint((obj_t*) pThis, "queue.dequeuerate.messages: %d\n", pThis->iDeqRateMsgs);
+	dbgoprint((obj_t*) pThis, "queue.dequeuerate.bytes: %lld\n", pThis->iDeqRateBytes);
 }
 
 
@@ -354,6 +369,82 @@ static void queueDrain(qqueue_t *pThis)
 /* --------------- code for disk-assisted (DA) queue modes -------------------- */
 
 
+/* adaptive worker scaling. Instead of deriving the number of workers from
+ * the queue size alone, we evaluate the age of the oldest message and the
+ * dequeue rate, at most once a second:
+ * - if the oldest message is older than queue.adaptiveworkers.maxlatency or
+ *   the backlog grows, one worker is added;
+ * - if the previous addition did not raise the dequeue rate, more threads
+ *   obviously do not help (e.g. the output is the bottleneck). Then the
+ *   worker is retired again and scaling up is paused for a while;
+ * - if there is no backlog, one worker is retired.
+ * Surplus workers terminate via ChkStopWrkrReg(). Returns the step taken
+ * (-1, 0 or 1). Must be called with the queue mutex LOCKED.
+ */
+#define ADAPT_HOLD_INTERVALS 30 /* evaluations to pause scale-up after an ineffective one */
+static int
+qqueueAdaptWorkers(qqueue_t *const pThis)
+{
+	time_t ttNow;
+	intctr_t rate;
+	int iQueueSize;
+	int iCurWrkrs;
+	int bGrowing;
+	int age;
+	int step = 0;
+
+	datetime.GetTime(&ttNow);
+	if(ttNow <= pThis->ttAdaptPrev)
+		return 0;
+	if(pThis->ttAdaptPrev == 0) { /* first call, just take the baseline */
+		pThis->ttAdaptPrev = ttNow;
+		pThis->nDeqAdaptPrev = pThis->nDeqTotal;
+		return 0;
+	}
+
+	rate = (pThis->nDeqTotal - pThis->nDeqAdaptPrev) / (intctr_t) (ttNow - pThis->ttAdaptPrev);
+	iQueueSize = getLogicalQueueSize(pThis);
+	age = (iQueueSize > 0 && pThis->ttOldestMsg != 0 && ttNow > pThis->ttOldestMsg)
+	      ? (int) (ttNow - pThis->ttOldestMsg) : 0;
+	bGrowing = iQueueSize > pThis->iQueueSizeAdaptPrev && iQueueSize >= pThis->iDeqBatchSize;
+
+	if(pThis->iAdaptHold > 0)
+		--pThis->iAdaptHold;
+
+	if(pThis->iAdaptLastStep > 0 && rate <= pThis->iRateAdaptPrev + pThis->iRateAdaptPrev / 20) {
+		step = -1; /* less than 5% gain from the last worker we added */
+		pThis->iAdaptHold = ADAPT_HOLD_INTERVALS;
+	} else if((age > pThis->iAdaptMaxLatency || bGrowing) && pThis->iAdaptHold == 0
+		  && pThis->iAdaptWrkrs < pThis->iNumWorkerThreads) {
+		step = 1;
+	} else if(!bGrowing && age == 0 && iQueueSize < pThis->iDeqBatchSize && pThis->iAdaptWrkrs > 1) {
+		step = -1;
+	}
+
+	if(step != 0) {
+		pThis->iAdaptWrkrs += step;
+		if(step > 0) {
+			STATSCOUNTER_INC(pThis->ctrAdaptUp, pThis->mutCtrAdaptUp);
+		} else {
+			STATSCOUNTER_INC(pThis->ctrAdaptDown, pThis->mutCtrAdaptDown);
+		}
+		DBGOPRINT((obj_t*) pThis, "adaptive workers: %s to %d (age %ds, size %d, rate %lld/s)\n",
+			  (step > 0) ? "scaling up" : "scaling down", pThis->iAdaptWrkrs,
+			  age, iQueueSize, (long long) rate);
+	}
+	iCurWrkrs = ATOMIC_FETCH_32BIT(&pThis->pWtpReg->iCurNumWrkThrd, &pThis->pWtpReg->mutCurNumWrkThrd);
+	pThis->nWrkrRetire = (iCurWrkrs > pThis->iAdaptWrkrs) ? iCurWrkrs - pThis->iAdaptWrkrs : 0;
+	pThis->ctrAdaptWrkrs = pThis->iAdaptWrkrs;
+
+	pThis->iAdaptLastStep = step;
+	pThis->iRateAdaptPrev = rate;
+	pThis->iQueueSizeAdaptPrev = iQueueSize;
+	pThis->nDeqAdaptPrev = pThis->nDeqTotal;
+	pThis->ttAdaptPrev = ttNow;
+	return step;
+}
+
+
 /* returns the number of workers that should be advised at
  * this point in time. The mutex must be locked when
  * ths function is called. -- rgerhards, 2008-01-25
@@ -371,10 +462,13 @@ qqueueAdviseMaxWorkers(qqueue_t *pThis)
 			DBGOPRINT((obj_t*) pThis, "(re)activating DA worker\n");
 			wtpAdviseMaxWorkers(pThis->pWtpDA, 1); /* disk queues have always one worker */
 		}
-		if(getLogicalQueueSize(pThis) == 0) {
-			iMaxWorkers = 0;
+		if(pThis->ttDeqHold != 0 || getLogicalQueueSize(pThis) == 0) {
+			iMaxWorkers = 0; /* if on hold, the hold timer will wake the workers */
 		} else if(pThis->qType == QUEUETYPE_DISK || pThis->iMinMsgsPerWrkr == 0) {
 			iMaxWorkers = 1;
+		} else if(pThis->bAdaptiveWrkrs) {
+			qqueueAdaptWorkers(pThis);
+			iMaxWorkers = pThis->iAdaptWrkrs;
 		} else {
 			iMaxWorkers = getLogicalQueueSize(pThis) / pThis->iMinMsgsPerWrkr + 1;
 		}
@@ -435,9 +529,17 @@ StartDA(qqueue_t *pThis)
 	CHKiRet(qqueueSetpAction(pThis->pqDA, pThis->pAction));
 	CHKiRet(qqueueSetsizeOnDiskMax(pThis->pqDA, pThis->sizeOnDiskMax));
 	CHKiRet(qqueueSetiDeqSlowdown(pThis->pqDA, pThis->iDeqSlowdown));
+	CHKiRet(qqueueSetiDeqRateMsgs(pThis->pqDA, pThis->iDeqRateMsgs));
+	CHKiRet(qqueueSetiDeqRateBytes(pThis->pqDA, pThis->iDeqRateBytes));
 	CHKiRet(qqueueSetMaxFileSize(pThis->pqDA, pThis->iMaxFileSize));
 	CHKiRet(qqueueSetFilePrefix(pThis->pqDA, pThis->pszFilePrefix, pThis->lenFilePrefix));
 	CHKiRet(qqueueSetSpoolDir(pThis->pqDA, pThis->pszSpoolDir, pThis->lenSpoolDir));
+	if(pThis->pszSpoolDir2 != NULL) {
+		CHKmalloc(pThis->pqDA->pszSpoolDir2 = ustrdup(pThis->pszSpoolDir2));
+		pThis->pqDA->lenSpoolDir2 = pThis->lenSpoolDir2;
+		pThis->pqDA->sizeOnDiskMax1 = pThis->sizeOnDiskMax1;
+		pThis->pqDA->sizeOnDiskMax2 = pThis->sizeOnDiskMax2;
+	}
 	CHKiRet(qqueueSetiPersistUpdCnt(pThis->pqDA, pThis->iPersistUpdCnt));
 	CHKiRet(qqueueSetbSyncQueueFiles(pThis->pqDA, pThis->bSyncQueueFiles));
 	CHKiRet(qqueueSettoActShutdown(pThis->pqDA, pThis->toActShutdown));
@@ -912,6 +1014,10 @@ static rsRetVal qConstructDisk(qqueue_t *pThis)
 	CHKiRet(strm.SetiMaxFileSize(pThis->tVars.disk.pWrite, pThis->iMaxFileSize));
 	CHKiRet(strm.SetiMaxFileSize(pThis->tVars.disk.pReadDeq, pThis->iMaxFileSize));
 	CHKiRet(strm.SetiMaxFileSize(pThis->tVars.disk.pReadDel, pThis->iMaxFileSize));
+	if(pThis->pszSpoolDir2 != NULL) {
+		CHKiRet(strm.SetDir2(pThis->tVars.disk.pReadDeq, pThis->pszSpoolDir2, pThis->lenSpoolDir2));
+		CHKiRet(strm.SetDir2(pThis->tVars.disk.pReadDel, pThis->pszSpoolDir2, pThis->lenSpoolDir2));
+	}
 
 finalize_it:
 	RETiRet;
@@ -978,13 +1084,165 @@ static rsRetVal qAddDisk(qqueue_t *pThis, smsg_t* pMsg)
 			"number %d to number %d - requiring a .qi write for robustness\n",
 			oldfile, newfile);
 		pThis->tVars.disk.nForcePersist = 2;
+		if(pThis->pszSpoolDir2 != NULL)
+			pThis->tVars.disk.bMigrate = 1;
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* copy a completed queue segment to the secondary spool directory. The
+ * copy is first written to a temporary file and synced, so the final name
+ * never refers to a partial file. Must be called WITHOUT the queue mutex
+ * held - this is the expensive part of moving a segment.
+ */
+static rsRetVal
+qqueueCopySegment(uchar *const pszSrc, uchar *const pszTmp)
+{
+	int fdSrc = -1;
+	int fdTmp = -1;
+	ssize_t nRead;
+	ssize_t nWritten;
+	ssize_t i;
+	char buf[64*1024];
+	DEFiRet;
+
+	if((fdSrc = open((char*) pszSrc, O_RDONLY | O_CLOEXEC)) == -1)
+		ABORT_FINALIZE(RS_RET_IO_ERROR);
+	if((fdTmp = open((char*) pszTmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)) == -1)
+		ABORT_FINALIZE(RS_RET_IO_ERROR);
+	while((nRead = read(fdSrc, buf, sizeof(buf))) != 0) {
+		if(nRead == -1) {
+			if(errno == EINTR)
+				continue;
+			ABORT_FINALIZE(RS_RET_IO_ERROR);
+		}
+		for(i = 0 ; i < nRead ; i += nWritten) {
+			nWritten = write(fdTmp, buf + i, nRead - i);
+			if(nWritten == -1) {
+				if(errno != EINTR)
+					ABORT_FINALIZE(RS_RET_IO_ERROR);
+				nWritten = 0;
+			}
+		}
 	}
+	if(fsync(fdTmp) != 0)
+		ABORT_FINALIZE(RS_RET_IO_ERROR);
 
 finalize_it:
+	if(iRet != RS_RET_OK) {
+		LogError(errno, iRet, "queue: error copying segment '%s' to '%s'", pszSrc, pszTmp);
+		if(fdTmp != -1)
+			unlink((char*) pszTmp);
+	}
+	if(fdSrc != -1)
+		close(fdSrc);
+	if(fdTmp != -1)
+		close(fdTmp);
 	RETiRet;
 }
 
 
+/* move completed disk queue segments to the secondary spool directory.
+ * A segment is completed if it is neither written to nor read from, that
+ * is all files strictly between the dequeue and the write position. The
+ * reading streams look up files in the secondary directory if they are no
+ * longer present in the primary one (see strmSetDir2()), so no further
+ * bookkeeping is needed once a file is moved.
+ * Segments are moved while the primary directory holds more than
+ * sizeOnDiskMax1 bytes and the secondary has room for them. The copy is
+ * done without the queue mutex; we check again afterwards that the reader
+ * has not advanced into the segment in the mean time. If so, the copy is
+ * discarded - the segment is about to be deleted anyhow.
+ * Must be called WITHOUT the queue mutex held.
+ */
+static void
+qqueueMigrateSegments(qqueue_t *const pThis)
+{
+	int fileNum;
+	int bMoved;
+	struct stat statBuf;
+	uchar *pszSrc = NULL;
+	uchar *pszDst = NULL;
+	uchar *pszTmp = NULL;
+	rsRetVal localRet;
+	strm_t *const pWrite = pThis->tVars.disk.pWrite;
+	strm_t *const pReadDeq = pThis->tVars.disk.pReadDeq;
+
+	d_pthread_mutex_lock(pThis->mut);
+	if(pThis->tVars.disk.bMigrating) {
+		d_pthread_mutex_unlock(pThis->mut);
+		return; /* someone else is already doing the work */
+	}
+	pThis->tVars.disk.bMigrating = 1;
+	while(1) {
+		fileNum = (int) strmGetCurrFileNum(pReadDeq) + 1;
+		if(fileNum < pThis->tVars.disk.migrateFileNum)
+			fileNum = pThis->tVars.disk.migrateFileNum;
+		/* note: we do not move anything when the file number wraps */
+		if(fileNum >= (int) strmGetCurrFileNum(pWrite))
+			break;
+		if(pThis->tVars.disk.sizeOnDisk - (int64) pThis->tVars.disk.sizeOnDisk2
+		   <= pThis->sizeOnDiskMax1)
+			break;
+
+		free(pszSrc); pszSrc = NULL;
+		free(pszDst); pszDst = NULL;
+		free(pszTmp); pszTmp = NULL;
+		if(   genFileName(&pszSrc, pThis->pszSpoolDir, pThis->lenSpoolDir,
+			pThis->pszFilePrefix, pThis->lenFilePrefix, fileNum, pWrite->iFileNumDigits) != RS_RET_OK
+		   || genFileName(&pszDst, pThis->pszSpoolDir2, pThis->lenSpoolDir2,
+			pThis->pszFilePrefix, pThis->lenFilePrefix, fileNum, pWrite->iFileNumDigits) != RS_RET_OK
+		   || (pszTmp = malloc(ustrlen(pszDst) + sizeof(".part"))) == NULL)
+			break;
+		sprintf((char*) pszTmp, "%s.part", (char*) pszDst);
+
+		if(stat((char*) pszSrc, &statBuf) != 0) {
+			/* not in primary dir (e.g. moved before a restart) - skip it */
+			pThis->tVars.disk.migrateFileNum = fileNum + 1;
+			continue;
+		}
+		if(pThis->sizeOnDiskMax2 != 0
+		   && (int64) pThis->tVars.disk.sizeOnDisk2 + statBuf.st_size > pThis->sizeOnDiskMax2) {
+			DBGOPRINT((obj_t*) pThis, "secondary spool directory full, not moving "
+				"segment %d\n", fileNum);
+			break;
+		}
+
+		d_pthread_mutex_unlock(pThis->mut);
+		localRet = qqueueCopySegment(pszSrc, pszTmp);
+		d_pthread_mutex_lock(pThis->mut);
+
+		if(localRet != RS_RET_OK)
+			break; /* we will retry when the next segment is completed */
+		bMoved = 0;
+		if(fileNum > (int) strmGetCurrFileNum(pReadDeq)) {
+			if(rename((char*) pszTmp, (char*) pszDst) == 0) {
+				unlink((char*) pszSrc);
+				pThis->tVars.disk.sizeOnDisk2 += statBuf.st_size;
+				STATSCOUNTER_INC(pThis->ctrSegMoved, pThis->mutCtrSegMoved);
+				bMoved = 1;
+				DBGOPRINT((obj_t*) pThis, "moved segment '%s' to '%s'\n", pszSrc, pszDst);
+			} else {
+				LogError(errno, RS_RET_IO_ERROR, "queue: error renaming '%s' to '%s'",
+					pszTmp, pszDst);
+			}
+		}
+		if(!bMoved)
+			unlink((char*) pszTmp);
+		pThis->tVars.disk.migrateFileNum = fileNum + 1;
+	}
+	pThis->tVars.disk.bMigrating = 0;
+	d_pthread_mutex_unlock(pThis->mut);
+
+	free(pszSrc);
+	free(pszDst);
+	free(pszTmp);
+}
+
+
 static rsRetVal
 qDeqDisk(qqueue_t *pThis, smsg_t **ppMsg)
 {
@@ -1087,6 +1345,10 @@ qqueueAdd(qqueue_t *pThis, smsg_t *pMsg)
 		}
 	}
 
+	if(pThis->qType != QUEUETYPE_DIRECT && pThis->ttOldestMsg == 0) {
+		/* must be taken before qAdd(), disk queues destruct the msg */
+		pThis->ttOldestMsg = pMsg->ttGenTime;
+	}
 	CHKiRet(pThis->qAdd(pThis, pMsg));
 
 	if(pThis->qType != QUEUETYPE_DIRECT) {
@@ -1471,6 +1733,10 @@ qqueueSetDefaultsActionQueue(qqueue_t *pThis)
 	pThis->iDeqtWinFromHr = 0;
 	pThis->iDeqtWinToHr = 25;		 /* disable time-windowed dequeuing by default */
 	pThis->iSmpInterval = 0;                 /* disable sampling */
+	pThis->bAdaptiveWrkrs = 0;
+	pThis->iAdaptMaxLatency = 2;
+	pThis->iDeqRateMsgs = 0;		/* no dequeue shaping */
+	pThis->iDeqRateBytes = 0;
 }
 
 
@@ -1502,6 +1768,10 @@ qqueueSetDefaultsRulesetQueue(qqueue_t *pThis)
 	pThis->iDeqtWinFromHr = 0;
 	pThis->iDeqtWinToHr = 25;		 /* disable time-windowed dequeuing by default */
 	pThis->iSmpInterval = 0;                 /* disable sampling */
+	pThis->bAdaptiveWrkrs = 0;
+	pThis->iAdaptMaxLatency = 2;
+	pThis->iDeqRateMsgs = 0;		/* no dequeue shaping */
+	pThis->iDeqRateBytes = 0;
 }
 
 
@@ -1552,6 +1822,7 @@ DoDeleteBatchFromQStore(qqueue_t *pThis, int nElem)
 {
 	int i;
 	off64_t bytesDel = 0; /* keep CLANG static anaylzer happy */
+	int bDir2;
 	DEFiRet;
 
 	ISOBJ_TYPE_assert(pThis, qqueue);
@@ -1559,7 +1830,7 @@ DoDeleteBatchFromQStore(qqueue_t *pThis, int nElem)
 	/* now send delete request to storage driver */
 	if(pThis->qType == QUEUETYPE_DISK) {
 		strmMultiFileSeek(pThis->tVars.disk.pReadDel, pThis->tVars.disk.deqFileNumOut,
-				  pThis->tVars.disk.deqOffs, &bytesDel);
+				  pThis->tVars.disk.deqOffs, &bytesDel, &bDir2);
 		/* We need to correct the on-disk file size. This time it is a bit tricky:
 		 * we free disk space only upon file deletion. So we need to keep track of what we
 		 * have read until we get an out-offset that is lower than the in-offset (which
@@ -1568,6 +1839,10 @@ DoDeleteBatchFromQStore(qqueue_t *pThis, int nElem)
 		 */
 		 if(bytesDel != 0) {
 			pThis->tVars.disk.sizeOnDisk -= bytesDel;
+			if(bDir2) {
+				pThis->tVars.disk.sizeOnDisk2 = ((off64_t) pThis->tVars.disk.sizeOnDisk2 > bytesDel)
+					? pThis->tVars.disk.sizeOnDisk2 - bytesDel : 0;
+			}
 			DBGOPRINT((obj_t*) pThis, "doDeleteBatch: a %lld octet file has been deleted, now %lld "
 				"octets disk space used\n", (long long) bytesDel, pThis->tVars.disk.sizeOnDisk);
 			/* awake possibly waiting enq process */
@@ -1684,6 +1959,209 @@ DeleteProcessedBatch(qqueue_t *pThis, batch_t *pBatch)
 }
 
 
+/* --------------- code for dequeue holds -------------------- */
+
+/* A queue can be put on hold, so that its workers do not dequeue anything
+ * until a given point in time. This is used for action queues whose action
+ * is parked while waiting for an asynchronous resume (action.resumeAsync).
+ * Held queues are kept on a list sorted by expiry time. A single timer
+ * thread, started on demand, lifts expired holds and wakes the workers.
+ * Lock order is mutDeqHold, then the queue mutex. ttDeqHold is only modified
+ * while holding both, so it may be read while holding either of them.
+ */
+static pthread_mutex_t mutDeqHold = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t condDeqHold = PTHREAD_COND_INITIALIZER;
+static qqueue_t *pDeqHoldRoot = NULL;
+static sbool bDeqHoldThrdRunning = 0;
+
+/* remove a queue from the hold list. mutDeqHold must be locked. */
+static void
+deqHoldUnlink(qqueue_t *const pThis)
+{
+	qqueue_t **ppq;
+
+	for(ppq = &pDeqHoldRoot ; *ppq != NULL ; ppq = &(*ppq)->pNextDeqHold) {
+		if(*ppq == pThis) {
+			*ppq = pThis->pNextDeqHold;
+			pThis->pNextDeqHold = NULL;
+			break;
+		}
+	}
+}
+
+
+/* the hold timer thread. It terminates when no more queues are on hold. */
+static void *
+deqHoldTimer(void __attribute__((unused)) *arg)
+{
+	struct timespec t;
+	time_t ttNow;
+	qqueue_t *pq;
+
+	pthread_mutex_lock(&mutDeqHold);
+	while(pDeqHoldRoot != NULL) {
+		datetime.GetTime(&ttNow);
+		if(pDeqHoldRoot->ttDeqHold > ttNow) {
+			t.tv_sec = pDeqHoldRoot->ttDeqHold;
+			t.tv_nsec = 0;
+			pthread_cond_timedwait(&condDeqHold, &mutDeqHold, &t);
+			continue;
+		}
+		pq = pDeqHoldRoot;
+		pDeqHoldRoot = pq->pNextDeqHold;
+		pq->pNextDeqHold = NULL;
+		DBGOPRINT((obj_t*) pq, "dequeue hold expired, waking workers\n");
+		d_pthread_mutex_lock(pq->mut);
+		pq->ttDeqHold = 0;
+		qqueueAdviseMaxWorkers(pq);
+		d_pthread_mutex_unlock(pq->mut);
+	}
+	bDeqHoldThrdRunning = 0;
+	pthread_mutex_unlock(&mutDeqHold);
+	return NULL;
+}
+
+
+/* put the queue on hold until ttUntil. Messages can still be enqueued (and
+ * go to the DA queue if the queue fills up), but no worker dequeues them
+ * before the hold expires. Must be called WITHOUT the queue mutex locked.
+ */
+rsRetVal
+qqueueSetDeqHold(qqueue_t *const pThis, const time_t ttUntil)
+{
+	pthread_t thrdID;
+	qqueue_t **ppq;
+	DEFiRet;
+
+	ISOBJ_TYPE_assert(pThis, qqueue);
+
+	pthread_mutex_lock(&mutDeqHold);
+	if(!bDeqHoldThrdRunning) {
+		if(pthread_create(&thrdID, &default_thread_attr, deqHoldTimer, NULL) != 0) {
+			/* without the timer, nobody would lift the hold, so we do not set it */
+			LogError(errno, RS_RET_ERR, "%s: could not create dequeue hold timer thread - "
+				"queue is not put on hold", obj.GetName((obj_t*) pThis));
+			ABORT_FINALIZE(RS_RET_ERR);
+		}
+		pthread_detach(thrdID);
+		bDeqHoldThrdRunning = 1;
+	}
+
+	deqHoldUnlink(pThis);
+	d_pthread_mutex_lock(pThis->mut);
+	pThis->ttDeqHold = ttUntil;
+	d_pthread_mutex_unlock(pThis->mut);
+	for(ppq = &pDeqHoldRoot ; *ppq != NULL && (*ppq)->ttDeqHold <= ttUntil ; ppq = &(*ppq)->pNextDeqHold)
+		/* just search */;
+	pThis->pNextDeqHold = *ppq;
+	*ppq = pThis;
+	pthread_cond_signal(&condDeqHold);
+	DBGOPRINT((obj_t*) pThis, "dequeue on hold until %lld\n", (long long) ttUntil);
+
+finalize_it:
+	pthread_mutex_unlock(&mutDeqHold);
+	RETiRet;
+}
+
+
+/* update the "oldest message" timestamp after a dequeue run. For in-memory
+ * queues, this is the generation time of the next dequeue candidate. For disk
+ * queues, the next message is still serialized and reading it would be costly,
+ * so we use the last dequeued message instead. As the queue is FIFO, this
+ * slightly overstates the age, which is fine for monitoring purposes.
+ * Must be called with the queue mutex LOCKED.
+ */
+static void
+qqueueUpdateOldestMsg(qqueue_t *const pThis, const time_t ttLastDeq)
+{
+	if(getLogicalQueueSize(pThis) <= 0) {
+		pThis->ttOldestMsg = 0;
+		return;
+	}
+	switch(pThis->qType) {
+	case QUEUETYPE_FIXED_ARRAY:
+		pThis->ttOldestMsg =
+			((smsg_t*)pThis->tVars.farray.pBuf[pThis->tVars.farray.deqhead])->ttGenTime;
+		break;
+	case QUEUETYPE_LINKEDLIST:
+		if(pThis->tVars.linklist.pDeqRoot != NULL)
+			pThis->ttOldestMsg = pThis->tVars.linklist.pDeqRoot->pMsg->ttGenTime;
+		break;
+	case QUEUETYPE_DISK:
+		if(ttLastDeq != 0)
+			pThis->ttOldestMsg = ttLastDeq;
+		break;
+	case QUEUETYPE_DIRECT:
+	default:
+		break;
+	}
+}
+
+
+/* Dequeue shaping via token buckets (queue.dequeuerate.messages and
+ * queue.dequeuerate.bytes). Tokens are refilled based on the time elapsed
+ * since the last refill, up to one second worth of tokens. A batch takes
+ * as many messages as there are tokens (but at least one, so a bucket
+ * may go into debt), and workers wait in RateLimiter() until the buckets
+ * have tokens again.
+ * Must be called with the queue mutex locked.
+ */
+static void
+qqueueShaperRefill(qqueue_t *const pThis)
+{
+	struct timespec tsNow;
+	double elapsed;
+
+	clock_gettime(CLOCK_MONOTONIC, &tsNow);
+	elapsed = (tsNow.tv_sec - pThis->tsShaperLast.tv_sec)
+		+ (tsNow.tv_nsec - pThis->tsShaperLast.tv_nsec) / 1000000000.0;
+	pThis->tsShaperLast = tsNow;
+	if(pThis->iDeqRateMsgs > 0) {
+		pThis->tokMsgs += elapsed * pThis->iDeqRateMsgs;
+		if(pThis->tokMsgs > pThis->iDeqRateMsgs)
+			pThis->tokMsgs = pThis->iDeqRateMsgs;
+	}
+	if(pThis->iDeqRateBytes > 0) {
+		pThis->tokBytes += elapsed * pThis->iDeqRateBytes;
+		if(pThis->tokBytes > pThis->iDeqRateBytes)
+			pThis->tokBytes = pThis->iDeqRateBytes;
+	}
+}
+
+
+/* wait until the buckets permit dequeueing the next batch. We wait at
+ * most one second per call, so that shutdown requests are not delayed
+ * for long if a bucket is deep in debt (e.g. after a very large message).
+ * Must be called with the queue mutex locked, which is released while
+ * waiting.
+ */
+static void
+qqueueShaperWait(qqueue_t *const pThis)
+{
+	double waitMsgs = 0.0;
+	double waitBytes = 0.0;
+	double wait;
+	long waitUs;
+
+	qqueueShaperRefill(pThis);
+	if(pThis->iDeqRateMsgs > 0 && pThis->tokMsgs < 1.0)
+		waitMsgs = (1.0 - pThis->tokMsgs) / pThis->iDeqRateMsgs;
+	if(pThis->iDeqRateBytes > 0 && pThis->tokBytes < 1.0)
+		waitBytes = (1.0 - pThis->tokBytes) / pThis->iDeqRateBytes;
+	wait = (waitMsgs > waitBytes) ? waitMsgs : waitBytes;
+	if(wait <= 0.0 || pThis->bShutdownImmediate)
+		return;
+
+	waitUs = (wait >= 1.0) ? 1000000 : (long) (wait * 1000000.0) + 1;
+	pthread_mutex_unlock(pThis->mut);
+	DBGOPRINT((obj_t*) pThis, "dequeue shaping, delaying %ld microseconds\n", waitUs);
+	srSleep(waitUs / 1000000, waitUs % 1000000);
+	pthread_mutex_lock(pThis->mut);
+	STATSCOUNTER_ADD(pThis->ctrShapedMs, pThis->mutCtrShapedMs, waitUs / 1000);
+	qqueueShaperRefill(pThis);
+}
+
+
 /* dequeue as many user pointers as are available, until we hit the configured
  * upper limit of pointers. Note that this function also deletes all processed
  * objects from the previous batch. However, it is perfectly valid that the
@@ -1700,7 +2178,10 @@ DequeueConsumableElements(qqueue_t *pThis, wti_t *pWti, int *piRemainingQueueSiz
 	int nDiscarded;
 	int nDeleted;
 	int iQueueSize;
+	int maxDeq;
+	int bShape;
 	smsg_t *pMsg;
+	time_t ttLastDeq = 0;
 	rsRetVal localRet;
 	DEFiRet;
 
@@ -1712,7 +2193,20 @@ DequeueConsumableElements(qqueue_t *pThis, wti_t *pWti, int *piRemainingQueueSiz
 		pThis->tVars.disk.deqFileNumIn = strmGetCurrFileNum(pThis->tVars.disk.pReadDeq);
 	}
 
-	while((iQueueSize = getLogicalQueueSize(pThis)) > 0 && nDequeued < pThis->iDeqBatchSize) {
+	/* with dequeue shaping, the batch is limited to the available tokens.
+	 * Moving messages to the DA queue is not shaped, only their delivery.
+	 */
+	bShape = (pWti->pWtp == pThis->pWtpReg);
+	maxDeq = pThis->iDeqBatchSize;
+	if(bShape && pThis->iDeqRateMsgs > 0 && pThis->tokMsgs < maxDeq)
+		maxDeq = (pThis->tokMsgs < 1.0) ? 1 : (int) pThis->tokMsgs;
+
+	/* note: nothing is dequeued while the queue is on hold, see qqueueSetDeqHold() */
+	iQueueSize = getLogicalQueueSize(pThis);
+	while(pThis->ttDeqHold == 0 && (iQueueSize = getLogicalQueueSize(pThis)) > 0
+	      && nDequeued < maxDeq) {
+		if(bShape && pThis->iDeqRateBytes > 0 && nDequeued > 0 && pThis->tokBytes <= 0.0)
+			break; /* byte budget used up, keep at least one msg per batch */
 		int rd_fd = -1;
 		int64_t rd_offs = 0;
 		int wr_fd = -1;
@@ -1747,6 +2241,7 @@ DequeueConsumableElements(qqueue_t *pThis, wti_t *pWti, int *piRemainingQueueSiz
 				obj.GetName((obj_t*) pThis), "...", iQueueSize);
 		}
 		CHKiRet(localRet);
+		ttLastDeq = pMsg->ttGenTime;
 
 		/* check if we should discard this element */
 		localRet = qqueueChkDiscardMsg(pThis, pThis->iQueueSize, pMsg);
@@ -1758,6 +2253,8 @@ DequeueConsumableElements(qqueue_t *pThis, wti_t *pWti, int *piRemainingQueueSiz
 		}
 
 		/* all well, use this element */
+		if(bShape && pThis->iDeqRateBytes > 0)
+			pThis->tokBytes -= pMsg->iLenRawMsg;
 		pWti->batch.pElem[nDequeued].pMsg = pMsg;
 		pWti->batch.eltState[nDequeued] = BATCH_STATE_RDY;
 		++nDequeued;
@@ -1768,6 +2265,11 @@ DequeueConsumableElements(qqueue_t *pThis, wti_t *pWti, int *piRemainingQueueSiz
 		pThis->tVars.disk.deqFileNumOut = strmGetCurrFileNum(pThis->tVars.disk.pReadDeq);
 	}
 
+	pThis->nDeqTotal += nDequeued + nDiscarded;
+	if(bShape && pThis->iDeqRateMsgs > 0)
+		pThis->tokMsgs -= nDequeued;
+	qqueueUpdateOldestMsg(pThis, ttLastDeq);
+
 	/* it is sufficient to persist only when the bulk of work is done */
 	qqueueChkPersist(pThis, nDequeued+nDiscarded+nDeleted);
 
@@ -1878,6 +2380,9 @@ RateLimiter(qqueue_t *pThis)
 
 	ISOBJ_TYPE_assert(pThis, qqueue);
 
+	if(pThis->iDeqRateMsgs > 0 || pThis->iDeqRateBytes > 0)
+		qqueueShaperWait(pThis);
+
 	iDelay = 0;
 	if(pThis->iDeqtWinToHr != 25) { /* 25 means disabled */
 		/* time calls are expensive, so only do them when needed */
@@ -2176,6 +2681,21 @@ ChkStopWrkrReg(qqueue_t *pThis)
 		iRet = RS_RET_TERMINATE_NOW;
 	} else if(pThis->pqParent != NULL) {
 		iRet = RS_RET_TERMINATE_WHEN_IDLE;
+	} else {
+		/* adaptive scaling is also evaluated by the workers, as the queue
+		 * may drain (or fall behind) without any enqueue calling
+		 * qqueueAdviseMaxWorkers().
+		 */
+		if(pThis->bAdaptiveWrkrs && pThis->qType != QUEUETYPE_DISK && pThis->iMinMsgsPerWrkr != 0
+		   && qqueueAdaptWorkers(pThis) > 0 && pThis->ttDeqHold == 0) {
+			wtpAdviseMaxWorkers(pThis->pWtpReg, pThis->iAdaptWrkrs);
+		}
+		if(pThis->nWrkrRetire > 0) {
+			/* surplus worker as of adaptive scaling */
+			--pThis->nWrkrRetire;
+			DBGOPRINT((obj_t*) pThis, "retiring surplus worker, adaptive scaling\n");
+			iRet = RS_RET_TERMINATE_NOW;
+		}
 	}
 
 	RETiRet;
@@ -2197,6 +2717,53 @@ if(pThis->pqParent != NULL) // TODO: check why we actually do this!
 }
 
 
+/* stats read_prepare hook: compute the age/backlog gauges right before they
+ * are emitted. The drain estimate is based on the dequeue rate observed since
+ * the previous stats read. Counters are unsigned, so 0 is used as "no
+ * estimate": the queue is empty, or it is non-empty but made no progress
+ * (or there is no previous sample yet). A queue that drains reports at least
+ * 1, so together with "size" the cases can be told apart. Values are read
+ * without the queue mutex - they are informational and slight races do not
+ * matter.
+ */
+static void
+qqueueStatsPrepare(statsobj_t __attribute__((unused)) *const stats, void *const ctx)
+{
+	qqueue_t *const pThis = (qqueue_t*) ctx;
+	const int iQueueSize = pThis->iQueueSize;
+	const time_t ttOldest = pThis->ttOldestMsg;
+	const intctr_t nDeqTotal = pThis->nDeqTotal;
+	time_t ttNow;
+
+	datetime.GetTime(&ttNow);
+
+	pThis->ctrOldestMsgAge = (iQueueSize > 0 && ttOldest != 0 && ttNow > ttOldest)
+				 ? (intctr_t) (ttNow - ttOldest) : 0;
+	if(pThis->qType == QUEUETYPE_DISK)
+		pThis->ctrDiskSize = (intctr_t) pThis->tVars.disk.sizeOnDisk;
+
+	if(iQueueSize <= 0) {
+		pThis->ctrDrainEstimate = 0;
+	} else if(pThis->ttPrevStatsRead != 0 && ttNow > pThis->ttPrevStatsRead) {
+		const intctr_t nDeq = nDeqTotal - pThis->nDeqTotalPrev;
+		if(nDeq == 0) {
+			pThis->ctrDrainEstimate = 0;
+		} else {
+			pThis->ctrDrainEstimate = (intctr_t) iQueueSize
+				* (intctr_t) (ttNow - pThis->ttPrevStatsRead) / nDeq;
+			if(pThis->ctrDrainEstimate == 0)
+				pThis->ctrDrainEstimate = 1;
+		}
+	} else if(pThis->ttPrevStatsRead != 0) {
+		return; /* read twice within the same second: keep previous sample */
+	} else {
+		pThis->ctrDrainEstimate = 0;
+	}
+	pThis->nDeqTotalPrev = nDeqTotal;
+	pThis->ttPrevStatsRead = ttNow;
+}
+
+
 /* start up the queue - it must have been constructed and parameters defined
  * before.
  */
@@ -2223,6 +2790,13 @@ qqueueStart(qqueue_t *pThis) /* this is the ConstructionFinalizer */
 			ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
 		pThis->lenSpoolDir = ustrlen(pThis->pszSpoolDir);
 	}
+	if(pThis->pszSpoolDir2 != NULL && !ustrcmp(pThis->pszSpoolDir2, pThis->pszSpoolDir)) {
+		LogError(0, RS_RET_INVALID_PARAMS, "queue %s: secondary spool directory is the "
+			"same as the spool directory - disabling secondary spool directory",
+			obj.GetName((obj_t*) pThis));
+		free(pThis->pszSpoolDir2);
+		pThis->pszSpoolDir2 = NULL;
+	}
 	/* set type-specific handlers and other very type-specific things
 	 * (we can not totally hide it...)
 	 */
@@ -2444,6 +3018,14 @@ qqueueStart(qqueue_t *pThis) /* this is the ConstructionFinalizer */
 
 	DBGOPRINT((obj_t*) pThis, "queue finished initialization\n");
 
+	pThis->iAdaptWrkrs = 1; /* adaptive scaling starts with one worker */
+	pThis->ctrAdaptWrkrs = 1;
+
+	/* dequeue shaping starts with full buckets */
+	clock_gettime(CLOCK_MONOTONIC, &pThis->tsShaperLast);
+	pThis->tokMsgs = pThis->iDeqRateMsgs;
+	pThis->tokBytes = pThis->iDeqRateBytes;
+
 	/* if the queue already contains data, we need to start the correct number of worker threads. This can be
 	 * the case when a disk queue has been loaded. If we did not start it here, it would never start.
 	 */
@@ -2478,6 +3060,41 @@ qqueueStart(qqueue_t *pThis) /* this is the ConstructionFinalizer */
 	CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("maxqsize"),
 		ctrType_Int, CTR_FLAG_NONE, &pThis->ctrMaxqsize));
 
+	/* age and backlog gauges are computed by qqueueStatsPrepare() */
+	CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("oldestmsg.age"),
+		ctrType_IntCtr, CTR_FLAG_NONE, &pThis->ctrOldestMsgAge));
+	CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("drain.estimate"),
+		ctrType_IntCtr, CTR_FLAG_NONE, &pThis->ctrDrainEstimate));
+	if(pThis->qType == QUEUETYPE_DISK) {
+		CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("disk.size"),
+			ctrType_IntCtr, CTR_FLAG_NONE, &pThis->ctrDiskSize));
+	}
+	if(pThis->bAdaptiveWrkrs) {
+		CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("workers.target"),
+			ctrType_IntCtr, CTR_FLAG_NONE, &pThis->ctrAdaptWrkrs));
+		STATSCOUNTER_INIT(pThis->ctrAdaptUp, pThis->mutCtrAdaptUp);
+		CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("workers.scaledup"),
+			ctrType_IntCtr, CTR_FLAG_RESETTABLE, &pThis->ctrAdaptUp));
+		STATSCOUNTER_INIT(pThis->ctrAdaptDown, pThis->mutCtrAdaptDown);
+		CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("workers.scaleddown"),
+			ctrType_IntCtr, CTR_FLAG_RESETTABLE, &pThis->ctrAdaptDown));
+	}
+	if(pThis->iDeqRateMsgs > 0 || pThis->iDeqRateBytes > 0) {
+		STATSCOUNTER_INIT(pThis->ctrShapedMs, pThis->mutCtrShapedMs);
+		CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("shaped.ms"),
+			ctrType_IntCtr, CTR_FLAG_RESETTABLE, &pThis->ctrShapedMs));
+	}
+	CHKiRet(statsobj.SetReadPrepare(pThis->statsobj, qqueueStatsPrepare, pThis));
+
+	if(pThis->qType == QUEUETYPE_DISK && pThis->pszSpoolDir2 != NULL) {
+		/* disk size in secondary spool dir is a gauge: no init, no mutex! */
+		CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("secondary.disksize"),
+			ctrType_IntCtr, CTR_FLAG_NONE, &pThis->tVars.disk.sizeOnDisk2));
+		STATSCOUNTER_INIT(pThis->ctrSegMoved, pThis->mutCtrSegMoved);
+		CHKiRet(statsobj.AddCounter(pThis->statsobj, UCHAR_CONSTANT("secondary.segmentsmoved"),
+			ctrType_IntCtr, CTR_FLAG_RESETTABLE, &pThis->ctrSegMoved));
+	}
+
 	CHKiRet(statsobj.ConstructFinalize(pThis->statsobj));
 
 finalize_it:
@@ -2560,6 +3177,7 @@ qqueuePersist(qqueue_t *pThis, int bIsCheckpoint)
 	CHKiRet(obj.BeginSerializePropBag(psQIF, (obj_t*) pThis));
 	objSerializeSCALAR(psQIF, iQueueSize, INT);
 	objSerializeSCALAR(psQIF, tVars.disk.sizeOnDisk, INT64);
+	objSerializeSCALAR(psQIF, tVars.disk.sizeOnDisk2, INT64);
 	CHKiRet(obj.EndSerialize(psQIF));
 
 	/* now persist the stream info */
@@ -2713,6 +3331,11 @@ CODESTARTobjDestruct(qqueue)
 			qqueueDestruct(&pThis->pqDA);
 		}
 
+		/* all workers are gone, so nobody can put us on hold any longer */
+		pthread_mutex_lock(&mutDeqHold);
+		deqHoldUnlink(pThis);
+		pthread_mutex_unlock(&mutDeqHold);
+
 		/* persist the queue (we always do that - queuePersits() does cleanup if the queue is empty)
 		 * This handler is most important for disk queues, it will finally persist the necessary
 		 * on-disk structures. In theory, other queueing modes may implement their other (non-DA)
@@ -2744,6 +3367,7 @@ CODESTARTobjDestruct(qqueue)
 
 	free(pThis->pszFilePrefix);
 	free(pThis->pszSpoolDir);
+	free(pThis->pszSpoolDir2);
 	if(pThis->useCryprov) {
 		pThis->cryprov.Destruct(&pThis->cryprovData);
 		obj.ReleaseObj(__FILE__, pThis->cryprovNameFull+2, pThis->cryprovNameFull,
@@ -2975,6 +3599,7 @@ qqueueMultiEnqObjNonDirect(qqueue_t *pThis, multi_submit_t *pMultiSub)
 {
 	int iCancelStateSave;
 	int i;
+	sbool bMigrate;
 	rsRetVal localRet;
 	DEFiRet;
 
@@ -2993,8 +3618,12 @@ qqueueMultiEnqObjNonDirect(qqueue_t *pThis, multi_submit_t *pMultiSub)
 finalize_it:
 	/* make sure at least one worker is running. */
 	qqueueAdviseMaxWorkers(pThis);
+	bMigrate = pThis->tVars.disk.bMigrate;
+	pThis->tVars.disk.bMigrate = 0;
 	/* and release the mutex */
 	d_pthread_mutex_unlock(pThis->mut);
+	if(bMigrate)
+		qqueueMigrateSegments(pThis);
 	pthread_setcancelstate(iCancelStateSave, NULL);
 	DBGOPRINT((obj_t*) pThis, "MultiEnqObj advised worker start\n");
 
@@ -3030,6 +3659,7 @@ qqueueEnqMsg(qqueue_t *pThis, flowControl_t flowCtlType, smsg_t *pMsg)
 {
 	DEFiRet;
 	int iCancelStateSave;
+	sbool bMigrate;
 	ISOBJ_TYPE_assert(pThis, qqueue);
 
 	const int isNonDirectQ = pThis->qType != QUEUETYPE_DIRECT;
@@ -3047,8 +3677,12 @@ finalize_it:
 	if(isNonDirectQ) {
 		/* make sure at least one worker is running. */
 		qqueueAdviseMaxWorkers(pThis);
+		bMigrate = pThis->tVars.disk.bMigrate;
+		pThis->tVars.disk.bMigrate = 0;
 		/* and release the mutex */
 		d_pthread_mutex_unlock(pThis->mut);
+		if(bMigrate)
+			qqueueMigrateSegments(pThis);
 		pthread_setcancelstate(iCancelStateSave, NULL);
 		DBGOPRINT((obj_t*) pThis, "EnqueueMsg advised worker start\n");
 	}
@@ -3164,6 +3798,20 @@ qqueueApplyCnfParam(qqueue_t *pThis, struct nvlst *lst)
 			pThis->iDeqBatchSize = pvals[i].val.d.n;
 		} else if(!strcmp(pblk.descr[i].name, "queue.maxdiskspace")) {
 			pThis->sizeOnDiskMax = pvals[i].val.d.n;
+		} else if(!strcmp(pblk.descr[i].name, "queue.secondaryspooldirectory")) {
+			free(pThis->pszSpoolDir2);
+			pThis->pszSpoolDir2 = (uchar*) es_str2cstr(pvals[i].val.d.estr, NULL);
+			pThis->lenSpoolDir2 = es_strlen(pvals[i].val.d.estr);
+			if(pThis->pszSpoolDir2[pThis->lenSpoolDir2-1] == '/') {
+				pThis->pszSpoolDir2[pThis->lenSpoolDir2-1] = '\0';
+				--pThis->lenSpoolDir2;
+				parser_errmsg("queue.secondaryspooldirectory must not end with '/', "
+					      "corrected to '%s'", pThis->pszSpoolDir2);
+			}
+		} else if(!strcmp(pblk.descr[i].name, "queue.primarymaxdiskspace")) {
+			pThis->sizeOnDiskMax1 = pvals[i].val.d.n;
+		} else if(!strcmp(pblk.descr[i].name, "queue.secondarymaxdiskspace")) {
+			pThis->sizeOnDiskMax2 = pvals[i].val.d.n;
 		} else if(!strcmp(pblk.descr[i].name, "queue.highwatermark")) {
 			pThis->iHighWtrMrk = pvals[i].val.d.n;
 		} else if(!strcmp(pblk.descr[i].name, "queue.lowwatermark")) {
@@ -3206,6 +3854,14 @@ qqueueApplyCnfParam(qqueue_t *pThis, struct nvlst *lst)
 			pThis->iDeqtWinToHr = pvals[i].val.d.n;
 		} else if(!strcmp(pblk.descr[i].name, "queue.samplinginterval")) {
 			pThis->iSmpInterval = pvals[i].val.d.n;
+		} else if(!strcmp(pblk.descr[i].name, "queue.adaptiveworkers")) {
+			pThis->bAdaptiveWrkrs = (sbool) pvals[i].val.d.n;
+		} else if(!strcmp(pblk.descr[i].name, "queue.adaptiveworkers.maxlatency")) {
+			pThis->iAdaptMaxLatency = pvals[i].val.d.n;
+		} else if(!strcmp(pblk.descr[i].name, "queue.dequeuerate.messages")) {
+			pThis->iDeqRateMsgs = pvals[i].val.d.n;
+		} else if(!strcmp(pblk.descr[i].name, "queue.dequeuerate.bytes")) {
+			pThis->iDeqRateBytes = pvals[i].val.d.n;
 		} else {
 			DBGPRINTF("queue: program error, non-handled "
 			  "param '%s'\n", pblk.descr[i].name);
@@ -3257,6 +3913,8 @@ DEFpropSetMeth(qqueue, iMinMsgsPerWrkr, int)
 DEFpropSetMeth(qqueue, bSaveOnShutdown, int)
 DEFpropSetMeth(qqueue, pAction, action_t*)
 DEFpropSetMeth(qqueue, iDeqSlowdown, int)
+DEFpropSetMeth(qqueue, iDeqRateMsgs, int)
+DEFpropSetMeth(qqueue, iDeqRateBytes, int64)
 DEFpropSetMeth(qqueue, iDeqBatchSize, int)
 DEFpropSetMeth(qqueue, sizeOnDiskMax, int64)
 DEFpropSetMeth(qqueue, iSmpInterval, int)
@@ -3282,6 +3940,8 @@ static rsRetVal qqueueSetProperty(qqueue_t *pThis, var_t *pProp)
 #		endif
  	} else if(isProp("tVars.disk.sizeOnDisk")) {
 		pThis->tVars.disk.sizeOnDisk = pProp->val.num;
+ 	} else if(isProp("tVars.disk.sizeOnDisk2")) {
+		pThis->tVars.disk.sizeOnDisk2 = pProp->val.num;
  	} else if(isProp("qType")) {
 		if(pThis->qType != pProp->val.num)
 			ABORT_FINALIZE(RS_RET_QTYPE_MISMATCH);
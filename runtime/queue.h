@@ -104,6 +104,8 @@ struct queue_s {
 	 * the user really wanted...). -- rgerhards, 2008-04-02
 	 */
 	/* end dequeue time window */
+	time_t	ttDeqHold;	/* if non-zero, do not dequeue before this time (see qqueueSetDeqHold()) */
+	struct queue_s *pNextDeqHold;/* next queue on the list of held queues */
 	rsRetVal (*pConsumer)(void *,batch_t*, wti_t*); /* user-supplied consumer function for dequeued messages */
 	/* calling interface for pConsumer: arg1 is the global user pointer from this structure, arg2 is the
 	 * user pointer array that was dequeued (actual sample: for actions, arg1 is the pAction and arg2
@@ -141,6 +143,10 @@ struct queue_s {
 	int iNumberFiles;	/* how many files make up the queue? */
 	int64 iMaxFileSize;	/* max size for a single queue file */
 	int64 sizeOnDiskMax;    /* maximum size on disk allowed */
+	uchar *pszSpoolDir2;	/* secondary spool dir for completed segments, NULL if not tiered */
+	size_t lenSpoolDir2;
+	int64 sizeOnDiskMax1;	/* move segments to secondary dir if primary holds more (0: always move) */
+	int64 sizeOnDiskMax2;	/* maximum size allowed in secondary spool dir (0: unlimited) */
 	qDeqID deqIDAdd;	/* next dequeue ID to use during add to queue store */
 	qDeqID deqIDDel;	/* queue store delete position */
 	int bIsDA;		/* is this queue disk assisted? */
@@ -168,6 +174,10 @@ struct queue_s {
 			strm_t *pReadDeq; /* current file for dequeueing */
 			strm_t *pReadDel; /* current file for deleting */
 			int nForcePersist;/* force persist of .qi file the next "n" times */
+			intctr_t sizeOnDisk2; /* part of sizeOnDisk that lives in the secondary spool dir */
+			int migrateFileNum;/* lowest file number that may still need to be moved */
+			sbool bMigrate;	/* a segment was completed, check if something needs to be moved */
+			sbool bMigrating; /* some thread is currently moving segments */
 		} disk;
 	} tVars;
 	sbool	useCryprov;	/* quicker than checkig ptr (1 vs 8 bytes!) */
@@ -183,7 +193,37 @@ struct queue_s {
 	STATSCOUNTER_DEF(ctrFull, mutCtrFull)
 	STATSCOUNTER_DEF(ctrFDscrd, mutCtrFDscrd)
 	STATSCOUNTER_DEF(ctrNFDscrd, mutCtrNFDscrd)
+	STATSCOUNTER_DEF(ctrSegMoved, mutCtrSegMoved)
 	int ctrMaxqsize; /* NOT guarded by a mutex */
+	/* queue age/backlog introspection; the gauges below are computed on stats read */
+	time_t ttOldestMsg;	/* gen time of next message to be dequeued, 0 if unknown/empty */
+	intctr_t nDeqTotal;	/* total number of elements dequeued (incl. discarded) */
+	intctr_t nDeqTotalPrev;	/* nDeqTotal as of previous stats read */
+	time_t ttPrevStatsRead;	/* time of previous stats read */
+	intctr_t ctrOldestMsgAge; /* gauge: age of oldest message in seconds */
+	intctr_t ctrDiskSize;	/* gauge: bytes currently used by disk queue */
+	intctr_t ctrDrainEstimate; /* gauge: estimated seconds to drain queue, 0 if unknown (see qqueueStatsPrepare) */
+	/* adaptive worker scaling, see qqueueAdaptWorkers() */
+	sbool bAdaptiveWrkrs;	/* scale workers by latency/throughput instead of queue size? */
+	int iAdaptMaxLatency;	/* max acceptable age (seconds) of the oldest message */
+	int iAdaptWrkrs;	/* current worker target */
+	int nWrkrRetire;	/* number of running workers that shall terminate */
+	int iAdaptLastStep;	/* +1/-1/0: decision of previous evaluation */
+	int iAdaptHold;		/* evaluations to pause scaling up */
+	int iQueueSizeAdaptPrev;/* queue size at previous evaluation */
+	time_t ttAdaptPrev;	/* time of previous evaluation */
+	intctr_t nDeqAdaptPrev;	/* nDeqTotal at previous evaluation */
+	intctr_t iRateAdaptPrev;/* dequeue rate (msgs/s) measured at previous evaluation */
+	intctr_t ctrAdaptWrkrs;	/* gauge: current worker target */
+	STATSCOUNTER_DEF(ctrAdaptUp, mutCtrAdaptUp)
+	STATSCOUNTER_DEF(ctrAdaptDown, mutCtrAdaptDown)
+	/* dequeue shaping (token buckets), see qqueueShaperWait() */
+	int iDeqRateMsgs;	/* max messages per second to dequeue, 0 = unlimited */
+	int64 iDeqRateBytes;	/* max bytes per second to dequeue, 0 = unlimited */
+	double tokMsgs;		/* tokens in message bucket (negative = debt) */
+	double tokBytes;	/* tokens in bytes bucket (negative = debt) */
+	struct timespec tsShaperLast; /* time of last bucket refill */
+	STATSCOUNTER_DEF(ctrShapedMs, mutCtrShapedMs)
 	int iSmpInterval; /* line interval of sampling logs */
 };
 
@@ -209,6 +249,7 @@ void qqueueSetDefaultsRulesetQueue(qqueue_t *pThis);
 void qqueueSetDefaultsActionQueue(qqueue_t *pThis);
 void qqueueDbgPrint(qqueue_t *pThis);
 rsRetVal qqueueShutdownWorkers(qqueue_t *pThis);
+rsRetVal qqueueSetDeqHold(qqueue_t *pThis, time_t ttUntil);
 
 PROTOTYPEObjClassInit(qqueue);
 PROTOTYPEpropSetMeth(qqueue, iPersistUpdCnt, int);
@@ -229,6 +270,8 @@ PROTOTYPEpropSetMeth(qqueue, iNumWorkerThreads, int);
 PROTOTYPEpropSetMeth(qqueue, bSaveOnShutdown, int);
 PROTOTYPEpropSetMeth(qqueue, pAction, action_t*);
 PROTOTYPEpropSetMeth(qqueue, iDeqSlowdown, int);
+PROTOTYPEpropSetMeth(qqueue, iDeqRateMsgs, int);
+PROTOTYPEpropSetMeth(qqueue, iDeqRateBytes, int64);
 PROTOTYPEpropSetMeth(qqueue, sizeOnDiskMax, int64);
 PROTOTYPEpropSetMeth(qqueue, iDeqBatchSize, int);
 #define qqueueGetID(pThis) ((unsigned long) pThis)
@@ -235,6 +235,7 @@ CODESTARTobjDestruct(rsconf)
 	free(pThis->globals.mainQ.pszMainMsgQFName);
 	free(pThis->globals.pszConfDAGFile);
 	lookupDestroyCnf();
+	rulesetDestructIndex(pThis);
 	llDestroy(&(pThis->rulesets.llRulesets));
 ENDobjDestruct(rsconf)
 
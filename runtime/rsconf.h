@@ -132,6 +132,7 @@ struct actions_s {
 
 struct rulesets_s {
 	linkedList_t llRulesets; /* this is NOT a pointer - no typo here ;) */
+	struct hashtable *htRulesets; /* name index over llRulesets, built on activation */
 
 	/* support for legacy rsyslog.conf format */
 	ruleset_t *pCurr; /* currently "active" ruleset */
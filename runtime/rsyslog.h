@@ -505,6 +505,7 @@ operation not carried out */
 	RS_RET_OPERATION_STATUS = -2439, /**< operational status (info) message, no error */
 	RS_RET_UDP_MSGSIZE_TOO_LARGE = -2440, /**< a message is too large to be sent via UDP */
 	RS_RET_NON_JSON_PROP = -2441, /**< a non-json property id is provided where a json one is requried */
+	RS_RET_FILE_ROTATE_ERR = -2442, /**< built-in file rotation failed (e.g. rename() error) */
 
 	/* RainerScript error messages (range 1000.. 1999) */
 	RS_RET_SYSVAR_NOT_FOUND = 1001, /**< system variable could not be found (maybe misspelled) */
@@ -50,6 +50,8 @@
 #include "modules.h"
 #include "wti.h"
 #include "dirty.h" /* for main ruleset queue creation */
+#include "hashtable.h"
+#include "parserif.h"
 
 
 /* static data */
@@ -60,7 +62,8 @@ DEFobjCurrIf(parser)
 /* tables for interfacing with the v6 config system (as far as we need to) */
 static struct cnfparamdescr rspdescr[] = {
 	{ "name", eCmdHdlrString, CNFPARAM_REQUIRED },
-	{ "parser", eCmdHdlrArray, 0 }
+	{ "parser", eCmdHdlrArray, 0 },
+	{ "parse", eCmdHdlrBinary, 0 }
 };
 static struct cnfparamblk rspblk =
 	{ CNFPARAMBLK_VERSION,
@@ -91,6 +94,7 @@ static void
 scriptIterateAllActions(struct cnfstmt *root, rsRetVal (*pFunc)(void*, void*), void* pParam)
 {
 	struct cnfstmt *stmt;
+	int i;
 	for(stmt = root ; stmt != NULL ; stmt = stmt->next) {
 		switch(stmt->nodetype) {
 		case S_NOP:
@@ -112,6 +116,16 @@ scriptIterateAllActions(struct cnfstmt *root, rsRetVal (*pFunc)(void*, void*), v
 				scriptIterateAllActions(stmt->d.s_if.t_else,
 							pFunc, pParam);
 			break;
+		case S_SWITCH:
+			for(i = 0 ; i < stmt->d.s_switch.nbranch ; ++i) {
+				if(stmt->d.s_switch.t_then[i] != NULL)
+					scriptIterateAllActions(stmt->d.s_switch.t_then[i],
+								pFunc, pParam);
+			}
+			if(stmt->d.s_switch.t_else != NULL)
+				scriptIterateAllActions(stmt->d.s_switch.t_else,
+							pFunc, pParam);
+			break;
 		case S_FOREACH:
 			if(stmt->d.s_foreach.body != NULL)
 				scriptIterateAllActions(stmt->d.s_foreach.body,
@@ -253,12 +267,21 @@ execCallIndirect(struct cnfstmt *const __restrict__ stmt,
 
 	cnfexprEval(stmt->d.s_call_ind.expr, &result, pMsg, pWti);
 	uchar *const rsName = (uchar*) var2CString(&result, &bMustFree);
-	const rsRetVal localRet = rulesetGetRuleset(loadConf, &pRuleset, rsName);
-	if(localRet != RS_RET_OK) {
-		/* in that case, we accept that a NOP will "survive" */
-		errmsg.LogError(0, RS_RET_RULESET_NOT_FOUND, "error: CALL_INDIRECT: "
-			"ruleset '%s' cannot be found, treating as NOP\n", rsName);
-		FINALIZE;
+	/* Messages often go to the same ruleset in a row, so we first check
+	 * the ruleset this worker resolved last time. The cache lives in the
+	 * wti, so it needs no locking. Any ruleset it may point to lives as
+	 * long as the config does.
+	 */
+	pRuleset = pWti->execState.pCallIndRuleset;
+	if(pRuleset == NULL || strcasecmp((char*) pRuleset->pszName, (char*) rsName)) {
+		const rsRetVal localRet = rulesetGetRuleset(loadConf, &pRuleset, rsName);
+		if(localRet != RS_RET_OK) {
+			/* in that case, we accept that a NOP will "survive" */
+			errmsg.LogError(0, RS_RET_RULESET_NOT_FOUND, "error: CALL_INDIRECT: "
+				"ruleset '%s' cannot be found, treating as NOP\n", rsName);
+			FINALIZE;
+		}
+		pWti->execState.pCallIndRuleset = pRuleset;
 	}
 	DBGPRINTF("CALL_INDIRECT obtained ruleset ptr %p for ruleset '%s' [hasQueue:%d]\n",
 		  pRuleset, rsName, rulesetHasQueue(pRuleset));
@@ -320,13 +343,52 @@ finalize_it:
 	RETiRet;
 }
 
+/* Execute a S_SWITCH node built by the optimizer from if/else-if chains or
+ * from sequences of independent ifs comparing one property.
+ */
+static rsRetVal
+execSwitch(struct cnfstmt *const stmt, smsg_t *const pMsg, wti_t *const pWti)
+{
+	int i;
+	DEFiRet;
+
+	if(stmt->d.s_switch.isChain) {
+		i = cnfstmtSwitchSelect(stmt, pMsg, pWti, -1);
+		DBGPRINTF("switch selected branch %d\n", i);
+		if(i >= 0) {
+			if(stmt->d.s_switch.t_then[i] != NULL)
+				CHKiRet(scriptExec(stmt->d.s_switch.t_then[i], pMsg, pWti));
+		} else {
+			if(stmt->d.s_switch.t_else != NULL)
+				CHKiRet(scriptExec(stmt->d.s_switch.t_else, pMsg, pWti));
+		}
+	} else {
+		/* a branch may modify the property, so it must be evaluated again
+		 * before we search for the next matching branch.
+		 */
+		for(i = -1 ; i < stmt->d.s_switch.nbranch - 1 ; ) {
+			i = cnfstmtSwitchSelect(stmt, pMsg, pWti, i);
+			DBGPRINTF("switch selected branch %d\n", i);
+			if(i < 0)
+				break;
+			if(stmt->d.s_switch.t_then[i] != NULL)
+				CHKiRet(scriptExec(stmt->d.s_switch.t_then[i], pMsg, pWti));
+		}
+	}
+finalize_it:
+	RETiRet;
+}
+
+/* Note: the collection we iterate over is a private copy obtained by
+ * execForeach(). So we can bind the loop variable to the element by
+ * reference instead of creating yet another copy of it for each iteration.
+ * If the body modifies the loop variable, it modifies only that private
+ * copy, which is discarded after the loop.
+ */
 static rsRetVal
 invokeForeachBodyWith(struct cnfstmt *stmt, json_object *o, smsg_t *pMsg, wti_t *pWti) {
-	struct svar v;
-	v.datatype = 'J';
-	v.d.json = o;
 	DEFiRet;
-	CHKiRet(msgSetJSONFromVar(pMsg, (uchar*)stmt->d.s_foreach.iter->var, &v, 1));
+	CHKiRet(msgAddJSON(pMsg, (uchar*)stmt->d.s_foreach.iter->var, json_object_get(o), 1, 1));
 	CHKiRet(scriptExec(stmt->d.s_foreach.body, pMsg, pWti));
 finalize_it:
 	RETiRet;
@@ -364,14 +426,19 @@ callForeachObject(struct cnfstmt *stmt, json_object *arr, smsg_t *pMsg, wti_t *p
 		json_object_iter_next(&it);
 	}
 	json_object *curr = NULL;
-	CHKmalloc(entry = json_object_new_object());
 	for (int i = 0; i < len; i++) {
 		if (json_object_object_get_ex(arr, keys[i], &curr)) {
+			/* a new entry for each iteration, as the loop variable
+			 * references it (and the body may modify it)
+			 */
+			CHKmalloc(entry = json_object_new_object());
 			CHKmalloc(key = json_object_new_string(keys[i]));
 			json_object_object_add(entry, "key", key);
 			key = NULL;
 			json_object_object_add(entry, "value", json_object_get(curr));
 			CHKiRet(invokeForeachBodyWith(stmt, entry, pMsg, pWti));
+			json_object_put(entry);
+			entry = NULL;
 		}
 	}
 finalize_it:
@@ -611,6 +678,9 @@ scriptExec(struct cnfstmt *const root, smsg_t *const pMsg, wti_t *const pWti)
 		case S_IF:
 			CHKiRet(execIf(stmt, pMsg, pWti));
 			break;
+		case S_SWITCH:
+			CHKiRet(execSwitch(stmt, pMsg, pWti));
+			break;
 		case S_FOREACH:
 			CHKiRet(execForeach(stmt, pMsg, pWti));
 			break;
@@ -736,6 +806,8 @@ GetRulesetQueue(ruleset_t *pThis)
 
 
 /* Find the ruleset with the given name and return a pointer to its object.
+ * Once the config is activated, the name index is used. Before that (while
+ * the config is being loaded), we need to search the list.
  */
 rsRetVal
 rulesetGetRuleset(rsconf_t *conf, ruleset_t **ppRuleset, uchar *pszName)
@@ -744,7 +816,12 @@ rulesetGetRuleset(rsconf_t *conf, ruleset_t **ppRuleset, uchar *pszName)
 	assert(ppRuleset != NULL);
 	assert(pszName != NULL);
 
-	CHKiRet(llFind(&(conf->rulesets.llRulesets), pszName, (void*) ppRuleset));
+	if(conf->rulesets.htRulesets != NULL) {
+		if((*ppRuleset = hashtable_search(conf->rulesets.htRulesets, pszName)) == NULL)
+			ABORT_FINALIZE(RS_RET_NOT_FOUND);
+	} else {
+		CHKiRet(llFind(&(conf->rulesets.llRulesets), pszName, (void*) ppRuleset));
+	}
 
 finalize_it:
 	RETiRet;
@@ -868,6 +945,7 @@ DBGPRINTF("rulesetDestructAllActions\n");
 DBGPRINTF("RRRRRR: rsconfDestruct - queue shutdown\n");
 	llExecFunc(&(conf->rulesets.llRulesets), doShutdownQueueWorkers, NULL);
 
+	rulesetDestructIndex(conf);
 	CHKiRet(llDestroy(&(conf->rulesets.llRulesets)));
 	CHKiRet(llInit(&(conf->rulesets.llRulesets), rulesetDestructForLinkedList, rulesetKeyDestruct, strcasecmp));
 	conf->rulesets.pDflt = NULL;
@@ -936,6 +1014,89 @@ DEFFUNC_llExecFunc(doRulesetOptimizeAll)
 	rulesetOptimize((ruleset_t*) pData);
 	return RS_RET_OK;
 }
+
+
+/* ruleset names are case-insensitive, so we need our own hash functions
+ * for the name index (it must match the strcasecmp() of llRulesets).
+ */
+static unsigned int
+hashRulesetName(void *k)
+{
+	const uchar *p = (const uchar*) k;
+	unsigned int hash = 5381;
+
+	while(*p) {
+		hash = ((hash << 5) + hash) + tolower(*p++); /* hash * 33 + c */
+	}
+	return hash;
+}
+
+static int
+keyEqualsRulesetName(void *key1, void *key2)
+{
+	return !strcasecmp((char*) key1, (char*) key2);
+}
+
+/* helper for rulesetBuildIndex(), adds a single ruleset */
+DEFFUNC_llExecFunc(doRulesetAddToIndex)
+{
+	ruleset_t *const pThis = (ruleset_t*) pData;
+	struct hashtable *const ht = (struct hashtable*) pParam;
+	uchar *keyName;
+	DEFiRet;
+
+	/* llFind() returns the first match, so we must do the same */
+	if(hashtable_search(ht, pThis->pszName) != NULL)
+		FINALIZE;
+	CHKmalloc(keyName = ustrdup(pThis->pszName));
+	if(!hashtable_insert(ht, keyName, pThis)) {
+		free(keyName);
+		ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+	}
+finalize_it:
+	RETiRet;
+}
+
+/* build the name index over all rulesets. This is done once the config is
+ * fully loaded, as no rulesets are added after that point. If we cannot
+ * build the index, lookups simply continue to search the list.
+ */
+static void
+rulesetBuildIndex(rsconf_t *conf)
+{
+	struct hashtable *ht;
+	int nRulesets = 0;
+
+	llGetNumElts(&(conf->rulesets.llRulesets), &nRulesets);
+	ht = create_hashtable(nRulesets < 16 ? 16 : nRulesets, hashRulesetName,
+			      keyEqualsRulesetName, NULL);
+	if(ht == NULL) {
+		DBGPRINTF("ruleset: could not create name index, using list search\n");
+		return;
+	}
+	if(llExecFunc(&(conf->rulesets.llRulesets), doRulesetAddToIndex, ht) != RS_RET_OK) {
+		DBGPRINTF("ruleset: could not fill name index, using list search\n");
+		hashtable_destroy(ht, 0);
+		return;
+	}
+	conf->rulesets.htRulesets = ht;
+	DBGPRINTF("ruleset: built name index over %d rulesets\n", nRulesets);
+}
+
+
+/* destroy the ruleset name index, if one exists. Must be called before the
+ * rulesets themselves are destroyed.
+ */
+void
+rulesetDestructIndex(rsconf_t *conf)
+{
+	if(conf->rulesets.htRulesets != NULL) {
+		hashtable_destroy(conf->rulesets.htRulesets, 0); /* values are owned by llRulesets */
+		conf->rulesets.htRulesets = NULL;
+	}
+}
+
+
 /* optimize all rulesets
  */
 rsRetVal
@@ -944,6 +1105,7 @@ rulesetOptimizeAll(rsconf_t *conf)
 	DEFiRet;
 	dbgprintf("begin ruleset optimization phase\n");
 	llExecFunc(&(conf->rulesets.llRulesets), doRulesetOptimizeAll, NULL);
+	rulesetBuildIndex(conf);
 	dbgprintf("ruleset optimization phase finished.\n");
 	RETiRet;
 }
@@ -1042,7 +1204,7 @@ rulesetProcessCnf(struct cnfobj *o)
 	rsRetVal localRet;
 	uchar *rsName = NULL;
 	uchar *parserName;
-	int nameIdx, parserIdx;
+	int nameIdx, parserIdx, parseIdx;
 	ruleset_t *pRuleset;
 	struct cnfarray *ar;
 	int i;
@@ -1080,7 +1242,7 @@ rulesetProcessCnf(struct cnfobj *o)
 	}
 	addScript(pRuleset, o->script);
 
-	/* we have only two params, so we do NOT do the usual param loop */
+	/* we have only a few params, so we do NOT do the usual param loop */
 	parserIdx = cnfparamGetIdx(&rspblk, "parser");
 	if(parserIdx != -1  && pvals[parserIdx].bUsed) {
 		ar = pvals[parserIdx].val.d.ar;
@@ -1091,6 +1253,15 @@ rulesetProcessCnf(struct cnfobj *o)
 		}
 	}
 
+	parseIdx = cnfparamGetIdx(&rspblk, "parse");
+	if(parseIdx != -1  && pvals[parseIdx].bUsed) {
+		pRuleset->bSkipParsing = !pvals[parseIdx].val.d.n;
+		if(pRuleset->bSkipParsing && pRuleset->pParserLst != NULL) {
+			parser_warnmsg("ruleset '%s': parse=\"off\" given, configured "
+				"parsers will not be used", rsName);
+		}
+	}
+
 	/* pick up ruleset queue parameters */
 	if(queueCnfParamsSet(o->nvlst)) {
 		rsname = (pRuleset->pszName == NULL) ? (uchar*) "[ruleset]" : pRuleset->pszName;
@@ -35,6 +35,7 @@ struct ruleset_s {
 	struct cnfstmt *root;
 	struct cnfstmt *last;
 	parserList_t *pParserLst;/* list of parsers to use for this ruleset */
+	sbool bSkipParsing;	/* raw passthrough: messages bound to this ruleset are not parsed */
 };
 
 /* interfaces */
@@ -96,6 +97,7 @@ rsRetVal rulesetKeyDestruct(void __attribute__((unused)) *pData);
  */
 rsRetVal rulesetGetRuleset(rsconf_t *conf, ruleset_t **ppRuleset, uchar *pszName);
 rsRetVal rulesetOptimizeAll(rsconf_t *conf);
+void rulesetDestructIndex(rsconf_t *conf);
 rsRetVal rulesetProcessCnf(struct cnfobj *o);
 rsRetVal activateRulesetQueues(void);
 
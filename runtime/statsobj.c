@@ -61,6 +61,10 @@ static pthread_mutex_t mutStats;
 static pthread_mutex_t mutSenders;
 
 static struct hashtable *stats_senders = NULL;
+static pthread_mutex_t mutSenderAccums;
+static struct sender_stats_accum *senderAccumRoot = NULL; /* active session accumulators */
+
+static void sweepSenderAccums(void);
 
 /* ------------------------------ statsobj linked list maintenance  ------------------------------ */
 
@@ -127,6 +131,7 @@ BEGINobjConstruct(statsobj) /* be sure to specify the object type also in END ma
 	pThis->ctrLast = NULL;
 	pThis->ctrRoot = NULL;
 	pThis->read_notifier = NULL;
+	pThis->read_prepare = NULL;
 	pThis->flags = 0;
 ENDobjConstruct(statsobj)
 
@@ -153,6 +158,18 @@ setReadNotifier(statsobj_t *pThis, statsobj_read_notifier_t notifier, void* ctx)
 	RETiRet;
 }
 
+/* set read_prepare (a function which is invoked immediately before stats
+ * are read). This permits providers to compute gauges only when needed.
+ */
+static rsRetVal
+setReadPrepare(statsobj_t *pThis, statsobj_read_notifier_t prepare, void* ctx)
+{
+	DEFiRet;
+	pThis->read_prepare = prepare;
+	pThis->read_prepare_ctx = ctx;
+	RETiRet;
+}
+
 
 /* set origin (module name, etc).
  * Note that we make our own copy of the memory, caller is
@@ -483,6 +500,7 @@ getSenderStats(rsRetVal(*cb)(void*, const char*),
 	struct sender_stats *stat;
 	char fmtbuf[2048];
 
+	sweepSenderAccums();
 	pthread_mutex_lock(&mutSenders);
 
 	/* Iterator constructor only returns a valid iterator if
@@ -530,6 +548,9 @@ getAllStatsLines(rsRetVal(*cb)(void*, const char*), void *const usrptr, statsFmt
 	DEFiRet;
 
 	for(o = objRoot ; o != NULL ; o = o->next) {
+		if(o->read_prepare != NULL) {
+			o->read_prepare(o, o->read_prepare_ctx);
+		}
 		switch(fmt) {
 		case statsFmt_Legacy:
 			CHKiRet(getStatsLine(o, &cstr, bResetCtrs));
@@ -571,31 +592,40 @@ rsRetVal
 statsRecordSender(const uchar *sender, unsigned nMsgs, time_t lastSeen)
 {
 	struct sender_stats *stat;
-	int mustUnlock = 0;
+	struct sender_stats *newStat = NULL;
 	DEFiRet;
 
 	if(stats_senders == NULL)
 		FINALIZE;	/* unlikely: we could not init our hash table */
 
 	pthread_mutex_lock(&mutSenders);
-	mustUnlock = 1;
 	stat = hashtable_search(stats_senders, (void*)sender);
 	if(stat == NULL) {
+		/* we do the allocation outside of the lock, so other senders
+		 * are not held up. As such, we need to re-check afterwards.
+		 */
+		pthread_mutex_unlock(&mutSenders);
 		DBGPRINTF("statsRecordSender: sender '%s' not found, adding\n",
 			sender);
-		CHKmalloc(stat = calloc(1, sizeof(struct sender_stats)));
-		stat->sender = (const uchar*)strdup((const char*)sender);
-		stat->nMsgs = 0;
-		if(glblReportNewSenders) {
-			errmsg.LogMsg(0, RS_RET_SENDER_APPEARED,
-				LOG_INFO, "new sender '%s'", stat->sender);
-		}
-		if(hashtable_insert(stats_senders, (void*)stat->sender,
-			(void*)stat) == 0) {
-			errmsg.LogError(errno, RS_RET_INTERNAL_ERROR,
-				"error inserting sender '%s' into sender "
-				"hash table", sender);
-			ABORT_FINALIZE(RS_RET_INTERNAL_ERROR);
+		CHKmalloc(newStat = calloc(1, sizeof(struct sender_stats)));
+		CHKmalloc(newStat->sender = (const uchar*)strdup((const char*)sender));
+		pthread_mutex_lock(&mutSenders);
+		stat = hashtable_search(stats_senders, (void*)sender);
+		if(stat == NULL) {
+			if(hashtable_insert(stats_senders, (void*)newStat->sender,
+				(void*)newStat) == 0) {
+				pthread_mutex_unlock(&mutSenders);
+				errmsg.LogError(errno, RS_RET_INTERNAL_ERROR,
+					"error inserting sender '%s' into sender "
+					"hash table", sender);
+				ABORT_FINALIZE(RS_RET_INTERNAL_ERROR);
+			}
+			stat = newStat;
+			newStat = NULL;
+			if(glblReportNewSenders) {
+				errmsg.LogMsg(0, RS_RET_SENDER_APPEARED,
+					LOG_INFO, "new sender '%s'", stat->sender);
+			}
 		}
 	}
 
@@ -603,13 +633,112 @@ statsRecordSender(const uchar *sender, unsigned nMsgs, time_t lastSeen)
 	stat->lastSeen = lastSeen;
 	DBGPRINTF("DDDDD: statsRecordSender: '%s', nmsgs %u [%llu], lastSeen %llu\n", sender, nMsgs,
 	(long long unsigned) stat->nMsgs, (long long unsigned) lastSeen);
+	pthread_mutex_unlock(&mutSenders);
 
 finalize_it:
-	if(mustUnlock)
-		pthread_mutex_unlock(&mutSenders);
+	if(newStat != NULL) {
+		free((void*)newStat->sender);
+		free(newStat);
+	}
 	RETiRet;
 }
 
+
+/* hand accumulated counts over to the sender table. Caller must hold
+ * acc->mut.
+ */
+static void
+flushSenderAccum(struct sender_stats_accum *const acc)
+{
+	if(acc->lastSeen == 0 || (acc->nMsgs == 0 && acc->lastFlush == acc->lastSeen))
+		return; /* nothing (new) to record */
+	statsRecordSender(acc->sender, acc->nMsgs, acc->lastSeen);
+	acc->nMsgs = 0;
+	acc->lastFlush = acc->lastSeen;
+}
+
+
+/* init a per-session sender stats accumulator. Must be called before
+ * the session receives data.
+ */
+void
+statsSenderAccumInit(struct sender_stats_accum *const acc)
+{
+	memset(acc, 0, sizeof(struct sender_stats_accum));
+	pthread_mutex_init(&acc->mut, NULL);
+}
+
+
+/* record received messages for a sender via a per-session accumulator.
+ * The sender table is only updated when the second changes, so busy
+ * sessions take mutSenders about once per second instead of for
+ * every chunk of data received. Counts of idle sessions are picked up
+ * by sweepSenderAccums(). On first use, the accumulator is added to the
+ * list of active accumulators; sender must remain valid until
+ * statsSenderAccumExit() is called.
+ */
+void
+statsAccumSender(const uchar *sender, struct sender_stats_accum *const acc,
+	const unsigned nMsgs, const time_t lastSeen)
+{
+	if(acc->sender == NULL) {
+		acc->sender = sender;
+		pthread_mutex_lock(&mutSenderAccums);
+		acc->prev = NULL;
+		acc->next = senderAccumRoot;
+		if(senderAccumRoot != NULL)
+			senderAccumRoot->prev = acc;
+		senderAccumRoot = acc;
+		pthread_mutex_unlock(&mutSenderAccums);
+	}
+	pthread_mutex_lock(&acc->mut);
+	acc->nMsgs += nMsgs;
+	acc->lastSeen = lastSeen;
+	if(lastSeen != acc->lastFlush)
+		flushSenderAccum(acc);
+	pthread_mutex_unlock(&acc->mut);
+}
+
+
+/* record what is left in the accumulator and release it. Must be
+ * called before the session is destroyed.
+ */
+void
+statsSenderAccumExit(struct sender_stats_accum *const acc)
+{
+	if(acc->sender != NULL) {
+		pthread_mutex_lock(&mutSenderAccums);
+		if(acc->prev == NULL)
+			senderAccumRoot = acc->next;
+		else
+			acc->prev->next = acc->next;
+		if(acc->next != NULL)
+			acc->next->prev = acc->prev;
+		pthread_mutex_unlock(&mutSenderAccums);
+		flushSenderAccum(acc);
+	}
+	pthread_mutex_destroy(&acc->mut);
+}
+
+
+/* record the counts still pending in the accumulators of all active
+ * sessions. Called before sender stats are emitted or checked, so that
+ * sessions which went idle right after a burst are not undercounted.
+ */
+static void
+sweepSenderAccums(void)
+{
+	struct sender_stats_accum *acc;
+
+	pthread_mutex_lock(&mutSenderAccums);
+	for(acc = senderAccumRoot ; acc != NULL ; acc = acc->next) {
+		pthread_mutex_lock(&acc->mut);
+		flushSenderAccum(acc);
+		pthread_mutex_unlock(&acc->mut);
+	}
+	pthread_mutex_unlock(&mutSenderAccums);
+}
+
 static ctr_t*
 unlinkAllCounters(statsobj_t *pThis) {
 	ctr_t *ctr;
@@ -643,6 +772,7 @@ checkGoneAwaySenders(const time_t tCurr)
 	const time_t rqdLast = tCurr - glblSenderStatsTimeout;
 	struct tm tm;
 
+	sweepSenderAccums();
 	pthread_mutex_lock(&mutSenders);
 
 	/* Iterator constructor only returns a valid iterator if
@@ -725,6 +855,7 @@ CODESTARTobjQueryInterface(statsobj)
 	pIf->DestructUnlinkedCounter = destructUnlinkedCounter;
 	pIf->UnlinkAllCounters = unlinkAllCounters;
 	pIf->EnableStats = enableStats;
+	pIf->SetReadPrepare = setReadPrepare;
 finalize_it:
 ENDobjQueryInterface(statsobj)
 
@@ -743,6 +874,7 @@ BEGINAbstractObjClassInit(statsobj, 1, OBJ_IS_CORE_MODULE) /* class, version */
 	/* init other data items */
 	pthread_mutex_init(&mutStats, NULL);
 	pthread_mutex_init(&mutSenders, NULL);
+	pthread_mutex_init(&mutSenderAccums, NULL);
 
 	if((stats_senders = create_hashtable(100, hash_from_string, key_equals_string, NULL)) == NULL) {
 		errmsg.LogError(0, RS_RET_INTERNAL_ERROR, "error trying to initialize hash-table "
@@ -757,5 +889,6 @@ BEGINObjClassExit(statsobj, OBJ_IS_CORE_MODULE) /* class, version */
 	/* release objects we no longer need */
 	pthread_mutex_destroy(&mutStats);
 	pthread_mutex_destroy(&mutSenders);
+	pthread_mutex_destroy(&mutSenderAccums);
 	hashtable_destroy(stats_senders, 1);
 ENDObjClassExit(statsobj)
@@ -80,6 +80,8 @@ struct statsobj_s {
 	uchar *reporting_ns;
     statsobj_read_notifier_t read_notifier;
     void *read_notifier_ctx;
+	statsobj_read_notifier_t read_prepare; /* called before counters are read */
+	void *read_prepare_ctx;
 	pthread_mutex_t mutCtr;		/* to guard counter linked-list ops */
 	ctr_t *ctrRoot;			/* doubly-linked list of statsobj counters */
 	ctr_t *ctrLast;
@@ -95,6 +97,20 @@ struct sender_stats {
 	time_t lastSeen;
 };
 
+/* per-session accumulator for sender stats. Sessions add up their
+ * message counts here and hand them to the global sender table at most
+ * once per second (and when the session ends), so that the table's
+ * mutex is not taken for each received chunk of data. Counts still
+ * pending are also swept up before sender stats are emitted.
+ */
+struct sender_stats_accum {
+	pthread_mutex_t mut;	/* session vs. stats sweep */
+	const uchar *sender;	/* set on first use, owned by session */
+	unsigned nMsgs;		/* not yet recorded in sender table */
+	time_t lastSeen;
+	time_t lastFlush;	/* when we last updated the sender table */
+	struct sender_stats_accum *prev, *next; /* list of active accumulators */
+};
 
 /* interfaces */
 BEGINinterface(statsobj) /* name must also be changed in ENDinterface macro! */
@@ -119,14 +135,16 @@ BEGINinterface(statsobj) /* name must also be changed in ENDinterface macro! */
 	void (*DestructUnlinkedCounter)(ctr_t *ctr);
 	ctr_t* (*UnlinkAllCounters)(statsobj_t *pThis);
 	rsRetVal (*EnableStats)(void);
+	rsRetVal (*SetReadPrepare)(statsobj_t *pThis, statsobj_read_notifier_t prepare, void* ctx);
 ENDinterface(statsobj)
-#define statsobjCURR_IF_VERSION 13 /* increment whenever you change the interface structure! */
+#define statsobjCURR_IF_VERSION 14 /* increment whenever you change the interface structure! */
 /* Changes
  * v2-v9 rserved for future use in "older" version branches
  * v10, 2012-04-01: GetAllStatsLines got fmt parameter
  * v11, 2013-09-07: - add "flags" to AddCounter API
  *                  - GetAllStatsLines got parameter telling if ctrs shall be reset
  * v13, 2016-05-19: GetAllStatsLines cb data type changed (char* instead of cstr)
+ * v14, 2026-10-18: SetReadPrepare added (hook to update gauges before they are read)
  */
 
 
@@ -134,6 +152,9 @@ ENDinterface(statsobj)
 PROTOTYPEObj(statsobj);
 
 rsRetVal statsRecordSender(const uchar *sender, unsigned nMsgs, time_t lastSeen);
+void statsSenderAccumInit(struct sender_stats_accum *acc);
+void statsAccumSender(const uchar *sender, struct sender_stats_accum *acc, unsigned nMsgs, time_t lastSeen);
+void statsSenderAccumExit(struct sender_stats_accum *acc);
 /* checkGoneAwaySenders() is part of this module because all it needs is
  * done by this module, so even though it's own processing is not directly
  * related to stats, it makes sense to do it here... -- rgerhards, 2016-02-01
@@ -50,6 +50,8 @@
 #include <errno.h>
 #include <pthread.h>
 #include <poll.h>
+#include <dirent.h>
+#include <ctype.h>
 #ifdef HAVE_SYS_PRCTL_H
 #  include <sys/prctl.h>
 #endif
@@ -83,6 +85,7 @@ static rsRetVal strmFlushInternal(strm_t *pThis, int bFlushZip);
 static rsRetVal strmWrite(strm_t *__restrict__ const pThis, const uchar *__restrict__ const pBuf,
 	const size_t lenBuf);
 static rsRetVal strmCloseFile(strm_t *pThis);
+static rsRetVal strmSetCurrFName(strm_t *pThis);
 static void *asyncWriterThread(void *pPtr);
 static rsRetVal doZipWrite(strm_t *pThis, uchar *pBuf, size_t lenBuf, int bFlush);
 static rsRetVal doZipFinish(strm_t *pThis);
@@ -205,6 +208,481 @@ finalize_it:
 }
 
 
+/* Support for built-in file rotation. This is an alternative to outchannel
+ * size limit commands and external logrotate+HUP cycles. The current file is
+ * closed and atomically renamed to <name>.<YYYYMMDD-hhmmss>[-n]; the next write
+ * then re-creates the file. Rotation is checked at record boundaries (inside
+ * strmWrite()), so a message is never split across two files. Optionally, rotated
+ * files are gzip'ed by a background thread, so the writer never needs to wait
+ * for compression, and the number of rotated files can be limited.
+ */
+
+/* background work for rotated files: compression and removal of old files.
+ * A single, on-demand worker thread handles the jobs for all streams, so the
+ * writer never has to wait for either of them. The worker terminates as soon
+ * as there is no more work, so there is nothing to clean up on shutdown: an
+ * unfinished job simply leaves the (complete) uncompressed rotated file or an
+ * extra old rotated file behind.
+ */
+#define ROT_COMPRESS_BUFSIZE (64 * 1024)
+typedef struct rotJob_s {
+	uchar *pszRotName;	/* rotated file to compress, NULL if not to be compressed */
+	int iZipLevel;
+	uchar *pszFName;	/* file whose old rotated files are to be removed, NULL if none */
+	int iMaxFiles;
+	struct rotJob_s *pNext;
+} rotJob_t;
+static pthread_mutex_t mutRotJobs = PTHREAD_MUTEX_INITIALIZER;
+static rotJob_t *rotJobRoot = NULL;
+static rotJob_t *rotJobLast = NULL;
+static sbool bRotWorkerRunning = 0;
+
+/* gzip a single rotated file. The compressed data is written to a temporary
+ * ".gz.part" file, which is renamed to ".gz" only after everything has been
+ * written. Only then the uncompressed file is removed.
+ */
+static rsRetVal
+rotCompressFile(const uchar *const pszFName, const int iZipLevel)
+{
+	char szPartName[MAXFNAME+16];
+	char szGzName[MAXFNAME+16];
+	struct stat statFile;
+	z_stream zstrm;
+	uchar *pInBuf = NULL;
+	uchar *pOutBuf = NULL;
+	ssize_t lenRead;
+	ssize_t lenWritten;
+	size_t lenOut;
+	size_t iOut;
+	int zFlush;
+	int fdIn = -1;
+	int fdOut = -1;
+	sbool bzInitDone = 0;
+	DEFiRet;
+
+	snprintf(szGzName, sizeof(szGzName), "%s.gz", pszFName);
+	snprintf(szPartName, sizeof(szPartName), "%s.gz.part", pszFName);
+
+	if((fdIn = open((char*)pszFName, O_RDONLY | O_CLOEXEC | O_NOCTTY)) == -1
+	   || fstat(fdIn, &statFile) != 0) {
+		LogError(errno, RS_RET_FILE_OPEN_ERROR, "could not open rotated file '%s' "
+			"for compression", pszFName);
+		ABORT_FINALIZE(RS_RET_FILE_OPEN_ERROR);
+	}
+	fdOut = open(szPartName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOCTTY,
+		statFile.st_mode & 0777);
+	if(fdOut == -1) {
+		LogError(errno, RS_RET_FILE_OPEN_ERROR, "could not create compressed "
+			"file '%s'", szPartName);
+		ABORT_FINALIZE(RS_RET_FILE_OPEN_ERROR);
+	}
+	if(fchown(fdOut, statFile.st_uid, statFile.st_gid) != 0) {
+		DBGPRINTF("rotCompressFile: could not set owner of '%s' - ignored\n", szPartName);
+	}
+
+	CHKmalloc(pInBuf = MALLOC(ROT_COMPRESS_BUFSIZE));
+	CHKmalloc(pOutBuf = MALLOC(ROT_COMPRESS_BUFSIZE));
+	memset(&zstrm, 0, sizeof(zstrm));
+	/* see note in file header for the params we use with deflateInit2() */
+	if(zlibw.DeflateInit2(&zstrm, iZipLevel, Z_DEFLATED, 31, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+		LogError(0, RS_RET_ZLIB_ERR, "error initializing zlib for compressing '%s'", pszFName);
+		ABORT_FINALIZE(RS_RET_ZLIB_ERR);
+	}
+	bzInitDone = 1;
+
+	do {
+		lenRead = read(fdIn, pInBuf, ROT_COMPRESS_BUFSIZE);
+		if(lenRead == -1) {
+			if(errno == EINTR)
+				continue;
+			LogError(errno, RS_RET_READ_ERR, "error reading rotated file '%s'", pszFName);
+			ABORT_FINALIZE(RS_RET_READ_ERR);
+		}
+		zstrm.next_in = (Bytef*) pInBuf;
+		zstrm.avail_in = lenRead;
+		zFlush = (lenRead == 0) ? Z_FINISH : Z_NO_FLUSH;
+		do {
+			zstrm.next_out = (Bytef*) pOutBuf;
+			zstrm.avail_out = ROT_COMPRESS_BUFSIZE;
+			if(zlibw.Deflate(&zstrm, zFlush) == Z_STREAM_ERROR) {
+				LogError(0, RS_RET_ZLIB_ERR, "zlib error compressing '%s'", pszFName);
+				ABORT_FINALIZE(RS_RET_ZLIB_ERR);
+			}
+			lenOut = ROT_COMPRESS_BUFSIZE - zstrm.avail_out;
+			for(iOut = 0 ; iOut < lenOut ; iOut += lenWritten) {
+				lenWritten = write(fdOut, pOutBuf + iOut, lenOut - iOut);
+				if(lenWritten == -1) {
+					if(errno == EINTR) {
+						lenWritten = 0;
+						continue;
+					}
+					LogError(errno, RS_RET_IO_ERROR, "error writing compressed "
+						"file '%s'", szPartName);
+					ABORT_FINALIZE(RS_RET_IO_ERROR);
+				}
+			}
+		} while(zstrm.avail_out == 0);
+	} while(lenRead != 0);
+
+	if(close(fdOut) != 0) {
+		fdOut = -1;
+		LogError(errno, RS_RET_IO_ERROR, "error closing compressed file '%s'", szPartName);
+		ABORT_FINALIZE(RS_RET_IO_ERROR);
+	}
+	fdOut = -1;
+	if(rename(szPartName, szGzName) != 0) {
+		LogError(errno, RS_RET_FILE_ROTATE_ERR, "could not rename '%s' to '%s'",
+			szPartName, szGzName);
+		ABORT_FINALIZE(RS_RET_FILE_ROTATE_ERR);
+	}
+	unlink((char*)pszFName);
+	DBGPRINTF("rotCompressFile: compressed rotated file '%s'\n", pszFName);
+
+finalize_it:
+	if(bzInitDone)
+		zlibw.DeflateEnd(&zstrm);
+	if(fdIn != -1)
+		close(fdIn);
+	if(fdOut != -1)
+		close(fdOut);
+	if(iRet != RS_RET_OK)
+		unlink(szPartName);
+	free(pInBuf);
+	free(pOutBuf);
+	RETiRet;
+}
+
+/* a rotated file on disk as found by rotPurgeOldFiles(). All files with the
+ * same timestamp and sequence number belong to the same generation (e.g.
+ * "x.<ts>" and "x.<ts>.gz").
+ */
+#define ROT_TS_LEN 15 /* YYYYMMDD-hhmmss */
+typedef struct rotFile_s {
+	char *pszName;
+	size_t offsTs;
+	int iSeq;	/* 0 if the name has no sequence number */
+} rotFile_t;
+
+/* check if pszName is exactly a rotated file of pszBase, that is
+ * <base>.<YYYYMMDD-hhmmss>[-n][.gz], and if so, return its sequence number.
+ * Other files that merely share the prefix are not ours to delete.
+ */
+static int
+rotParseName(const char *const pszName, const char *const pszBase, const size_t lenBase, int *const piSeq)
+{
+	const char *p;
+	int i;
+
+	if(strncmp(pszName, pszBase, lenBase) || pszName[lenBase] != '.')
+		return 0;
+	p = pszName + lenBase + 1;
+	for(i = 0 ; i < ROT_TS_LEN ; ++i) {
+		if(i == 8 ? p[i] != '-' : !isdigit((unsigned char) p[i]))
+			return 0;
+	}
+	p += ROT_TS_LEN;
+	*piSeq = 0;
+	if(*p == '-') {
+		++p;
+		if(!isdigit((unsigned char) *p))
+			return 0;
+		while(isdigit((unsigned char) *p)) {
+			*piSeq = *piSeq * 10 + (*p - '0');
+			++p;
+		}
+	}
+	return *p == '\0' || !strcmp(p, ".gz");
+}
+
+static int
+rotFileCmp(const void *p1, const void *p2)
+{
+	const rotFile_t *const f1 = (const rotFile_t*) p1;
+	const rotFile_t *const f2 = (const rotFile_t*) p2;
+	const int r = memcmp(f1->pszName + f1->offsTs, f2->pszName + f2->offsTs, ROT_TS_LEN);
+	if(r != 0)
+		return r;
+	return (f1->iSeq < f2->iSeq) ? -1 : ((f1->iSeq > f2->iSeq) ? 1 : 0);
+}
+
+static inline int
+rotFileSameGen(const rotFile_t *const f1, const rotFile_t *const f2)
+{
+	return f1->iSeq == f2->iSeq
+		&& !memcmp(f1->pszName + f1->offsTs, f2->pszName + f2->offsTs, ROT_TS_LEN);
+}
+
+/* remove the oldest rotated files so that at most iMaxFiles generations
+ * are kept. As the rotation suffix starts with a fixed-width timestamp,
+ * sorting by timestamp and sequence number also sorts by age.
+ */
+static rsRetVal
+rotPurgeOldFiles(const uchar *const pszFName, const int iMaxFiles)
+{
+	char szDir[MAXFNAME+1];
+	char szPath[MAXFNAME+1];
+	const char *pszBase;
+	size_t lenBase;
+	DIR *pDir = NULL;
+	struct dirent *pEntry;
+	rotFile_t *pFiles = NULL;
+	rotFile_t *pNew;
+	int nFiles = 0;
+	int nMax = 0;
+	int nGens;
+	int iSeq;
+	int i;
+	DEFiRet;
+
+	pszBase = strrchr((char*)pszFName, '/');
+	if(pszBase == NULL) {
+		strcpy(szDir, ".");
+		pszBase = (char*)pszFName;
+	} else {
+		snprintf(szDir, sizeof(szDir), "%.*s", (int) (pszBase - (char*)pszFName), pszFName);
+		if(szDir[0] == '\0')
+			strcpy(szDir, "/");
+		++pszBase;
+	}
+	lenBase = strlen(pszBase);
+
+	if((pDir = opendir(szDir)) == NULL) {
+		LogError(errno, RS_RET_FILE_ROTATE_ERR, "could not open directory '%s' to "
+			"remove old rotated files", szDir);
+		ABORT_FINALIZE(RS_RET_FILE_ROTATE_ERR);
+	}
+	while((pEntry = readdir(pDir)) != NULL) {
+		if(!rotParseName(pEntry->d_name, pszBase, lenBase, &iSeq))
+			continue;
+		if(nFiles == nMax) {
+			nMax = (nMax == 0) ? 16 : 2 * nMax;
+			CHKmalloc(pNew = realloc(pFiles, nMax * sizeof(rotFile_t)));
+			pFiles = pNew;
+		}
+		CHKmalloc(pFiles[nFiles].pszName = strdup(pEntry->d_name));
+		pFiles[nFiles].offsTs = lenBase + 1;
+		pFiles[nFiles].iSeq = iSeq;
+		++nFiles;
+	}
+	if(nFiles == 0)
+		FINALIZE;
+
+	qsort(pFiles, nFiles, sizeof(rotFile_t), rotFileCmp);
+	nGens = 1;
+	for(i = 1 ; i < nFiles ; ++i) {
+		if(!rotFileSameGen(&pFiles[i-1], &pFiles[i]))
+			++nGens;
+	}
+
+	for(i = 0 ; i < nFiles && nGens > iMaxFiles ; ++i) {
+		snprintf(szPath, sizeof(szPath), "%s/%s", szDir, pFiles[i].pszName);
+		DBGPRINTF("rotPurgeOldFiles: removing '%s'\n", szPath);
+		if(unlink(szPath) != 0) {
+			LogError(errno, RS_RET_FILE_ROTATE_ERR, "could not remove old rotated "
+				"file '%s'", szPath);
+		}
+		if(i + 1 < nFiles && !rotFileSameGen(&pFiles[i], &pFiles[i+1]))
+			--nGens;
+	}
+
+finalize_it:
+	if(pDir != NULL)
+		closedir(pDir);
+	for(i = 0 ; i < nFiles ; ++i)
+		free(pFiles[i].pszName);
+	free(pFiles);
+	RETiRet;
+}
+
+
+static void *
+rotWorker(void __attribute__((unused)) *arg)
+{
+	rotJob_t *pJob;
+
+	dbgOutputTID((char*)"rs:rotate");
+	while(1) {
+		pthread_mutex_lock(&mutRotJobs);
+		pJob = rotJobRoot;
+		if(pJob == NULL) {
+			bRotWorkerRunning = 0;
+			pthread_mutex_unlock(&mutRotJobs);
+			break;
+		}
+		rotJobRoot = pJob->pNext;
+		if(rotJobRoot == NULL)
+			rotJobLast = NULL;
+		pthread_mutex_unlock(&mutRotJobs);
+
+		/* compress first, so that the purge sees the final file names */
+		if(pJob->pszRotName != NULL)
+			rotCompressFile(pJob->pszRotName, pJob->iZipLevel);
+		if(pJob->pszFName != NULL)
+			rotPurgeOldFiles(pJob->pszFName, pJob->iMaxFiles);
+		free(pJob->pszRotName);
+		free(pJob->pszFName);
+		free(pJob);
+	}
+	return NULL;
+}
+
+/* schedule the background work after a rotation: compression of the rotated
+ * file pszRotName (if not NULL) and removal of old rotated files of pszFName
+ * (if iMaxFiles > 0). Starts the worker thread if it is not already running.
+ */
+static rsRetVal
+rotSchedJob(const uchar *const pszRotName, const int iZipLevel,
+	const uchar *const pszFName, const int iMaxFiles)
+{
+	rotJob_t *pJob = NULL;
+	pthread_t thrdID;
+	DEFiRet;
+
+	CHKmalloc(pJob = calloc(1, sizeof(rotJob_t)));
+	if(pszRotName != NULL)
+		CHKmalloc(pJob->pszRotName = ustrdup(pszRotName));
+	pJob->iZipLevel = iZipLevel;
+	if(iMaxFiles > 0)
+		CHKmalloc(pJob->pszFName = ustrdup(pszFName));
+	pJob->iMaxFiles = iMaxFiles;
+
+	pthread_mutex_lock(&mutRotJobs);
+	if(rotJobLast == NULL)
+		rotJobRoot = pJob;
+	else
+		rotJobLast->pNext = pJob;
+	rotJobLast = pJob;
+	pJob = NULL; /* now owned by queue */
+	if(!bRotWorkerRunning) {
+		if(pthread_create(&thrdID, &default_thread_attr, rotWorker, NULL) == 0) {
+			pthread_detach(thrdID);
+			bRotWorkerRunning = 1;
+		} else {
+			LogError(errno, RS_RET_ERR, "could not create file rotation thread - "
+				"rotated files will be processed on next rotation");
+		}
+	}
+	pthread_mutex_unlock(&mutRotJobs);
+
+finalize_it:
+	if(pJob != NULL) {
+		free(pJob->pszRotName);
+		free(pJob->pszFName);
+		free(pJob);
+	}
+	RETiRet;
+}
+
+
+/* compute when the next interval based rotation is due. Intervals that
+ * evenly divide a day are aligned to local time (so that e.g. 3600 rotates
+ * at the top of each hour and 86400 at midnight); all others are simply
+ * counted from tBase.
+ */
+static time_t
+getNextRotateTime(const time_t tBase, const int iInterval)
+{
+	struct tm tmBase;
+	time_t tDayOffs;
+
+	if(86400 % iInterval != 0 || localtime_r(&tBase, &tmBase) == NULL)
+		return tBase + iInterval;
+	tDayOffs = tmBase.tm_hour * 3600 + tmBase.tm_min * 60 + tmBase.tm_sec;
+	return tBase - (tDayOffs % iInterval) + iInterval;
+}
+
+
+/* rotate the current (single) file. This must be called with the async
+ * writer mutex locked (if in async mode), as strmCloseFile() needs to
+ * wait for the writer.
+ */
+static rsRetVal
+strmRotateFile(strm_t *const pThis)
+{
+	uchar *pszFName = NULL;
+	char szRotName[MAXFNAME+32];
+	struct tm tmNow;
+	time_t tNow;
+	size_t lenRotName;
+	int iSeq;
+	DEFiRet;
+
+	CHKiRet(strmCloseFile(pThis));
+	/* strmCloseFile() destroys the current file name, so regenerate it */
+	CHKiRet(strmSetCurrFName(pThis));
+	pszFName = pThis->pszCurrFName;
+	pThis->pszCurrFName = NULL;
+	pThis->tNextRotate = 0;
+
+	tNow = getTime(NULL);
+	localtime_r(&tNow, &tmNow);
+	lenRotName = snprintf(szRotName, sizeof(szRotName), "%s.%4.4d%2.2d%2.2d-%2.2d%2.2d%2.2d",
+		pszFName, tmNow.tm_year + 1900, tmNow.tm_mon + 1, tmNow.tm_mday,
+		tmNow.tm_hour, tmNow.tm_min, tmNow.tm_sec);
+	if(lenRotName >= sizeof(szRotName) - 16) {
+		LogError(0, RS_RET_FILE_ROTATE_ERR, "file name '%s' too long for rotation", pszFName);
+		ABORT_FINALIZE(RS_RET_FILE_ROTATE_ERR);
+	}
+	/* we may rotate more than once per second, so make sure we do not overwrite */
+	for(iSeq = 1 ; access(szRotName, F_OK) == 0 ; ++iSeq) {
+		snprintf(szRotName + lenRotName, sizeof(szRotName) - lenRotName, "-%d", iSeq);
+	}
+
+	if(rename((char*)pszFName, szRotName) != 0) {
+		LogError(errno, RS_RET_FILE_ROTATE_ERR, "could not rotate file '%s' to '%s' - "
+			"built-in rotation disabled for this file", pszFName, szRotName);
+		pThis->iRotateSize = 0;
+		pThis->iRotateInterval = 0;
+		ABORT_FINALIZE(RS_RET_FILE_ROTATE_ERR);
+	}
+	DBGPRINTF("stream: rotated file '%s' to '%s'\n", pszFName, szRotName);
+
+	if(pThis->bRotateCompress || pThis->iRotateMaxFiles > 0) {
+		/* bRotateCompress is only set for streams that are not zipped themselves */
+		rotSchedJob(pThis->bRotateCompress ? (uchar*) szRotName : NULL, Z_DEFAULT_COMPRESSION,
+			pszFName, pThis->iRotateMaxFiles);
+	}
+
+finalize_it:
+	free(pszFName);
+	RETiRet;
+}
+
+
+/* check if the current file needs to be rotated before lenBuf more bytes
+ * are written to it. Rotation failures are reported, but do not stop
+ * writing to the current file.
+ */
+static rsRetVal
+strmChkRotate(strm_t *const pThis, const size_t lenBuf)
+{
+	int64 iSize;
+	DEFiRet;
+
+	if(pThis->fd == -1 || pThis->sType != STREAMTYPE_FILE_SINGLE)
+		FINALIZE;
+
+	if(pThis->iRotateSize != 0) {
+		iSize = pThis->iCurrOffs + pThis->iBufPtr;
+		if(iSize > 0 && iSize + (int64) lenBuf > pThis->iRotateSize) {
+			DBGPRINTF("stream: file '%s' reached rotation size %lld\n",
+				getFileDebugName(pThis), (long long) pThis->iRotateSize);
+			strmRotateFile(pThis);
+			FINALIZE;
+		}
+	}
+
+	if(pThis->iRotateInterval != 0 && pThis->tNextRotate != 0
+	   && getTime(NULL) >= pThis->tNextRotate) {
+		DBGPRINTF("stream: file '%s' reached rotation time\n", getFileDebugName(pThis));
+		strmRotateFile(pThis);
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+
 /* now, we define type-specific handlers. The provide a generic functionality,
  * but for this specific type of strm. The mapping to these handlers happens during
  * strm construction. Later on, handlers are called by pointers present in the
@@ -270,6 +748,12 @@ doPhysOpen(strm_t *pThis)
 			ABORT_FINALIZE(RS_RET_IO_ERROR);
 		}
 		pThis->inode = statOpen.st_ino;
+#		ifdef HAVE_POSIX_FADVISE
+		if(pThis->bSequentialRead) {
+			/* only a hint, so errors do not matter */
+			posix_fadvise(pThis->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		}
+#		endif
 	}
 
 	if(!ustrcmp(pThis->pszCurrFName, UCHAR_CONSTANT(_PATH_CONSOLE)) || isatty(pThis->fd)) {
@@ -291,14 +775,53 @@ finalize_it:
 }
 
 
+/* generate the name of circular file number iFNum. If a secondary directory
+ * is set, a read stream may find the file there (the queue moves completed
+ * files to it). So if the file does not exist in the primary directory but
+ * does in the secondary one, the secondary name is returned. If pbDir2 is
+ * non-NULL, it receives 1 if that was the case and 0 otherwise.
+ */
+static rsRetVal
+strmGenCircularFName(strm_t *pThis, uchar **ppName, unsigned int iFNum, int *pbDir2)
+{
+	uchar *pszName = NULL;
+	uchar *pszName2 = NULL;
+	struct stat statBuf;
+	DEFiRet;
+
+	if(pbDir2 != NULL)
+		*pbDir2 = 0;
+	CHKiRet(genFileName(&pszName, pThis->pszDir, pThis->lenDir,
+			    pThis->pszFName, pThis->lenFName, iFNum, pThis->iFileNumDigits));
+	if(pThis->pszDir2 != NULL && pThis->tOperationsMode == STREAMMODE_READ
+	   && stat((char*) pszName, &statBuf) == -1 && errno == ENOENT) {
+		CHKiRet(genFileName(&pszName2, pThis->pszDir2, pThis->lenDir2,
+				    pThis->pszFName, pThis->lenFName, iFNum, pThis->iFileNumDigits));
+		if(stat((char*) pszName2, &statBuf) == 0) {
+			free(pszName);
+			pszName = pszName2;
+			pszName2 = NULL;
+			if(pbDir2 != NULL)
+				*pbDir2 = 1;
+		}
+	}
+	*ppName = pszName;
+	pszName = NULL;
+
+finalize_it:
+	free(pszName);
+	free(pszName2);
+	RETiRet;
+}
+
+
 static rsRetVal
 strmSetCurrFName(strm_t *pThis)
 {
 	DEFiRet;
 
 	if(pThis->sType == STREAMTYPE_FILE_CIRCULAR) {
-		CHKiRet(genFileName(&pThis->pszCurrFName, pThis->pszDir, pThis->lenDir,
-				    pThis->pszFName, pThis->lenFName, pThis->iCurrFNum, pThis->iFileNumDigits));
+		CHKiRet(strmGenCircularFName(pThis, &pThis->pszCurrFName, pThis->iCurrFNum, NULL));
 	} else {
 		if(pThis->pszDir == NULL) {
 			if((pThis->pszCurrFName = ustrdup(pThis->pszFName)) == NULL)
@@ -375,6 +898,15 @@ static rsRetVal strmOpenFile(strm_t *pThis)
 		}
 	}
 
+	if(pThis->iRotateInterval != 0 && pThis->tOperationsMode != STREAMMODE_READ) {
+		struct stat statFile;
+		time_t tBase = getTime(NULL);
+		/* existing data belongs to the period the file was last written in */
+		if(offset > 0 && fstat(pThis->fd, &statFile) == 0 && statFile.st_mtime < tBase)
+			tBase = statFile.st_mtime;
+		pThis->tNextRotate = getNextRotateTime(tBase, pThis->iRotateInterval);
+	}
+
 	DBGOPRINT((obj_t*) pThis, "opened file '%s' for %s as %d\n", pThis->pszCurrFName,
 		  (pThis->tOperationsMode == STREAMMODE_READ) ? "READ" : "WRITE", pThis->fd);
 
@@ -475,9 +1007,7 @@ static rsRetVal strmCloseFile(strm_t *pThis)
 
 	if(pThis->bDeleteOnClose) {
 		if(pThis->pszCurrFName == NULL) {
-			CHKiRet(genFileName(&pThis->pszCurrFName, pThis->pszDir, pThis->lenDir,
-					    pThis->pszFName, pThis->lenFName, pThis->iCurrFNum,
-					    pThis->iFileNumDigits));
+			CHKiRet(strmGenCircularFName(pThis, &pThis->pszCurrFName, pThis->iCurrFNum, NULL));
 		}			
 		DBGPRINTF("strmCloseFile: deleting '%s'\n", pThis->pszCurrFName);
 		if(unlink((char*) pThis->pszCurrFName) == -1) {
@@ -715,6 +1245,50 @@ finalize_it:
 }
 
 
+/* read the remainder of the current line and append it to pCStr. The
+ * terminating LF is consumed, but not appended. Other than strmReadChar(),
+ * this works on spans of the read buffer, which is much faster for
+ * longer lines. On EOF (or any other error), the data read so far has
+ * already been appended to pCStr.
+ * Note: there must be no unread char pending (see strmUnreadChar()), so
+ * callers usually obtain the first char of the line via strmReadChar().
+ */
+static rsRetVal
+strmReadLineSpan(strm_t *const pThis, cstr_t *const pCStr)
+{
+	const uchar *pStart;
+	const uchar *pLF;
+	size_t lenSpan;
+	int padBytes;
+	DEFiRet;
+
+	assert(pThis->iUngetC == -1);
+	while(1) {
+		if(pThis->iBufPtr >= pThis->iBufPtrMax) {
+			padBytes = 0;
+			CHKiRet(strmReadBuf(pThis, &padBytes));
+			pThis->iCurrOffs += padBytes;
+		}
+		pStart = pThis->pIOBuf + pThis->iBufPtr;
+		lenSpan = pThis->iBufPtrMax - pThis->iBufPtr;
+		pLF = memchr(pStart, '\n', lenSpan);
+		if(pLF != NULL)
+			lenSpan = pLF - pStart;
+		CHKiRet(rsCStrAppendStrWithLen(pCStr, pStart, lenSpan));
+		pThis->iBufPtr += lenSpan;
+		pThis->iCurrOffs += lenSpan;
+		if(pLF != NULL) {
+			++pThis->iBufPtr; /* consume LF */
+			++pThis->iCurrOffs;
+			break;
+		}
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+
 /* unget a single character just like ungetc(). As with that call, there is only a single
  * character buffering capability.
  * rgerhards, 2008-01-07
@@ -750,7 +1324,6 @@ strmReadLine(strm_t *pThis, cstr_t **ppCStr, uint8_t mode, sbool bEscapeLF,
 {
         uchar c;
 	uchar finished;
-	rsRetVal readCharRet;
         DEFiRet;
 
         ASSERT(pThis != NULL);
@@ -768,15 +1341,13 @@ strmReadLine(strm_t *pThis, cstr_t **ppCStr, uint8_t mode, sbool bEscapeLF,
 		cstrDestruct(&pThis->prevLineSegment);
 	}
         if(mode == 0) {
-		while(c != '\n') {
+		if(c != '\n') {
 			CHKiRet(cstrAppendChar(*ppCStr, c));
-			readCharRet = strmReadChar(pThis, &c);
-			if((readCharRet == RS_RET_TIMED_OUT) ||
-			   (readCharRet == RS_RET_EOF) ) { /* end reached without \n? */
-				CHKiRet(rsCStrConstructFromCStr(&pThis->prevLineSegment, *ppCStr));
-                	}
-                	CHKiRet(readCharRet);
-        	}
+			/* end reached without \n? Then the partial line is saved
+			 * as prevLineSegment in finalize_it.
+			 */
+			CHKiRet(strmReadLineSpan(pThis, *ppCStr));
+		}
 		if (trimLineOverBytes > 0 && (uint32_t) cstrLen(*ppCStr) > trimLineOverBytes) {
 			/* Truncate long line at trimLineOverBytes position */
 			dbgprintf("Truncate long line at %u, mode %d\n", trimLineOverBytes, mode);
@@ -910,6 +1481,171 @@ strmReadMultiLine_isTimedOut(const strm_t *const __restrict__ pThis)
 	       && (getTime(NULL) > pThis->lastRead + pThis->readTimeout) );
 }
 
+/* check if a line matches a compiled start pattern */
+static inline int
+strmStartMatches(const strmStartMatch_t *const pMatch, const uchar *const line, const int lenLine)
+{
+	int i;
+
+	if(lenLine < pMatch->nOctets)
+		return 0;
+	for(i = 0 ; i < pMatch->nOctets ; ++i) {
+		if(!(pMatch->permitted[i][line[i] >> 3] & (1 << (line[i] & 0x07))))
+			return 0;
+	}
+	return 1;
+}
+
+static void
+startMatchPermit(uint8_t *const permitted, const uchar c)
+{
+	permitted[c >> 3] |= 1 << (c & 0x07);
+}
+
+/* parse a bracket expression, p points to the octet after the '['. Returns
+ * pointer to the octet after the closing ']' or NULL if the expression is
+ * not supported. Only ASCII is supported, as with multi-byte locales a
+ * non-ASCII char may consist of multiple octets.
+ */
+static const uchar *
+startMatchParseBracket(const uchar *p, uint8_t *const permitted, sbool *const pbNegated)
+{
+	static const struct {
+		const char *name;
+		int (*isClass)(int);
+	} classes[] = {
+		{ "alnum", isalnum }, { "alpha", isalpha }, { "blank", isblank },
+		{ "digit", isdigit }, { "lower", islower }, { "punct", ispunct },
+		{ "space", isspace }, { "upper", isupper }, { "xdigit", isxdigit }
+	};
+	const uchar *start;
+	uchar c, last;
+	size_t len;
+	unsigned i;
+	int j;
+
+	*pbNegated = 0;
+	if(*p == '^') {
+		*pbNegated = 1;
+		++p;
+	}
+	start = p;
+	while(*p != ']' || p == start) {
+		if(*p == '\0' || *p > 0x7f)
+			return NULL;
+		if(*p == '[') {
+			if(p[1] != ':')
+				return NULL; /* collating elements and equivalence classes */
+			p += 2;
+			for(len = 0 ; p[len] != ':' ; ++len)
+				if(p[len] == '\0')
+					return NULL;
+			if(p[len+1] != ']')
+				return NULL;
+			for(i = 0 ; i < sizeof(classes) / sizeof(classes[0]) ; ++i) {
+				if(strlen(classes[i].name) == len && !strncmp(classes[i].name, (const char*)p, len))
+					break;
+			}
+			if(i == sizeof(classes) / sizeof(classes[0]))
+				return NULL;
+			for(j = 0 ; j < 0x80 ; ++j)
+				if(classes[i].isClass(j))
+					startMatchPermit(permitted, j);
+			p += len + 2;
+			continue;
+		}
+		c = *p++;
+		if(*p == '-' && p[1] != ']' && p[1] != '\0') {
+			last = p[1];
+			if(last > 0x7f || last < c || last == '[')
+				return NULL;
+			p += 2;
+		} else {
+			last = c;
+		}
+		for(j = c ; j <= last ; ++j)
+			startMatchPermit(permitted, j);
+	}
+	if(*pbNegated) {
+		for(i = 0 ; i < 32 ; ++i)
+			permitted[i] = ~permitted[i];
+	}
+	return p + 1;
+}
+
+/* Try to compile a regex for multi-line start detection into a form that can
+ * be checked octet by octet (see strmStartMatch_t). If the regex is not
+ * simple enough, *ppMatch is set to NULL and the caller must use the regex
+ * itself. Supported are a start anchor followed by literal (ASCII) octets,
+ * escaped special chars, bracket expressions (including character classes)
+ * and the exact interval "{n}". As a negated bracket expression can match a
+ * multi-byte character, it is only supported as the last element.
+ * RS_RET_OK is returned even if the regex could not be compiled.
+ */
+rsRetVal
+strmCompileStartMatch(const uchar *const regex, strmStartMatch_t **const ppMatch)
+{
+	strmStartMatch_t *pMatch = NULL;
+	const uchar *p = regex;
+	sbool bNegated = 0;
+	int lastAtom = -1;
+	int nRepeat;
+	DEFiRet;
+
+	*ppMatch = NULL;
+	if(*p++ != '^')
+		FINALIZE;
+	CHKmalloc(pMatch = calloc(1, sizeof(strmStartMatch_t)));
+	while(*p != '\0') {
+		if(bNegated)
+			FINALIZE; /* negated bracket expression must be the last element */
+		if(*p == '{') {
+			if(lastAtom == -1 || !isdigit(p[1]))
+				FINALIZE;
+			for(nRepeat = 0, ++p ; isdigit(*p) ; ++p) {
+				nRepeat = nRepeat * 10 + *p - '0';
+				if(nRepeat > STRM_STARTMATCH_MAX)
+					FINALIZE;
+			}
+			if(*p++ != '}' || nRepeat == 0 || pMatch->nOctets + nRepeat - 1 > STRM_STARTMATCH_MAX)
+				FINALIZE;
+			while(--nRepeat > 0) {
+				memcpy(pMatch->permitted[pMatch->nOctets], pMatch->permitted[lastAtom],
+					sizeof(pMatch->permitted[0]));
+				++pMatch->nOctets;
+			}
+			lastAtom = -1; /* no interval on interval */
+			continue;
+		}
+		if(pMatch->nOctets == STRM_STARTMATCH_MAX)
+			FINALIZE;
+		if(*p == '[') {
+			p = startMatchParseBracket(p + 1, pMatch->permitted[pMatch->nOctets], &bNegated);
+			if(p == NULL)
+				FINALIZE;
+		} else if(*p == '\\') {
+			if(p[1] == '\0' || strchr(".[]()*+?{}|^$\\", p[1]) == NULL)
+				FINALIZE; /* not a plain escaped special char */
+			startMatchPermit(pMatch->permitted[pMatch->nOctets], p[1]);
+			p += 2;
+		} else if(*p > 0x7f || strchr(".()*+?|^$]", *p) != NULL) {
+			FINALIZE;
+		} else {
+			startMatchPermit(pMatch->permitted[pMatch->nOctets], *p++);
+		}
+		lastAtom = pMatch->nOctets++;
+		if(bNegated && *p == '{')
+			FINALIZE;
+	}
+	*ppMatch = pMatch;
+	pMatch = NULL;
+	DBGPRINTF("stream: start regex '%s' compiled to %d octet checks\n", regex, (*ppMatch)->nOctets);
+
+finalize_it:
+	free(pMatch);
+	RETiRet;
+}
+
 /* read a multi-line message from a strm file.
  * The multi-line message is terminated based on the user-provided
  * startRegex (Posix ERE). For performance reasons, the regex
@@ -931,25 +1667,30 @@ strmReadMultiLine(strm_t *pThis, cstr_t **ppCStr, regex_t *preg, const sbool bEs
 	do {
 		CHKiRet(strmReadChar(pThis, &c)); /* immediately exit on EOF */
 		pThis->lastRead = tCurr;
-		CHKiRet(cstrConstruct(&thisLine));
-		/* append previous message to current message if necessary */
+		/* continue previous partial line if necessary */
 		if(pThis->prevLineSegment != NULL) {
-			CHKiRet(cstrAppendCStr(thisLine, pThis->prevLineSegment));
-			cstrDestruct(&pThis->prevLineSegment);
+			thisLine = pThis->prevLineSegment;
+			pThis->prevLineSegment = NULL;
+		} else {
+			CHKiRet(cstrConstruct(&thisLine));
 		}
 
-		while(c != '\n') {
+		if(c != '\n') {
 			CHKiRet(cstrAppendChar(thisLine, c));
-			readCharRet = strmReadChar(pThis, &c);
+			readCharRet = strmReadLineSpan(pThis, thisLine);
 			if(readCharRet == RS_RET_EOF) {/* end of file reached without \n? */
-				CHKiRet(rsCStrConstructFromCStr(&pThis->prevLineSegment, thisLine));
+				pThis->prevLineSegment = thisLine;
+				thisLine = NULL;
 			}
 			CHKiRet(readCharRet);
 		}
 		cstrFinalize(thisLine);
 
 		/* we have a line, now let's assemble the message */
-		const int isMatch = !regexec(preg, (char*)rsCStrGetSzStrNoNULL(thisLine), 0, NULL, 0);
+		const int isMatch = (pThis->startMatch == NULL)
+			? !regexec(preg, (char*)rsCStrGetSzStrNoNULL(thisLine), 0, NULL, 0)
+			: strmStartMatches(pThis->startMatch, rsCStrGetBufBeg(thisLine),
+				cstrLen(thisLine));
 
 		if(isMatch) {
 			/* in this case, the *previous* message is complete and we are
@@ -961,14 +1702,19 @@ strmReadMultiLine(strm_t *pThis, cstr_t **ppCStr, regex_t *preg, const sbool bEs
 					finished = 1;
 					*ppCStr = pThis->prevMsgSegment;
 				}
+			} else if(pThis->prevMsgSegment != NULL) {
+				cstrDestruct(&pThis->prevMsgSegment); /* discarded part of truncated msg */
 			}
-			CHKiRet(rsCStrConstructFromCStr(&pThis->prevMsgSegment, thisLine));
+			/* the line becomes the new message, no need to copy it */
+			pThis->prevMsgSegment = thisLine;
+			thisLine = NULL;
 			pThis->ignoringMsg = 0;
 		} else {
 			if(pThis->ignoringMsg == 0) {
 				if(pThis->prevMsgSegment == NULL) {
 					/* may be NULL in initial poll or after timeout! */
-					CHKiRet(rsCStrConstructFromCStr(&pThis->prevMsgSegment, thisLine));
+					pThis->prevMsgSegment = thisLine;
+					thisLine = NULL;
 				} else {
 					if(bEscapeLF) {
 						rsCStrAppendStrWithLen(pThis->prevMsgSegment, (uchar*)"\\n", 2);
@@ -1017,7 +1763,8 @@ strmReadMultiLine(strm_t *pThis, cstr_t **ppCStr, regex_t *preg, const sbool bEs
 				}
 			}
 		}
-		cstrDestruct(&thisLine);
+		if(thisLine != NULL)
+			cstrDestruct(&thisLine);
 	} while(finished == 0);
 
 finalize_it:
@@ -1058,6 +1805,11 @@ BEGINobjConstruct(strm) /* be sure to specify the object type also in END macro!
 	pThis->sIOBufSize = glblGetIOBufSize();
 	pThis->tOpenMode = 0600;
 	pThis->pszSizeLimitCmd = NULL;
+	pThis->iRotateSize = 0;
+	pThis->iRotateInterval = 0;
+	pThis->iRotateMaxFiles = 0;
+	pThis->bRotateCompress = 0;
+	pThis->tNextRotate = 0;
 	pThis->prevLineSegment = NULL;
 	pThis->prevMsgSegment = NULL;
 	pThis->strtOffs = 0;
@@ -1096,6 +1848,18 @@ static rsRetVal strmConstructFinalize(strm_t *pThis)
 		}
 	}
 
+	/* rotated files are only compressed if the file itself is not already zipped */
+	if(pThis->bRotateCompress && !pThis->iZipLevel) {
+		localRet = objUse(zlibw, LM_ZLIBW_FILENAME);
+		if(localRet != RS_RET_OK) {
+			pThis->bRotateCompress = 0;
+			LogError(0, localRet, "stream was requested to compress rotated files, but zlibw "
+				"module is unavailable - rotated files will not be compressed");
+		}
+	} else {
+		pThis->bRotateCompress = 0;
+	}
+
 	/* if we are set to sync, we must obtain a file handle to the directory for fsync() purposes */
 	if(pThis->bSync && !pThis->bIsTTY && pThis->pszDir != NULL) {
 		pThis->fdDir = open((char*)pThis->pszDir, O_RDONLY | O_CLOEXEC | O_NOCTTY);
@@ -1194,6 +1958,7 @@ CODESTARTobjDestruct(strm)
 	if(pThis->prevMsgSegment)
 		cstrDestruct(&pThis->prevMsgSegment);
 	free(pThis->pszDir);
+	free(pThis->pszDir2);
 	free(pThis->pZipBuf);
 	free(pThis->pszCurrFName);
 	free(pThis->pszFName);
@@ -1800,16 +2565,20 @@ finalize_it:
  * handler (if and when it does ;)).
  * The output parameter bytesDel receives the number of bytes that have
  * been deleted (if a file is deleted) or 0 if nothing was deleted.
+ * If pbDir2 is non-NULL, it is set to 1 if the deleted file resided in
+ * the secondary directory (see strmSetDir2()), else to 0.
  * rgerhards, 2012-11-07
  */
 rsRetVal
-strmMultiFileSeek(strm_t *pThis, unsigned int FNum, off64_t offs, off64_t *bytesDel)
+strmMultiFileSeek(strm_t *pThis, unsigned int FNum, off64_t offs, off64_t *bytesDel, int *pbDir2)
 {
 	struct stat statBuf;
 	DEFiRet;
 
 	ISOBJ_TYPE_assert(pThis, strm);
 
+	if(pbDir2 != NULL)
+		*pbDir2 = 0;
 	if(FNum == 0 && offs == 0) { /* happens during queue init */
 		*bytesDel = 0;
 		FINALIZE;
@@ -1820,9 +2589,9 @@ strmMultiFileSeek(strm_t *pThis, unsigned int FNum, off64_t offs, off64_t *bytes
 		 * assumption that is being used also by the whole rest of the
 		 * code and most notably the queue subsystem.
 		 */
-		CHKiRet(genFileName(&pThis->pszCurrFName, pThis->pszDir, pThis->lenDir,
-				    pThis->pszFName, pThis->lenFName, pThis->iCurrFNum,
-				    pThis->iFileNumDigits));
+		free(pThis->pszCurrFName);
+		pThis->pszCurrFName = NULL;
+		CHKiRet(strmGenCircularFName(pThis, &pThis->pszCurrFName, pThis->iCurrFNum, pbDir2));
 		if(stat((char*)pThis->pszCurrFName, &statBuf) != 0) {
 			LogError(errno, RS_RET_IO_ERROR, "unexpected error doing a stat() "
 				"on file %s - further malfunctions may happen",
@@ -1963,6 +2732,9 @@ pThis->bDisabled, (long) pThis->iSizeLimit, (long long) pThis->iCurrOffs); */
 	if(pThis->bAsyncWrite)
 		d_pthread_mutex_lock(&pThis->mut);
 
+	if(pThis->iRotateSize != 0 || pThis->iRotateInterval != 0)
+		CHKiRet(strmChkRotate(pThis, lenBuf));
+
 	iOffset = 0;
 	do {
 		if(pThis->iBufPtr == pThis->sIOBufSize) {
@@ -2017,6 +2789,21 @@ DEFpropSetMeth(strm, iFlushInterval, int)
 DEFpropSetMeth(strm, pszSizeLimitCmd, uchar*)
 DEFpropSetMeth(strm, cryprov, cryprov_if_t*)
 DEFpropSetMeth(strm, cryprovData, void*)
+DEFpropSetMeth(strm, iRotateSize, off_t)
+DEFpropSetMeth(strm, iRotateInterval, int)
+DEFpropSetMeth(strm, iRotateMaxFiles, int)
+DEFpropSetMeth(strm, bRotateCompress, int)
+DEFpropSetMeth(strm, bSequentialRead, int)
+
+/* use compiled start pattern instead of regex in strmReadMultiLine(). The
+ * pattern must have been created from the same regex and is not owned by
+ * the stream.
+ */
+void
+strmSetStartMatch(strm_t *const __restrict__ pThis, const strmStartMatch_t *const pMatch)
+{
+	pThis->startMatch = pMatch;
+}
 
 /* sets timeout in seconds */
 void
@@ -2104,6 +2891,30 @@ finalize_it:
 }
 
 
+/* set the stream's secondary directory. Only used for circular files
+ * opened for reading: if a file is not found in the regular directory,
+ * it is looked up in the secondary one. The passed-in string is duplicated.
+ */
+static rsRetVal
+strmSetDir2(strm_t *pThis, uchar *pszDir, size_t iLenDir)
+{
+	DEFiRet;
+
+	ASSERT(pThis != NULL);
+	ASSERT(pszDir != NULL);
+
+	if(iLenDir < 1)
+		ABORT_FINALIZE(RS_RET_FILE_PREFIX_MISSING);
+
+	free(pThis->pszDir2);
+	CHKmalloc(pThis->pszDir2 = ustrdup(pszDir));
+	pThis->lenDir2 = iLenDir;
+
+finalize_it:
+	RETiRet;
+}
+
+
 /* support for data records
  * The stream class is able to write to multiple files. However, there are
  * situation (actually quite common), where a single data record should not
@@ -2234,6 +3045,10 @@ strmDup(strm_t *const pThis, strm_t **ppNew)
 	pNew->lenFName = pThis->lenFName;
 	CHKmalloc(pNew->pszDir = ustrdup(pThis->pszDir));
 	pNew->lenDir = pThis->lenDir;
+	if(pThis->pszDir2 != NULL) {
+		CHKmalloc(pNew->pszDir2 = ustrdup(pThis->pszDir2));
+		pNew->lenDir2 = pThis->lenDir2;
+	}
 	pNew->tOperationsMode = pThis->tOperationsMode;
 	pNew->tOpenMode = pThis->tOpenMode;
 	pNew->iMaxFileSize = pThis->iMaxFileSize;
@@ -2400,6 +3215,12 @@ CODESTARTobjQueryInterface(strm)
 	pIf->SetpszSizeLimitCmd = strmSetpszSizeLimitCmd;
 	pIf->Setcryprov = strmSetcryprov;
 	pIf->SetcryprovData = strmSetcryprovData;
+	pIf->SetiRotateSize = strmSetiRotateSize;
+	pIf->SetiRotateInterval = strmSetiRotateInterval;
+	pIf->SetiRotateMaxFiles = strmSetiRotateMaxFiles;
+	pIf->SetbRotateCompress = strmSetbRotateCompress;
+	pIf->SetDir2 = strmSetDir2;
+	pIf->SetbSequentialRead = strmSetbSequentialRead;
 finalize_it:
 ENDobjQueryInterface(strm)
 
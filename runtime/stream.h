@@ -92,6 +92,19 @@ typedef enum {				/* when extending, do NOT change existing modes! */
 } strmMode_t;
 
 #define STREAM_ASYNC_NUMBUFS 2 /* must be a power of 2 -- TODO: make configurable */
+
+/* Compiled form of a "simple" multi-line start regex, that is one that only
+ * consists of a start anchor followed by literal octets and bracket
+ * expressions, optionally with an exact repeat count. Such regexes can be
+ * checked octet by octet, which is much faster than regexec().
+ * See strmCompileStartMatch().
+ */
+#define STRM_STARTMATCH_MAX 64	/* max number of octets to check */
+typedef struct strmStartMatch_s {
+	int nOctets;	/* number of leading octets to check */
+	uint8_t permitted[STRM_STARTMATCH_MAX][32]; /* bitmap of permitted values per octet */
+} strmStartMatch_t;
+
 /* The strm_t data structure */
 typedef struct strm_s {
 	BEGINobjInstance;	/* Data to implement generic object - MUST be the first data element! */
@@ -114,9 +127,12 @@ typedef struct strm_s {
 	sbool bDisabled; /* should file no longer be written to? (currently set only if omfile file size limit fails) */
 	sbool bSync;	/* sync this file after every write? */
 	sbool bReopenOnTruncate;
+	sbool bSequentialRead; /* hint the OS that the file is read sequentially (readahead) */
 	size_t sIOBufSize;/* size of IO buffer */
 	uchar *pszDir; /* Directory */
 	int lenDir;
+	uchar *pszDir2; /* secondary directory for circular files (NULL if none) */
+	int lenDir2;
 	int fd;		/* the file descriptor, -1 if closed */
 	int fdDir;	/* the directory's descriptor, in case bSync is requested (-1 if closed) */
 	int readTimeout;/* 0: do not timeout */
@@ -157,6 +173,12 @@ typedef struct strm_s {
 	/* support for omfile size-limiting commands, special counters, NOT persisted! */
 	off_t	iSizeLimit;	/* file size limit, 0 = no limit */
 	uchar	*pszSizeLimitCmd;	/* command to carry out when size limit is reached */
+	/* support for built-in file rotation (omfile), NOT persisted! */
+	off_t	iRotateSize;	/* rotate file when it would grow beyond this size, 0 = never */
+	int	iRotateInterval;/* rotate file on this time boundary (in seconds), 0 = never */
+	int	iRotateMaxFiles;/* max number of rotated files to keep, 0 = unlimited */
+	sbool	bRotateCompress;/* gzip rotated files in the background? */
+	time_t	tNextRotate;	/* when the next interval based rotation is due (0 = not yet known) */
 	sbool	bIsTTY;		/* is this a tty file? */
 	cstr_t *prevLineSegment; /* for ReadLine, previous, unprocessed part of file */
 	cstr_t *prevMsgSegment; /* for ReadMultiLine, previous, yet unprocessed part of msg */
@@ -164,6 +186,7 @@ typedef struct strm_s {
 	int fileNotFoundError;
 	int noRepeatedErrorOutput; /* if a file is missing the Error is only given once */
 	int ignoringMsg;
+	const strmStartMatch_t *startMatch; /* for ReadMultiLine, use instead of regex if set (not owned) */
 } strm_t;
 
 
@@ -213,22 +236,37 @@ BEGINinterface(strm) /* name must also be changed in ENDinterface macro! */
 	/* v9 added  2013-04-04 */
 	INTERFACEpropSetMeth(strm, cryprov, cryprov_if_t*);
 	INTERFACEpropSetMeth(strm, cryprovData, void*);
+	/* v14 added */
+	INTERFACEpropSetMeth(strm, iRotateSize, off_t);
+	INTERFACEpropSetMeth(strm, iRotateInterval, int);
+	INTERFACEpropSetMeth(strm, iRotateMaxFiles, int);
+	INTERFACEpropSetMeth(strm, bRotateCompress, int);
+	/* v15 added */
+	rsRetVal (*SetDir2)(strm_t *pThis, uchar *pszDir, size_t iLenDir);
+	/* v16 added */
+	INTERFACEpropSetMeth(strm, bSequentialRead, int);
 ENDinterface(strm)
-#define strmCURR_IF_VERSION 13 /* increment whenever you change the interface structure! */
+#define strmCURR_IF_VERSION 16 /* increment whenever you change the interface structure! */
 /* V10, 2013-09-10: added new parameter bEscapeLF, changed mode to uint8_t (rgerhards) */
 /* V11, 2015-12-03: added new parameter bReopenOnTruncate */
 /* V12, 2015-12-11: added new parameter trimLineOverBytes, changed mode to uint32_t */
 /* V13, 2017-09-06: added new parameter strtoffs to ReadLine() */
+/* V14: added built-in rotation properties (iRotateSize & friends) */
+/* V15: added SetDir2() for a secondary directory of circular files */
+/* V16: added bSequentialRead property */
 
 #define strmGetCurrFileNum(pStrm) ((pStrm)->iCurrFNum)
 
 /* prototypes */
 PROTOTYPEObjClassInit(strm);
-rsRetVal strmMultiFileSeek(strm_t *pThis, unsigned int fileNum, off64_t offs, off64_t *bytesDel);
+rsRetVal strmMultiFileSeek(strm_t *pThis, unsigned int fileNum, off64_t offs, off64_t *bytesDel,
+	int *pbDir2);
 rsRetVal strmReadMultiLine(strm_t *pThis, cstr_t **ppCStr, regex_t *preg,
 	sbool bEscapeLF, sbool discardTruncatedMsg, sbool msgDiscardingError, int64 *const strtOffs);
 int strmReadMultiLine_isTimedOut(const strm_t *const __restrict__ pThis);
 void strmDebugOutBuf(const strm_t *const pThis);
 void strmSetReadTimeout(strm_t *const __restrict__ pThis, const int val);
+rsRetVal strmCompileStartMatch(const uchar *const regex, strmStartMatch_t **const ppMatch);
+void strmSetStartMatch(strm_t *const __restrict__ pThis, const strmStartMatch_t *const pMatch);
 
 #endif /* #ifndef STREAM_H_INCLUDED */
@@ -69,6 +69,7 @@ BEGINobjConstruct(tcps_sess) /* be sure to specify the object type also in END m
 		pThis->iMsg = 0; /* just make sure... */
 		pThis->inputState = eAtStrtFram; /* indicate frame header expected */
 		pThis->eFraming = TCP_FRAMING_OCTET_STUFFING; /* just make sure... */
+		statsSenderAccumInit(&pThis->senderStats);
 		/* now allocate the message reception buffer */
 		CHKmalloc(pThis->pMsg = (uchar*) MALLOC(glbl.GetMaxLine() + 1));
 finalize_it:
@@ -102,6 +103,7 @@ CODESTARTobjDestruct(tcps_sess)
 		pThis->pSrv->pOnSessDestruct(&pThis->pUsr);
 	}
 	/* now destruct our own properties */
+	statsSenderAccumExit(&pThis->senderStats);
 	if(pThis->fromHost != NULL)
 		CHKiRet(prop.Destruct(&pThis->fromHost));
 	if(pThis->fromHostIP != NULL)
@@ -530,7 +532,7 @@ DataRcvd(tcps_sess_t *pThis, char *pData, const size_t iLen)
 	iRet = multiSubmitFlush(&multiSub);
 
 	if(glblSenderKeepTrack)
-		statsRecordSender(propGetSzStr(pThis->fromHost), nMsgs, ttGenTime);
+		statsAccumSender(propGetSzStr(pThis->fromHost), &pThis->senderStats, nMsgs, ttGenTime);
 
 finalize_it:
 	RETiRet;
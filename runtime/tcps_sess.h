@@ -24,6 +24,7 @@
 
 #include "obj.h"
 #include "prop.h"
+#include "statsobj.h"
 
 /* a forward-definition, we are somewhat cyclic */
 struct tcpsrv_s;
@@ -48,6 +49,7 @@ struct tcps_sess_s {
 	uchar *pMsg;		/* message (fragment) received */
 	prop_t *fromHost;	/* host name we received messages from */
 	prop_t *fromHostIP;
+	struct sender_stats_accum senderStats; /* for senders.keepTrack */
 	void *pUsr;		/* a user-pointer */
 	rsRetVal (*DoSubmitMessage)(tcps_sess_t*, uchar*, int); /* submit message callback */
 };
@@ -47,9 +47,11 @@ typedef struct actWrkrInfo {
 	uint16_t uResumeOKinRow;/* number of times in a row that resume said OK with an
 				   immediate failure following */
 	int	iNbrResRtry;	/* number of retries since last suspend */
+	int	iNbrParkedRtry;	/* resume retries done while parked (action.resumeAsync) */
 	sbool	bHadAutoCommit;	/* did an auto-commit happen during doAction()? */
 	struct {
 		unsigned actState : 3;
+		unsigned bParked : 1;	/* action waits for timer-driven resume (action.resumeAsync) */
 	} flags;
 	union {
 		struct {
@@ -85,6 +87,7 @@ struct wti_s {
 		                        * this is usually set for batches with 0 element, but may
 					* also be added as a user-selectable option (not implemented yet)
 					*/
+		ruleset_t *pCallIndRuleset; /* ruleset resolved by the last CALL_INDIRECT of this worker */
 	} execState;	/* state for the execution engine */
 };
 
@@ -116,6 +119,8 @@ PROTOTYPEpropSetMeth(wti, pWtp, wtp_t*);
 #define getActionNbrResRtry(pWti, pAction) (((pWti)->actWrkrInfo[(pAction)->iActionNbr].iNbrResRtry))
 #define setActionNbrResRtry(pWti, pAction, val) ((pWti)->actWrkrInfo[(pAction)->iActionNbr].iNbrResRtry = (val))
 #define incActionNbrResRtry(pWti, pAction) ((pWti)->actWrkrInfo[(pAction)->iActionNbr].iNbrResRtry++)
+#define getActionParked(pWti, pAction) ((pWti)->actWrkrInfo[(pAction)->iActionNbr].flags.bParked)
+#define setActionParked(pWti, pAction, val) ((pWti)->actWrkrInfo[(pAction)->iActionNbr].flags.bParked = (val))
 #define wtiInitIParam(piparams) (memset((piparams), 0, sizeof(actWrkrIParams_t)))
 
 #define wtiGetScriptErrno(pWti) ((pWti)->execState.script_errno)
@@ -0,0 +1,43 @@
+#!/bin/bash
+# Check that the action.errorFile dead-letter file is rotated once it
+# reaches action.errorfile.maxsize, that only the previous generation is
+# kept and that the newest records are in the current file.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [action-errorfile-maxsize.sh]
+. $srcdir/diag.sh init
+rm -f rsyslog.errorfile.log*
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/omtesting/.libs/omtestingnontx")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+if $msg contains "msgnum:" then
+	action(name="nontxaction" type="omtestingnontx" file="rsyslog.out.log" template="outfmt"
+	       datafail.match="0" action.errorFile="rsyslog.errorfile.log"
+	       action.errorfile.maxsize="2k")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 200
+. $srcdir/diag.sh wait-queueempty
+sleep 1 # old files are removed in the background
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+
+ls -l rsyslog.errorfile.log*
+size=$(wc -c < rsyslog.errorfile.log)
+if [ "$size" -gt 2048 ]; then
+	echo "FAIL: error file has $size bytes, more than maxsize"
+	. $srcdir/diag.sh error-exit 1
+fi
+nrotated=$(ls rsyslog.errorfile.log.2* | wc -l)
+if [ "$nrotated" -ne 1 ]; then
+	echo "FAIL: expected 1 rotated error file to be kept, found $nrotated"
+	. $srcdir/diag.sh error-exit 1
+fi
+if ! grep -q '"message": *"00000199\\n"' rsyslog.errorfile.log; then
+	echo "FAIL: newest record not in current error file"
+	cat rsyslog.errorfile.log
+	. $srcdir/diag.sh error-exit 1
+fi
+rm -f rsyslog.errorfile.log*
+. $srcdir/diag.sh exit
@@ -0,0 +1,37 @@
+#!/bin/bash
+# Check that messages which permanently failed in a non-transactional
+# action are written to the action.errorFile dead-letter file, one JSON
+# record per message, and that all other messages are still delivered.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [action-errorfile-nontx.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/omtesting/.libs/omtestingnontx")
+
+template(name="outfmt" type="string" string="%$!bad%%$.num%\n")
+if $msg contains "msgnum:" then {
+	set $.num = field($msg, 58, 2);
+	if $.num % 100 == 50 then
+		set $!bad = "BAD";
+	action(name="nontxaction" type="omtestingnontx" file="rsyslog.out.log" template="outfmt"
+	       datafail.match="BAD" action.errorFile="rsyslog.errorfile.log")
+}
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 1000
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+nlines=$(wc -l < rsyslog.out.log)
+if [ "$nlines" -ne 990 ]; then
+	echo "FAIL: expected 990 delivered messages, got $nlines"
+	. $srcdir/diag.sh error-exit 1
+fi
+nerr=$(grep -c '"action": *"nontxaction", *"status": *-2218, *"time": *"[0-9T:Z-]*", *"message": *"BAD00000[0-9]50\\n"' rsyslog.errorfile.log)
+if [ "$nerr" -ne 10 ]; then
+	echo "FAIL: expected 10 records in error file, got $nerr"
+	cat rsyslog.errorfile.log
+	. $srcdir/diag.sh error-exit 1
+fi
+rm -f rsyslog.errorfile.log
+. $srcdir/diag.sh exit
@@ -0,0 +1,38 @@
+#!/bin/bash
+# checks that action.resumeAsync is refused for transactional actions,
+# which then use regular resume retries: the action is suspended for the
+# first couple of seconds, and no message must be lost or duplicated.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [action-resumeasync-tx.sh]
+messages=10000 # how many messages to inject?
+. $srcdir/diag.sh init
+touch rsyslog.suspend
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/omtesting/.libs/omtestingtx")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" {
+	action(name="txaction" type="omtestingtx" file="rsyslog.out.log" template="outfmt"
+	       suspendfile="rsyslog.suspend"
+	       queue.type="LinkedList"
+	       action.resumeAsync="on"
+	       action.resumeRetryCount="-1"
+	       action.resumeInterval="1")
+	stop
+}
+action(type="omfile" file="rsyslog2.out.log")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 $messages
+sleep 3
+rm -f rsyslog.suspend
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+if ! grep -q "action 'txaction': action.resumeAsync is not supported for transactional" rsyslog2.out.log; then
+	echo "FAIL: expected config warning not found. rsyslog2.out.log is:"
+	cat rsyslog2.out.log
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh seq-check 0 $(($messages-1))
+. $srcdir/diag.sh exit
@@ -0,0 +1,31 @@
+#!/bin/bash
+# checks that messages are kept while a non-transactional action with
+# action.resumeAsync is parked. The action is suspended for the first
+# couple of seconds. No message must be lost or duplicated.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [action-resumeasync.sh]
+messages=10000 # how many messages to inject?
+. $srcdir/diag.sh init
+touch rsyslog.suspend
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/omtesting/.libs/omtestingnontx")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" {
+	action(type="omtestingnontx" file="rsyslog.out.log" template="outfmt"
+	       suspendfile="rsyslog.suspend"
+	       queue.type="LinkedList"
+	       action.resumeAsync="on"
+	       action.resumeRetryCount="-1"
+	       action.resumeInterval="1")
+}
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 $messages
+sleep 3
+rm -f rsyslog.suspend
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 $(($messages-1))
+. $srcdir/diag.sh exit
@@ -0,0 +1,52 @@
+#!/bin/bash
+# Check that failed transactional batches are bisected to isolate the bad
+# messages: all good messages must be committed exactly once, the bad ones
+# dropped, and the number of single-message commits must stay close to the
+# number of bad messages (instead of one commit per message of a failed batch).
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [action-tx-bisect.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/omtesting/.libs/omtestingtx")
+
+template(name="outfmt" type="string" string="%$!bad%%$.num%\n")
+if $msg contains "msgnum:" then {
+	set $.num = field($msg, 58, 2);
+	if $.num % 100 == 50 then
+		set $!bad = "BAD";
+	action(type="omtestingtx" file="rsyslog.out.log" template="outfmt"
+	       datafail.match="BAD" commitlog="rsyslog.commit.log"
+	       queue.type="linkedlist" queue.dequeuebatchsize="128"
+	       queue.dequeueslowdown="100000")
+}
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 1000
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+for i in $(seq 0 999); do
+	if [ $((i % 100)) -ne 50 ]; then
+		printf '%08d\n' $i
+	fi
+done > rsyslog.expected.log
+$RS_SORTCMD rsyslog.out.log > rsyslog.sorted.log
+if ! cmp -s rsyslog.expected.log rsyslog.sorted.log; then
+	echo "FAIL: unexpected output, diff expected vs. actual:"
+	diff rsyslog.expected.log rsyslog.sorted.log | head -20
+	. $srcdir/diag.sh error-exit 1
+fi
+nfail=$(grep -c '^commit 1 -2218$' rsyslog.commit.log)
+if [ "$nfail" -ne 10 ]; then
+	echo "FAIL: expected 10 isolated bad messages, got $nfail"
+	cat rsyslog.commit.log
+	. $srcdir/diag.sh error-exit 1
+fi
+nsingle=$(grep -c '^commit 1 ' rsyslog.commit.log)
+if [ "$nsingle" -gt 40 ]; then
+	echo "FAIL: $nsingle single-message commits, batch was not bisected"
+	cat rsyslog.commit.log
+	. $srcdir/diag.sh error-exit 1
+fi
+rm -f rsyslog.expected.log rsyslog.sorted.log rsyslog.commit.log
+. $srcdir/diag.sh exit
@@ -0,0 +1,77 @@
+# a very simplistic AMQP 1.0 message sink for the omamqp1 tests.
+#
+# Everything of interest is logged to the output file, one event per line:
+#   listening
+#   link <link name>
+#   release <delivery number>     (released, omamqp1 must send it again)
+#   hold <delivery number>        (never settled, see --hold)
+#   msg <log message>             (one line per item of an accepted batch)
+#
+# Options:
+#   --port n --outfile name (required)
+#   --release n  release the first n deliveries instead of accepting them
+#   --hold       do not settle deliveries at all (shutdown while in flight)
+#
+# This file is part of the rsyslog project, released under ASL 2.0
+import argparse
+import sys
+
+from proton.handlers import MessagingHandler
+from proton.reactor import Container
+
+
+class TestPeer(MessagingHandler):
+    def __init__(self, url, out, release, hold):
+        super(TestPeer, self).__init__(auto_accept=False)
+        self.url = url
+        self.out = out
+        self.release_left = release
+        self.hold = hold
+        self.deliveries = 0
+
+    def log(self, line):
+        self.out.write(line + "\n")
+        self.out.flush()
+
+    def on_start(self, event):
+        event.container.listen(self.url)
+        self.log("listening")
+
+    def on_link_opening(self, event):
+        if event.link.is_receiver:
+            event.link.target.address = event.link.remote_target.address
+        self.log("link %s" % event.link.name)
+
+    def on_message(self, event):
+        self.deliveries += 1
+        if self.hold:
+            self.log("hold %d" % self.deliveries)
+        elif self.release_left > 0:
+            self.release_left -= 1
+            self.log("release %d" % self.deliveries)
+            self.release(event.delivery, delivered=False)
+        else:
+            for item in event.message.body:
+                self.log("msg %s" % item.rstrip("\n"))
+            self.accept(event.delivery)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--port", type=int, required=True)
+    parser.add_argument("--outfile", required=True)
+    parser.add_argument("--release", type=int, default=0)
+    parser.add_argument("--hold", action="store_true")
+    args = parser.parse_args()
+
+    out = open(args.outfile, "w")
+    container = Container(TestPeer("127.0.0.1:%d" % args.port, out,
+                                   args.release, args.hold))
+    # omamqp1 is configured with disableSASL="1"
+    container.sasl_enabled = False
+    # we run until killed by the test script
+    container.run()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,46 @@
+#!/bin/bash
+# checks a disk queue with a secondary spool directory: completed queue
+# segments are moved to the secondary directory while the queue is
+# backlogged, and all messages must still be delivered in full. After the
+# queue has drained, no segment must be left over in either directory.
+# The queue's secondary.segmentsmoved counter proves that segments were
+# actually moved.
+# This file is part of the rsyslog project, released under ASL 2.0
+. $srcdir/diag.sh init
+rm -rf test-spool2
+mkdir test-spool2
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+ruleset(name="stats") {
+	action(type="omfile" file="./rsyslog.out.stats.log")
+}
+
+module(load="../plugins/impstats/.libs/impstats" interval="1" severity="7"
+	Ruleset="stats" bracketing="on" format="json")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" action(name="spooled" type="omfile" template="outfmt" file="rsyslog.out.log"
+	queue.type="disk" queue.filename="actq" queue.spooldirectory="test-spool"
+	queue.maxfilesize="10k" queue.dequeuebatchsize="10" queue.dequeueslowdown="1000"
+	queue.secondaryspooldirectory="test-spool2")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 20000
+. $srcdir/diag.sh wait-for-stats-flush 'rsyslog.out.stats.log'
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 19999
+MOVED=$(grep '"name": "spooled queue"' rsyslog.out.stats.log | \
+	sed -n 's/.*"secondary\.segmentsmoved": \([0-9]*\).*/\1/p' | sort -n | tail -1)
+if [ -z "$MOVED" ] || [ "$MOVED" -eq 0 ]; then
+	echo "FAIL: no segments moved to secondary spool directory"
+	grep '"name": "spooled queue"' rsyslog.out.stats.log
+	. $srcdir/diag.sh error-exit 1
+fi
+if [ -n "$(ls test-spool2)" ]; then
+	echo "FAIL: segments left over in secondary spool directory:"
+	ls -l test-spool2
+	. $srcdir/diag.sh error-exit 1
+fi
+rm -rf test-spool2
+. $srcdir/diag.sh exit
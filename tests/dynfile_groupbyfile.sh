@@ -0,0 +1,32 @@
+#!/bin/bash
+# checks omfile dynafile.groupbyfile: messages of a batch are spread over
+# several dynafiles and must all be written, each file in message order.
+# This file is part of the rsyslog project, released under ASL 2.0
+. $srcdir/diag.sh init
+rm -f rsyslog.out.*.log
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+template(name="dynfile" type="string" string="rsyslog.out.%$.f%.log")
+
+if $msg contains "msgnum:" then {
+	set $.f = cnum(field($msg, 58, 2)) % 5;
+	action(type="omfile" dynafile="dynfile" template="outfmt"
+		dynafile.groupbyfile="on" flushontxend="on"
+		queue.type="linkedlist" queue.dequeuebatchsize="512")
+}
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 20000
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+for f in rsyslog.out.*.log ; do
+	if ! sort -c -n $f ; then
+		echo "FAIL: $f is not in message order"
+		. $srcdir/diag.sh error-exit 1
+	fi
+done
+cat rsyslog.out.*.log > rsyslog.out.log
+rm -f rsyslog.out.*.log
+. $srcdir/diag.sh seq-check 0 19999
+. $srcdir/diag.sh exit
@@ -0,0 +1,25 @@
+#!/bin/bash
+# checks imfile bulk load mode: a large pre-existing file must be
+# read completely, with all lines in sequence.
+# This file is part of the rsyslog project, released under ASL 2.0
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+global(workDirectory="test-spool")
+
+module(load="../plugins/imfile/.libs/imfile")
+
+input(type="imfile" file="./rsyslog.input" tag="file:" bulkLoad="on")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+if $msg contains "msgnum:" then
+	action(type="omfile" file="rsyslog.out.log" template="outfmt")
+'
+# generate input file first. Note that rsyslog processes it as
+# soon as it start up (so the file should exist at that point).
+./inputfilegen -m 200000 > rsyslog.input
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh shutdown-when-empty # shut down rsyslogd when done processing messages
+. $srcdir/diag.sh wait-shutdown	# we need to wait until rsyslogd is finished!
+. $srcdir/diag.sh seq-check 0 199999
+. $srcdir/diag.sh exit
@@ -0,0 +1,40 @@
+#!/bin/bash
+# Check multi-line processing with a start regex that is simple enough to be
+# checked octet by octet instead of via regexec(). Input resembles Java
+# stack traces. The last message is not complete (no following start line)
+# and thus must not be emitted.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [imfile-endregex-fastmatch.sh]
+. $srcdir/diag.sh check-inotify
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/imfile/.libs/imfile")
+
+input(type="imfile" file="./rsyslog.input" tag="file:"
+	startmsg.regex="^[[:digit:]]{4}-[0-9]{2}-[0-9]{2} ")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+template(name="fullmsg" type="string" string="%msg%\n")
+if $msg contains "msgnum:" then {
+	action(type="omfile" file="rsyslog.out.log" template="outfmt")
+	action(type="omfile" file="rsyslog2.out.log" template="fullmsg")
+}
+'
+for i in $(seq 0 1000); do
+	printf '2017-12-01 msgnum:%8.8d: java.lang.IllegalStateException: test\n' $i
+	printf '\tat com.example.Foo.bar(Foo.java:%d)\n\tat com.example.Foo.main(Foo.java:1)\n' $i
+done > rsyslog.input
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 999
+
+# each message must contain its continuation lines
+NUMTRACES=$(grep -c 'Foo.java:[0-9]*).*Foo.main' rsyslog2.out.log)
+if [ "$NUMTRACES" != "1000" ]; then
+	echo "FAIL: expected 1000 messages with complete stack trace, got $NUMTRACES"
+	head rsyslog2.out.log
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
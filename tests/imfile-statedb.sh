@@ -0,0 +1,43 @@
+#!/bin/bash
+# Check that file state is kept in the state database (module parameter
+# stateDatabase) and correctly picked up after a restart: no message must
+# be lost or duplicated and no per-file state files must be created.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [imfile-statedb.sh]
+. $srcdir/diag.sh check-inotify
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+global(workDirectory="test-spool")
+
+module(load="../plugins/imfile/.libs/imfile" stateDatabase="imfile-state.db")
+
+input(type="imfile" file="./rsyslog.input" tag="file:" PersistStateInterval="100")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+if $msg contains "msgnum:" then
+	action(type="omfile" file="rsyslog.out.log" template="outfmt")
+'
+./inputfilegen -m 5000 > rsyslog.input
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+
+if [ ! -s test-spool/imfile-state.db ]; then
+	echo "FAIL: state database test-spool/imfile-state.db missing or empty"
+	ls -l test-spool
+	. $srcdir/diag.sh error-exit 1
+fi
+if ls test-spool/imfile-state:* > /dev/null 2>&1; then
+	echo "FAIL: per-file state file created although state database is in use"
+	ls -l test-spool
+	. $srcdir/diag.sh error-exit 1
+fi
+
+# add more data while rsyslog is down, it must continue where it stopped
+./inputfilegen -m 5000 -i 5000 >> rsyslog.input
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 9999
+. $srcdir/diag.sh exit
@@ -0,0 +1,43 @@
+#!/bin/bash
+# Microbenchmark for foreach over large JSON arrays: sends messages with a
+# 1000-element array and loops over it. Besides checking the result, the
+# time needed for processing is reported, so that changes to the foreach
+# implementation can be compared.
+# This file is part of the rsyslog project, released under ASL 2.0
+NUMMESSAGES=1000
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/mmjsonparse/.libs/mmjsonparse")
+module(load="../plugins/imptcp/.libs/imptcp")
+input(type="imptcp" port="13514")
+template(name="outfmt" type="string" string="%$.sum%\n")
+
+action(type="mmjsonparse")
+if $parsesuccess == "OK" then {
+	set $.sum = 0;
+	foreach ($.e in $!arr) do {
+		set $.sum = $.sum + $.e;
+	}
+	action(type="omfile" file="rsyslog.out.log" template="outfmt")
+}
+'
+arr=$(seq -s, 0 999)
+for i in $(seq 1 $NUMMESSAGES); do
+	echo "<167>Mar  6 16:57:54 172.20.245.8 tag: @cee:{\"arr\": [$arr]}"
+done > rsyslog.input
+. $srcdir/diag.sh startup
+START=$(date +%s%N)
+. $srcdir/diag.sh tcpflood -I rsyslog.input
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+END=$(date +%s%N)
+echo "foreach over $NUMMESSAGES x 1000 array elements took $(( (END - START) / 1000000 )) ms"
+
+if [ "$(grep -c '^499500$' rsyslog.out.log)" != "$NUMMESSAGES" ]; then
+	echo "FAIL: expected $NUMMESSAGES lines with sum 499500, got:"
+	sort rsyslog.out.log | uniq -c
+	. $srcdir/diag.sh error-exit 1
+fi
+rm -f rsyslog.input
+. $srcdir/diag.sh exit
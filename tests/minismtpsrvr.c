@@ -0,0 +1,214 @@
+/* a very simplistic SMTP sink for the rsyslog testbench.
+ *
+ * Sessions are handled one after the other. Everything of interest is
+ * logged to the output file, one event per line:
+ *   connect <session>
+ *   subject <session> <text>
+ *   body <session> <line>        (dot-stuffing removed)
+ *   mail <session> <mail number within session>
+ *   drop <session>               (we closed the session, see -d)
+ *   quit <session>
+ *   close <session>              (client closed without QUIT)
+ *
+ * Options:
+ *   -t ip-addr -p port -f outfile (required)
+ *   -d n  drop (close) each session after n mails, without notice to the
+ *         client, just like servers do that enforce session limits
+ *
+ * Copyright 2018 Adiscon GmbH.
+ *
+ * This file is part of the rsyslog project.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#if defined(__FreeBSD__)
+#include <netinet/in.h>
+#endif
+
+static FILE *fpOut;
+static char rcvBuf[4096];
+static size_t lenRcvBuf;
+static size_t iRcvBuf;
+
+static void
+errout(const char *reason)
+{
+	perror(reason);
+	exit(1);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: minismtpsrv -t ip-addr -p port -f outfile [-d mails-per-session]\n");
+	exit (1);
+}
+
+/* read a line (without CRLF) from the client. Returns 0 on EOF. */
+static int
+readLine(const int fd, char *const ln, const size_t lenLn)
+{
+	size_t i = 0;
+	ssize_t nRead;
+	char c;
+
+	while(1) {
+		if(iRcvBuf == lenRcvBuf) {
+			nRead = read(fd, rcvBuf, sizeof(rcvBuf));
+			if(nRead <= 0)
+				return 0;
+			lenRcvBuf = nRead;
+			iRcvBuf = 0;
+		}
+		c = rcvBuf[iRcvBuf++];
+		if(c == '\n')
+			break;
+		if(c != '\r' && i < lenLn - 1)
+			ln[i++] = c;
+	}
+	ln[i] = '\0';
+	return 1;
+}
+
+static void
+reply(const int fd, const char *const msg)
+{
+	if(write(fd, msg, strlen(msg)) != (ssize_t) strlen(msg))
+		perror("write");
+}
+
+/* process a single SMTP session */
+static void
+doSession(const int fd, const int nSess, const int dropAfter)
+{
+	char ln[8192];
+	int nMails = 0;
+	int inHeader;
+
+	iRcvBuf = lenRcvBuf = 0;
+	fprintf(fpOut, "connect %d\n", nSess);
+	reply(fd, "220 minismtpsrv ready\r\n");
+	while(readLine(fd, ln, sizeof(ln))) {
+		if(!strncasecmp(ln, "HELO", 4) || !strncasecmp(ln, "EHLO", 4)
+		   || !strncasecmp(ln, "MAIL FROM:", 10) || !strncasecmp(ln, "RCPT TO:", 8)
+		   || !strncasecmp(ln, "RSET", 4) || !strncasecmp(ln, "NOOP", 4)) {
+			reply(fd, "250 OK\r\n");
+		} else if(!strncasecmp(ln, "DATA", 4)) {
+			reply(fd, "354 go ahead\r\n");
+			inHeader = 1;
+			while(1) {
+				if(!readLine(fd, ln, sizeof(ln))) {
+					fprintf(fpOut, "close %d\n", nSess);
+					return;
+				}
+				if(!strcmp(ln, "."))
+					break;
+				if(inHeader) {
+					if(ln[0] == '\0')
+						inHeader = 0;
+					else if(!strncmp(ln, "Subject: ", 9))
+						fprintf(fpOut, "subject %d %s\n", nSess, ln + 9);
+				} else if(ln[0] != '\0') {
+					fprintf(fpOut, "body %d %s\n", nSess, (ln[0] == '.') ? ln + 1 : ln);
+				}
+			}
+			reply(fd, "250 queued\r\n");
+			fprintf(fpOut, "mail %d %d\n", nSess, ++nMails);
+			if(dropAfter > 0 && nMails == dropAfter) {
+				fprintf(fpOut, "drop %d\n", nSess);
+				return;
+			}
+		} else if(!strncasecmp(ln, "QUIT", 4)) {
+			reply(fd, "221 bye\r\n");
+			fprintf(fpOut, "quit %d\n", nSess);
+			return;
+		} else {
+			reply(fd, "500 unrecognized command\r\n");
+		}
+	}
+	fprintf(fpOut, "close %d\n", nSess);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int fds;
+	int fdc;
+	struct sockaddr_in srvAddr;
+	struct sockaddr_in cliAddr;
+	socklen_t cliAddrLen;
+	int opt;
+	int on = 1;
+	int nSess = 0;
+	int dropAfter = 0;
+	char *targetIP = NULL;
+	int targetPort = -1;
+
+	while((opt = getopt(argc, argv, "t:p:f:d:")) != -1) {
+		switch (opt) {
+		case 't':
+			targetIP = optarg;
+			break;
+		case 'p':
+			targetPort = atoi(optarg);
+			break;
+		case 'f':
+			if((fpOut = fopen(optarg, "w")) == NULL)
+				errout(optarg);
+			setvbuf(fpOut, NULL, _IOLBF, 0);
+			break;
+		case 'd':
+			dropAfter = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "invalid option '%c' or value missing - terminating...\n", opt);
+			usage();
+			break;
+		}
+	}
+
+	if(targetIP == NULL || targetPort == -1 || fpOut == NULL)
+		usage();
+
+	fds = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(fds, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	memset(&srvAddr, 0, sizeof(srvAddr));
+	srvAddr.sin_family = AF_INET;
+	srvAddr.sin_addr.s_addr = inet_addr(targetIP);
+	srvAddr.sin_port = htons(targetPort);
+	if(bind(fds, (struct sockaddr *)&srvAddr, sizeof(srvAddr)) != 0)
+		errout("bind");
+	if(listen(fds, 20) != 0)
+		errout("listen");
+
+	/* we run until killed by the test script */
+	while(1) {
+		cliAddrLen = sizeof(cliAddr);
+		if((fdc = accept(fds, (struct sockaddr *)&cliAddr, &cliAddrLen)) == -1)
+			errout("accept");
+		doSession(fdc, ++nSess, dropAfter);
+		close(fdc);
+	}
+	return 0;
+}
@@ -0,0 +1,47 @@
+#!/bin/bash
+# Check that omamqp1 opens the configured number of sender links and that
+# batches are spread over them without losing or duplicating messages.
+# Needs the qpid-proton python binding for the test peer, skipped otherwise.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [omamqp1-links.sh]
+if ! python3 -c "import proton" 2>/dev/null; then
+	echo "python3 qpid-proton binding not available, skipping test"
+	exit 77
+fi
+. $srcdir/diag.sh init
+python3 $srcdir/amqp1-testpeer.py --port 13530 --outfile rsyslog.out.amqp.log &
+BGPROCESS=$!
+# wait until the peer accepts connections
+i=0
+while ! grep -qs '^listening' rsyslog.out.amqp.log; do
+	./msleep 100
+	let "i++"
+	if test $i -gt $TB_TIMEOUT_STARTSTOP; then
+		echo "FAIL: AMQP test peer did not start"
+		. $srcdir/diag.sh error-exit 1
+	fi
+done
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../contrib/omamqp1/.libs/omamqp1")
+template(name="outfmt" type="string" string="%msg:F,58:2%")
+if $msg contains "msgnum:" then
+	action(type="omamqp1" host="127.0.0.1:13530" target="rsyslog-test"
+		disableSASL="1" links="2" template="outfmt"
+		queue.type="linkedList" queue.workerThreads="4"
+		queue.dequeueBatchSize="50")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 5000
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+kill $BGPROCESS
+wait $BGPROCESS
+grep '^msg ' rsyslog.out.amqp.log | cut -d' ' -f2 > rsyslog.out.log
+. $srcdir/diag.sh seq-check 0 4999
+if [ $(grep -c '^link ' rsyslog.out.amqp.log) -ne 2 ]; then
+	echo "FAIL: expected omamqp1 to open two links"
+	grep '^link ' rsyslog.out.amqp.log
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
@@ -0,0 +1,50 @@
+#!/bin/bash
+# Check that batches released by the message bus are sent again, and that
+# the retry count is kept per batch: the peer releases more deliveries in
+# total than maxRetries, but no single batch is released that often, so
+# no message must be dropped.
+# Needs the qpid-proton python binding for the test peer, skipped otherwise.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [omamqp1-release-retry.sh]
+if ! python3 -c "import proton" 2>/dev/null; then
+	echo "python3 qpid-proton binding not available, skipping test"
+	exit 77
+fi
+. $srcdir/diag.sh init
+python3 $srcdir/amqp1-testpeer.py --port 13531 --outfile rsyslog.out.amqp.log --release 6 &
+BGPROCESS=$!
+# wait until the peer accepts connections
+i=0
+while ! grep -qs '^listening' rsyslog.out.amqp.log; do
+	./msleep 100
+	let "i++"
+	if test $i -gt $TB_TIMEOUT_STARTSTOP; then
+		echo "FAIL: AMQP test peer did not start"
+		. $srcdir/diag.sh error-exit 1
+	fi
+done
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../contrib/omamqp1/.libs/omamqp1")
+template(name="outfmt" type="string" string="%msg:F,58:2%")
+if $msg contains "msgnum:" then
+	action(type="omamqp1" host="127.0.0.1:13531" target="rsyslog-test"
+		disableSASL="1" links="2" maxRetries="4" template="outfmt"
+		queue.type="linkedList" queue.workerThreads="4"
+		queue.dequeueBatchSize="50"
+		action.resumeRetryCount="-1" action.resumeInterval="1")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 1000
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+kill $BGPROCESS
+wait $BGPROCESS
+if [ $(grep -c '^release ' rsyslog.out.amqp.log) -ne 6 ]; then
+	echo "FAIL: expected the peer to release six deliveries"
+	grep '^release ' rsyslog.out.amqp.log
+	. $srcdir/diag.sh error-exit 1
+fi
+grep '^msg ' rsyslog.out.amqp.log | cut -d' ' -f2 > rsyslog.out.log
+. $srcdir/diag.sh seq-check 0 999
+. $srcdir/diag.sh exit
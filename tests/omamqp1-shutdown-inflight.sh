@@ -0,0 +1,53 @@
+#!/bin/bash
+# Check that rsyslog shuts down cleanly while omamqp1 deliveries are still
+# unsettled at the message bus: the workers waiting for them are cancelled
+# and their send requests must be released by the protocol thread.
+# Needs the qpid-proton python binding for the test peer, skipped otherwise.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [omamqp1-shutdown-inflight.sh]
+if ! python3 -c "import proton" 2>/dev/null; then
+	echo "python3 qpid-proton binding not available, skipping test"
+	exit 77
+fi
+. $srcdir/diag.sh init
+python3 $srcdir/amqp1-testpeer.py --port 13532 --outfile rsyslog.out.amqp.log --hold &
+BGPROCESS=$!
+# wait until the peer accepts connections
+i=0
+while ! grep -qs '^listening' rsyslog.out.amqp.log; do
+	./msleep 100
+	let "i++"
+	if test $i -gt $TB_TIMEOUT_STARTSTOP; then
+		echo "FAIL: AMQP test peer did not start"
+		. $srcdir/diag.sh error-exit 1
+	fi
+done
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../contrib/omamqp1/.libs/omamqp1")
+template(name="outfmt" type="string" string="%msg:F,58:2%")
+if $msg contains "msgnum:" then
+	action(type="omamqp1" host="127.0.0.1:13532" target="rsyslog-test"
+		disableSASL="1" links="2" template="outfmt"
+		queue.type="linkedList" queue.workerThreads="4"
+		queue.dequeueBatchSize="10" queue.timeoutShutdown="1000"
+		queue.timeoutActionCompletion="1000")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 100
+# wait until several batches are in flight at the same time
+i=0
+while [ $(grep -c '^hold ' rsyslog.out.amqp.log) -lt 2 ]; do
+	./msleep 100
+	let "i++"
+	if test $i -gt $TB_TIMEOUT_STARTSTOP; then
+		echo "FAIL: omamqp1 did not send to the peer"
+		cat rsyslog.out.amqp.log
+		. $srcdir/diag.sh error-exit 1
+	fi
+done
+. $srcdir/diag.sh shutdown-immediate
+. $srcdir/diag.sh wait-shutdown
+kill $BGPROCESS
+wait $BGPROCESS
+. $srcdir/diag.sh exit
@@ -0,0 +1,36 @@
+#!/bin/bash
+# checks omfile built-in rotation with compression of rotated files: rotated
+# files are gzip'ed in the background, and all messages must be present in
+# the current, the compressed and possibly not yet compressed rotated files.
+# This file is part of the rsyslog project, released under ASL 2.0
+. $srcdir/diag.sh init
+rm -f rsyslog.out.log.2*
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" action(type="omfile" template="outfmt" file="rsyslog.out.log"
+	rotation.sizelimit="50k" rotation.compress="on")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 20000
+. $srcdir/diag.sh wait-queueempty
+sleep 1 # give the background compression some time
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+
+ls -l rsyslog.out.log*
+if ! ls rsyslog.out.log.2*.gz > /dev/null 2>&1; then
+	echo "FAIL: no compressed rotated file found"
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh setzcat
+for f in rsyslog.out.log.2* ; do
+	case $f in
+	*.gz)	$ZCAT $f >> rsyslog.out.log ;;
+	*.part)	;; # compression interrupted by shutdown, original is still there
+	*)	cat $f >> rsyslog.out.log ;;
+	esac
+done
+rm -f rsyslog.out.log.2*
+. $srcdir/diag.sh seq-check 0 19999
+. $srcdir/diag.sh exit
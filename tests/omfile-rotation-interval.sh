@@ -0,0 +1,34 @@
+#!/bin/bash
+# checks omfile built-in time-based rotation: messages written in different
+# rotation intervals must end up in different files, and all messages must
+# be present in the current and the rotated files.
+# This file is part of the rsyslog project, released under ASL 2.0
+. $srcdir/diag.sh init
+rm -f rsyslog.out.log.2*
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" action(type="omfile" template="outfmt" file="rsyslog.out.log"
+	rotation.interval="1")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 100
+. $srcdir/diag.sh wait-queueempty
+sleep 2
+. $srcdir/diag.sh injectmsg 100 100
+. $srcdir/diag.sh wait-queueempty
+sleep 2
+. $srcdir/diag.sh injectmsg 200 100
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+
+ls -l rsyslog.out.log*
+nrotated=$(ls rsyslog.out.log.2* | wc -l)
+if [ $nrotated -lt 2 ]; then
+	echo "FAIL: expected at least 2 rotated files, found $nrotated"
+	. $srcdir/diag.sh error-exit 1
+fi
+cat rsyslog.out.log.2* >> rsyslog.out.log
+rm -f rsyslog.out.log.2*
+. $srcdir/diag.sh seq-check 0 299
+. $srcdir/diag.sh exit
@@ -0,0 +1,36 @@
+#!/bin/bash
+# checks omfile built-in rotation with rotation.maxfiles: only the newest
+# rotated files must be kept, and files that merely share the name prefix
+# must not be touched.
+# This file is part of the rsyslog project, released under ASL 2.0
+. $srcdir/diag.sh init
+rm -f rsyslog.out.log.2* rsyslog.out.log.1-backup rsyslog.out.log.10x
+echo "not a rotated file" > rsyslog.out.log.1-backup
+echo "not a rotated file" > rsyslog.out.log.10x
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" action(type="omfile" template="outfmt" file="rsyslog.out.log"
+	rotation.sizelimit="10k" rotation.maxfiles="2")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 20000
+. $srcdir/diag.sh wait-queueempty
+sleep 1 # old files are removed in the background
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+
+ls -l rsyslog.out.log*
+nrotated=$(ls rsyslog.out.log.2* | wc -l)
+if [ $nrotated -ne 2 ]; then
+	echo "FAIL: expected 2 rotated files to be kept, found $nrotated"
+	. $srcdir/diag.sh error-exit 1
+fi
+if [ ! -f rsyslog.out.log.1-backup ] || [ ! -f rsyslog.out.log.10x ]; then
+	echo "FAIL: purge removed a file that is not a rotated file"
+	. $srcdir/diag.sh error-exit 1
+fi
+# the newest messages must have been kept
+. $srcdir/diag.sh content-check "19999"
+rm -f rsyslog.out.log.2* rsyslog.out.log.1-backup rsyslog.out.log.10x
+. $srcdir/diag.sh exit
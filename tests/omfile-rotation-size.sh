@@ -0,0 +1,34 @@
+#!/bin/bash
+# checks omfile built-in size-based rotation: all messages must be present
+# in the current and the rotated files, and no rotated file must grow
+# beyond the configured size limit.
+# This file is part of the rsyslog project, released under ASL 2.0
+. $srcdir/diag.sh init
+rm -f rsyslog.out.log.2*
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" action(type="omfile" template="outfmt" file="rsyslog.out.log"
+	rotation.sizelimit="50k")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 20000
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+
+ls -l rsyslog.out.log*
+nrotated=$(ls rsyslog.out.log.2* | wc -l)
+if [ $nrotated -lt 2 ]; then
+	echo "FAIL: expected at least 2 rotated files, found $nrotated"
+	. $srcdir/diag.sh error-exit 1
+fi
+for f in rsyslog.out.log.2* ; do
+	if [ $(wc -c < $f) -gt 51200 ]; then
+		echo "FAIL: rotated file $f is larger than the size limit"
+		. $srcdir/diag.sh error-exit 1
+	fi
+done
+cat rsyslog.out.log.2* >> rsyslog.out.log
+rm -f rsyslog.out.log.2*
+. $srcdir/diag.sh seq-check 0 19999
+. $srcdir/diag.sh exit
@@ -0,0 +1,42 @@
+#!/bin/bash
+# Check that ommail in digest mode sends a batch as a single mail with one
+# entry per line, even if the template does not end with a line break.
+# The server is started late, so that messages pile up in the action queue
+# and are delivered in (at most) two batches once the action resumes.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [ommail-digest.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/ommail/.libs/ommail")
+template(name="outfmt" type="string" string="%msg:F,58:2%")
+if $msg contains "msgnum:" then
+	action(type="ommail" server="127.0.0.1" port="13525"
+		mailfrom="rsyslog@example.net" mailto="operator@example.net"
+		subject.text="digest" template="outfmt" digest.enable="on"
+		queue.type="linkedList" action.resumeInterval="1"
+		action.resumeRetryCount="-1")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 10
+sleep 1
+./minismtpsrv -t127.0.0.1 -p13525 -frsyslog.out.smtp.log &
+BGPROCESS=$!
+for i in $(seq 1 100); do
+	if [ -f rsyslog.out.smtp.log ] && [ $(grep -c '^body ' rsyslog.out.smtp.log) -ge 10 ]; then
+		break
+	fi
+	./msleep 100
+done
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+kill $BGPROCESS
+wait $BGPROCESS
+grep '^body ' rsyslog.out.smtp.log | cut -d' ' -f3 > rsyslog.out.log
+. $srcdir/diag.sh seq-check 0 9
+if [ $(grep -c '^mail ' rsyslog.out.smtp.log) -gt 2 ]; then
+	echo "FAIL: expected the messages to be sent as digest mails"
+	cat rsyslog.out.smtp.log
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
@@ -0,0 +1,39 @@
+#!/bin/bash
+# Check that ommail politely closes an SMTP session that has been idle for
+# longer than session.idletimeout and opens a new one for the next mail.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [ommail-session-idletimeout.sh]
+. $srcdir/diag.sh init
+./minismtpsrv -t127.0.0.1 -p13525 -frsyslog.out.smtp.log &
+BGPROCESS=$!
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/ommail/.libs/ommail")
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+if $msg contains "msgnum:" then
+	action(type="ommail" server="127.0.0.1" port="13525"
+		mailfrom="rsyslog@example.net" mailto="operator@example.net"
+		subject.text="test" template="outfmt" session.idletimeout="1")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 2
+. $srcdir/diag.sh wait-queueempty
+sleep 3
+. $srcdir/diag.sh injectmsg 2 2
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+kill $BGPROCESS
+wait $BGPROCESS
+grep '^body ' rsyslog.out.smtp.log | cut -d' ' -f3 > rsyslog.out.log
+. $srcdir/diag.sh seq-check 0 3
+if [ $(grep -c '^connect ' rsyslog.out.smtp.log) -ne 2 ]; then
+	echo "FAIL: expected a new SMTP session after the idle period"
+	cat rsyslog.out.smtp.log
+	. $srcdir/diag.sh error-exit 1
+fi
+if ! grep -q '^quit 1$' rsyslog.out.smtp.log; then
+	echo "FAIL: idle SMTP session was not closed with QUIT"
+	cat rsyslog.out.smtp.log
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
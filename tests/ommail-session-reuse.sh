@@ -0,0 +1,36 @@
+#!/bin/bash
+# Check that ommail sends several mails over a single SMTP session when
+# session re-use is enabled (the default).
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [ommail-session-reuse.sh]
+. $srcdir/diag.sh init
+./minismtpsrv -t127.0.0.1 -p13525 -frsyslog.out.smtp.log &
+BGPROCESS=$!
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/ommail/.libs/ommail")
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+if $msg contains "msgnum:" then
+	action(type="ommail" server="127.0.0.1" port="13525"
+		mailfrom="rsyslog@example.net" mailto="operator@example.net"
+		subject.text="test" template="outfmt")
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 5
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+kill $BGPROCESS
+wait $BGPROCESS
+grep '^body ' rsyslog.out.smtp.log | cut -d' ' -f3 > rsyslog.out.log
+. $srcdir/diag.sh seq-check 0 4
+if [ $(grep -c '^connect ' rsyslog.out.smtp.log) -ne 1 ]; then
+	echo "FAIL: expected all mails in a single SMTP session"
+	cat rsyslog.out.smtp.log
+	. $srcdir/diag.sh error-exit 1
+fi
+if [ $(grep -c '^mail ' rsyslog.out.smtp.log) -ne 5 ]; then
+	echo "FAIL: expected one mail per message"
+	cat rsyslog.out.smtp.log
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
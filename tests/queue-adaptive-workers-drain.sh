@@ -0,0 +1,50 @@
+#!/bin/bash
+# Check that adaptive worker scaling is also evaluated while a queue drains
+# a backlog without any new input: all messages are injected at once and
+# the backlog then drains for several seconds without further enqueues.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [queue-adaptive-workers-drain.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/omtesting/.libs/omtesting")
+
+ruleset(name="stats") {
+	action(type="omfile" file="./rsyslog.out.stats.log")
+}
+
+module(load="../plugins/impstats/.libs/impstats" interval="1" severity="7"
+	Ruleset="stats" bracketing="on" format="json")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+ruleset(name="slow" queue.type="linkedList" queue.workerthreads="4"
+	queue.adaptiveworkers="on" queue.adaptiveworkers.maxlatency="1") {
+	:omtesting:sleep 0 1000
+	action(type="omfile" file="rsyslog.out.log" template="outfmt")
+}
+if $msg contains "msgnum:" then call slow
+'
+# returns the last reported value of counter $1 of the adaptive queue
+get_ctr() {
+	grep '"name": "slow", "origin": "core.queue"' rsyslog.out.stats.log | \
+		sed -n "s/.*\"$1\": \([0-9]*\).*/\1/p" | tail -1
+}
+. $srcdir/diag.sh startup
+# at about 1ms per message, this is a backlog of several seconds
+. $srcdir/diag.sh injectmsg 0 5000
+. $srcdir/diag.sh wait-queueempty
+. $srcdir/diag.sh wait-for-stats-flush 'rsyslog.out.stats.log'
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 4999
+if [ "$(get_ctr workers.scaledup)" == "" ] || [ "$(get_ctr workers.scaledup)" -eq 0 ]; then
+	echo "FAIL: adaptive queue did not scale up while draining"
+	grep '"name": "slow", "origin": "core.queue"' rsyslog.out.stats.log
+	. $srcdir/diag.sh error-exit 1
+fi
+if [ "$(get_ctr workers.scaleddown)" == "" ] || [ "$(get_ctr workers.scaleddown)" -eq 0 ]; then
+	echo "FAIL: adaptive queue did not scale down while draining"
+	grep '"name": "slow", "origin": "core.queue"' rsyslog.out.stats.log
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
@@ -0,0 +1,71 @@
+#!/bin/bash
+# Check that a queue with adaptive worker scaling processes all messages,
+# adds a worker when messages wait for longer than maxlatency, retires it
+# again once it turns out not to help (the omtesting action is serialized)
+# and is back at a single worker after the backlog has drained.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [queue-adaptive-workers.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/omtesting/.libs/omtesting")
+
+ruleset(name="stats") {
+	action(type="omfile" file="./rsyslog.out.stats.log")
+}
+
+module(load="../plugins/impstats/.libs/impstats" interval="1" severity="7"
+	Ruleset="stats" bracketing="on" format="json")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+ruleset(name="slow" queue.type="linkedList" queue.workerthreads="4"
+	queue.adaptiveworkers="on" queue.adaptiveworkers.maxlatency="1") {
+	:omtesting:sleep 0 1000
+	action(type="omfile" file="rsyslog.out.log" template="outfmt")
+}
+if $msg contains "msgnum:" then call slow
+'
+# returns the last reported value of counter $1 of the adaptive queue
+get_ctr() {
+	grep '"name": "slow", "origin": "core.queue"' rsyslog.out.stats.log | \
+		sed -n "s/.*\"$1\": \([0-9]*\).*/\1/p" | tail -1
+}
+. $srcdir/diag.sh startup
+# at about 1ms per message, this is a backlog of several seconds
+. $srcdir/diag.sh injectmsg 0 4000
+# keep messages coming while the backlog drains
+for i in $(seq 4000 4007); do
+	./msleep 500
+	. $srcdir/diag.sh injectmsg $i 1
+done
+. $srcdir/diag.sh wait-queueempty
+# now there is no backlog, which must not scale up again
+for i in $(seq 4008 4010); do
+	./msleep 1100
+	. $srcdir/diag.sh injectmsg $i 1
+done
+. $srcdir/diag.sh wait-queueempty
+. $srcdir/diag.sh wait-for-stats-flush 'rsyslog.out.stats.log'
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 4010
+if [ "$(get_ctr workers.scaledup)" == "" ] || [ "$(get_ctr workers.scaledup)" -eq 0 ]; then
+	echo "FAIL: adaptive queue did not scale up on latency"
+	grep '"name": "slow", "origin": "core.queue"' rsyslog.out.stats.log
+	. $srcdir/diag.sh error-exit 1
+fi
+if [ "$(get_ctr workers.scaleddown)" == "" ] || [ "$(get_ctr workers.scaleddown)" -eq 0 ]; then
+	echo "FAIL: adaptive queue did not scale down again"
+	grep '"name": "slow", "origin": "core.queue"' rsyslog.out.stats.log
+	. $srcdir/diag.sh error-exit 1
+fi
+if [ "$(get_ctr workers.target)" != "1" ]; then
+	echo "FAIL: workers.target did not go back to 1 after draining"
+	grep '"name": "slow", "origin": "core.queue"' rsyslog.out.stats.log
+	. $srcdir/diag.sh error-exit 1
+fi
+if grep '"name": "main Q"' rsyslog.out.stats.log | grep -q '"workers\.target"'; then
+	echo "FAIL: workers.target reported for non-adaptive main queue"
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
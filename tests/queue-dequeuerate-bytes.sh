@@ -0,0 +1,29 @@
+#!/bin/bash
+# Check that an action queue with a byte based dequeue rate limit delivers
+# all messages and is actually slowed down.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [queue-dequeuerate-bytes.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+if $msg contains "msgnum:" then {
+	action(name="shaped" type="omfile" file="rsyslog.out.log" template="outfmt"
+		queue.type="linkedList" queue.dequeuerate.bytes="50k")
+}
+'
+. $srcdir/diag.sh startup
+START=$(date +%s)
+# each injected message is about 53 bytes, so this is a bit over 200k
+. $srcdir/diag.sh injectmsg 0 4000
+. $srcdir/diag.sh wait-queueempty
+END=$(date +%s)
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 3999
+# the bucket starts full, so about 150k must wait for tokens
+if [ $((END - START)) -lt 2 ]; then
+	echo "FAIL: 4000 messages at 50k bytes/s dequeued in $((END - START))s"
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
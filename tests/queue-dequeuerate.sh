@@ -0,0 +1,45 @@
+#!/bin/bash
+# Check that an action queue with a dequeue rate limit delivers all
+# messages, is actually slowed down and reports the time it spent shaping.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [queue-dequeuerate.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+ruleset(name="stats") {
+	action(type="omfile" file="./rsyslog.out.stats.log")
+}
+
+module(load="../plugins/impstats/.libs/impstats" interval="1" severity="7"
+	Ruleset="stats" bracketing="on" format="json")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+if $msg contains "msgnum:" then {
+	action(name="shaped" type="omfile" file="rsyslog.out.log" template="outfmt"
+		queue.type="linkedList" queue.dequeuerate.messages="1000")
+}
+'
+. $srcdir/diag.sh startup
+START=$(date +%s)
+. $srcdir/diag.sh injectmsg 0 4000
+. $srcdir/diag.sh wait-queueempty
+END=$(date +%s)
+. $srcdir/diag.sh wait-for-stats-flush 'rsyslog.out.stats.log'
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 3999
+# the bucket starts full, so 3000 messages must wait for tokens
+if [ $((END - START)) -lt 2 ]; then
+	echo "FAIL: 4000 messages at 1000/s dequeued in $((END - START))s"
+	. $srcdir/diag.sh error-exit 1
+fi
+if ! grep '"name": "shaped queue"' rsyslog.out.stats.log | grep -q '"shaped\.ms": '; then
+	echo "FAIL: counter shaped.ms missing in stats of shaped queue"
+	grep '"name": "shaped queue"' rsyslog.out.stats.log
+	. $srcdir/diag.sh error-exit 1
+fi
+if grep '"name": "main Q"' rsyslog.out.stats.log | grep -q '"shaped\.ms"'; then
+	echo "FAIL: shaped.ms reported for unshaped main queue"
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
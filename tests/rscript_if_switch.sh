@@ -0,0 +1,63 @@
+#!/bin/bash
+# Check that if/else-if chains and sequences of ifs comparing one property
+# against constants behave the same after the optimizer turned them into a
+# hashed switch: first match wins in chains, all matches run in sequences,
+# and branches of a sequence see property changes done by earlier ones.
+# This file is part of the rsyslog project, released under ASL 2.0
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+template(name="outfmt" type="string" string="%$!n%,%$!c%,%$!q%,%$!q2%\n")
+
+if $msg contains "msgnum:" then {
+	set $!n = field($msg, 58, 2);
+
+	if $!n == "00000000" then
+		set $!c = "zero";
+	else if $!n == ["00000001", "00000002"] then
+		set $!c = "one-two";
+	else if $!n == "00000003" then
+		set $!c = "three";
+	else if $!n == "00000001" then
+		set $!c = "unreachable";
+	else if $!n == "00000004" then
+		set $!c = "four";
+	else
+		set $!c = "other";
+
+	set $.s = $!n;
+	if $.s == "00000005" then set $.s = "00000006";
+	if $.s == "00000006" then set $!q = "six";
+	if $.s == "00000000" then set $!q = "zero";
+	if $.s == "00000000" then set $!q2 = "zero-again";
+	if $.s == "00000007" then set $.s = "00000000";
+
+	action(type="omfile" file="rsyslog.out.log" template="outfmt")
+}
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 8
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+
+EXPECTED='00000000,zero,zero,zero-again
+00000001,one-two,,
+00000002,one-two,,
+00000003,three,,
+00000004,four,,
+00000005,other,six,
+00000006,other,six,
+00000007,other,,'
+
+# FreeBSD's cmp does not support reading from STDIN
+cmp <(echo "$EXPECTED") <(sort rsyslog.out.log)
+
+if [[ $? -ne 0 ]]; then
+  printf "Invalid switch result detected!\n"
+  printf "Expected:\n$EXPECTED\n"
+  printf "Got:\n"
+  sort rsyslog.out.log
+  . $srcdir/diag.sh error-exit 1
+fi;
+
+. $srcdir/diag.sh exit
@@ -0,0 +1,31 @@
+#!/bin/bash
+# checks call_indirect with many messages alternating between rulesets,
+# including a ruleset whose name differs in case only.
+# This file is part of the rsyslog project, released under ASL 2.0
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+template(name="outfmt" type="list") {
+	property(name="msg" field.delimiter="58" field.number="2")
+	constant(value="\n")
+}
+
+ruleset(name="writer") {
+	action(type="omfile" file="./rsyslog.out.log" template="outfmt")
+}
+
+ruleset(name="tenant_0") { call writer }
+ruleset(name="tenant_1") { call writer }
+ruleset(name="TENANT_2") { call writer }
+
+if $msg contains "msgnum" then {
+	set $.n = field($msg, 58, 2);
+	call_indirect "tenant_" & cnum($.n) % 3;
+}
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg  0 10000
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown 
+. $srcdir/diag.sh seq-check  0 9999
+. $srcdir/diag.sh exit
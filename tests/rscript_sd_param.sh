@@ -0,0 +1,51 @@
+#!/bin/bash
+# test sd_param() function, which extracts a single SD-PARAM
+# without building the full structured data JSON tree
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [rscript_sd_param.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/imtcp/.libs/imtcp")
+input(type="imtcp" port="13514")
+template(name="outfmt" type="string" string="%$.msgnum%\n")
+template(name="sdfmt" type="string" string="%msgid%:%$.a%|%$.b%|%$.nosdid%|%$.noparam%\n")
+
+if $msg contains "msgnum" then {
+	set $.msgnum = sd_param("tcpflood@32473", "msgnum");
+	action(type="omfile" file="rsyslog.out.log" template="outfmt")
+} else if $app-name == "sdtest" then {
+	set $.a = sd_param("ex@1", "a");
+	set $.b = sd_param("ex@2", "b");
+	set $.nosdid = sd_param("nosuch@1", "a");
+	set $.noparam = sd_param("ex@1", "nosuch");
+	action(type="omfile" file="rsyslog2.out.log" template="sdfmt")
+}
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh tcpflood -m100 -y
+cat > rsyslog.input <<'MSGS'
+<165>1 2003-10-11T22:14:15.003Z host sdtest - M1 [ex@1 a="1"][ex@2 b="2"] multiple elements
+<165>1 2003-10-11T22:14:15.003Z host sdtest - M2 [ex@1 a="q\"x\]y\\z"][ex@2 x="0" b="last"] escapes
+<165>1 2003-10-11T22:14:15.003Z host sdtest - M3 - nilvalue
+<165>1 2003-10-11T22:14:15.003Z host sdtest - M4 [EX@1 A="case"] case-insensitive names
+MSGS
+. $srcdir/diag.sh tcpflood -B -I rsyslog.input
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 99
+cat > rsyslog.expected <<'EXPECTED'
+M1:1|2||
+M2:q"x]y\z|last||
+M3:|||
+M4:case|||
+EXPECTED
+if ! cmp rsyslog.expected rsyslog2.out.log; then
+	echo "FAIL: unexpected sd_param() results, expected:"
+	cat rsyslog.expected
+	echo "got:"
+	cat rsyslog2.out.log
+	. $srcdir/diag.sh error-exit 1
+fi
+rm -f rsyslog.expected
+. $srcdir/diag.sh exit
@@ -0,0 +1,27 @@
+#!/bin/bash
+# check that a ruleset with parse="off" passes the raw message through
+# without running any parser on it
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [ruleset-parse-off.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+module(load="../plugins/imtcp/.libs/imtcp")
+input(type="imtcp" port="13514" ruleset="archive")
+
+template(name="outfmt" type="string" string="%rawmsg%|%msg%|%pri%\n")
+ruleset(name="archive" parse="off") {
+	action(type="omfile" file="rsyslog.out.log" template="outfmt")
+}
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh tcpflood -m1 -M "\"<189>Mar  6 16:57:54 host tag: this is not parsed\""
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+echo '<189>Mar  6 16:57:54 host tag: this is not parsed|<189>Mar  6 16:57:54 host tag: this is not parsed|13' | cmp - rsyslog.out.log
+if [ ! $? -eq 0 ]; then
+  echo "invalid response generated, rsyslog.out.log is:"
+  cat rsyslog.out.log
+  . $srcdir/diag.sh error-exit  1
+fi;
+. $srcdir/diag.sh exit
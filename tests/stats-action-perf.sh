@@ -0,0 +1,43 @@
+#!/bin/bash
+# Check that action.perfStats adds the performance counters to the action
+# stats, and only to actions where it is enabled.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [stats-action-perf.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+ruleset(name="stats") {
+	action(type="omfile" file="./rsyslog.out.stats.log")
+}
+
+module(load="../plugins/impstats/.libs/impstats" interval="1" severity="7"
+	Ruleset="stats" bracketing="on" format="json")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+if $msg contains "msgnum:" then {
+	action(name="perfaction" type="omfile" file="rsyslog.out.log" template="outfmt"
+		action.perfStats="on")
+	action(name="plainaction" type="omfile" file="rsyslog2.out.log" template="outfmt")
+}
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 1000
+. $srcdir/diag.sh wait-queueempty
+. $srcdir/diag.sh wait-for-stats-flush 'rsyslog.out.stats.log'
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 999
+. $srcdir/diag.sh custom-content-check '"name": "perfaction", "origin": "core.action", "processed": 1000' 'rsyslog.out.stats.log'
+for ctr in perf.render.us perf.exec.us perf.retry.us perf.batchsize.le1 perf.batchsize.gt1024; do
+	if ! grep '"name": "perfaction"' rsyslog.out.stats.log | grep -q "\"$ctr\": "; then
+		echo "FAIL: counter $ctr missing in stats of perfaction"
+		grep '"name": "perfaction"' rsyslog.out.stats.log
+		. $srcdir/diag.sh error-exit 1
+	fi
+done
+if grep '"name": "plainaction"' rsyslog.out.stats.log | grep -q '"perf\.'; then
+	echo "FAIL: perf counters reported for action without action.perfStats"
+	grep '"name": "plainaction"' rsyslog.out.stats.log
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
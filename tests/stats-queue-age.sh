@@ -0,0 +1,45 @@
+#!/bin/bash
+# Check that queues report the oldest message age and drain estimate, and
+# that disk queues additionally report their on-disk backlog.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [stats-queue-age.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+ruleset(name="stats") {
+	action(type="omfile" file="./rsyslog.out.stats.log")
+}
+
+module(load="../plugins/impstats/.libs/impstats" interval="1" severity="7"
+	Ruleset="stats" bracketing="on" format="json")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+if $msg contains "msgnum:" then {
+	action(name="diskaction" type="omfile" file="rsyslog.out.log" template="outfmt"
+		queue.type="disk" queue.filename="stats-queue-age")
+}
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 1000
+. $srcdir/diag.sh wait-queueempty
+. $srcdir/diag.sh wait-for-stats-flush 'rsyslog.out.stats.log'
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 999
+for ctr in oldestmsg.age drain.estimate; do
+	if ! grep '"name": "main Q"' rsyslog.out.stats.log | grep -q "\"$ctr\": "; then
+		echo "FAIL: counter $ctr missing in stats of main queue"
+		grep '"name": "main Q"' rsyslog.out.stats.log
+		. $srcdir/diag.sh error-exit 1
+	fi
+done
+if grep '"name": "main Q"' rsyslog.out.stats.log | grep -q '"disk\.size"'; then
+	echo "FAIL: disk.size reported for in-memory main queue"
+	. $srcdir/diag.sh error-exit 1
+fi
+if ! grep '"name": "diskaction queue"' rsyslog.out.stats.log | grep -q '"disk\.size": '; then
+	echo "FAIL: disk.size missing in stats of disk queue"
+	grep '"name": "diskaction queue"' rsyslog.out.stats.log
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
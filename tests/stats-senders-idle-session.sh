@@ -0,0 +1,49 @@
+#!/bin/bash
+# Check that sender stats include messages of a burst received on a
+# connection that stays open (and idle) afterwards. Sessions accumulate
+# sender counts, so these must be swept up when stats are emitted.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [stats-senders-idle-session.sh]
+. $srcdir/diag.sh init
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+global(senders.keepTrack="on")
+module(load="../plugins/imtcp/.libs/imtcp")
+input(type="imtcp" port="13514")
+
+ruleset(name="stats") {
+	action(type="omfile" file="./rsyslog.out.stats.log")
+}
+
+module(load="../plugins/impstats/.libs/impstats" interval="1" severity="7"
+	Ruleset="stats" bracketing="on" format="json")
+
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+if $msg contains "msgnum:" then
+	action(type="omfile" file="rsyslog.out.log" template="outfmt")
+'
+. $srcdir/diag.sh startup
+exec 3<>/dev/tcp/127.0.0.1/13514
+# first message on its own, so that the sender is registered and the rest
+# of the burst is (very likely) received within the same second
+printf '<167>Mar  1 01:00:00 192.0.2.8 tag msgnum:00000000:\n' >&3
+./msleep 100
+for i in $(seq 1 99); do
+	printf '<167>Mar  1 01:00:00 192.0.2.8 tag msgnum:%8.8d:\n' $i
+done >&3
+. $srcdir/diag.sh wait-queueempty
+# the connection is still open and idle, wait for two stats pushes so
+# that we see a complete one
+. $srcdir/diag.sh wait-for-stats-flush 'rsyslog.out.stats.log'
+. $srcdir/diag.sh wait-for-stats-flush 'rsyslog.out.stats.log'
+NMSGS=$(grep '"_sender_stat"' rsyslog.out.stats.log | tail -1 | sed 's/.*"messages":"\([0-9]*\)".*/\1/')
+exec 3>&-
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+. $srcdir/diag.sh seq-check 0 99
+if [ "$NMSGS" != "100" ]; then
+	echo "FAIL: sender stats report '$NMSGS' messages, expected 100"
+	grep '"_sender_stat"' rsyslog.out.stats.log
+	. $srcdir/diag.sh error-exit 1
+fi
+. $srcdir/diag.sh exit
@@ -0,0 +1,37 @@
+#!/bin/bash
+# checks that no message is lost if action.resumeAsync is given for omfwd.
+# omfwd is transactional, so the setting is refused and regular resume
+# retries are used. The receiver comes up only after a couple of seconds,
+# so the action is suspended at startup.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo [tcp_forwarding_resumeasync.sh]
+messages=10000 # how many messages to inject?
+. $srcdir/diag.sh init
+
+# we start a small receiver process, which begins to listen after 4 seconds
+./minitcpsrv -t127.0.0.1 -p13514 -frsyslog.out.log -s4 &
+BGPROCESS=$!
+echo background minitcpsrvr process id is $BGPROCESS
+
+. $srcdir/diag.sh generate-conf
+. $srcdir/diag.sh add-conf '
+template(name="outfmt" type="string" string="%msg:F,58:2%\n")
+:msg, contains, "msgnum:" {
+	action(type="omfwd"
+	       target="127.0.0.1" port="13514" protocol="TCP"
+	       queue.type="LinkedList"
+	       action.resumeAsync="on"
+	       action.resumeRetryCount="-1"
+	       action.resumeInterval="1"
+	       template="outfmt")
+}
+'
+. $srcdir/diag.sh startup
+. $srcdir/diag.sh injectmsg 0 $messages
+. $srcdir/diag.sh shutdown-when-empty
+. $srcdir/diag.sh wait-shutdown
+echo wating on background process
+wait $BGPROCESS
+
+. $srcdir/diag.sh seq-check 0 $(($messages-1))
+. $srcdir/diag.sh exit
@@ -171,6 +171,10 @@ typedef struct _instanceData {
 	dynaFileCacheEntry **dynCache;
 	off_t	iSizeLimit;		/* file size limit, 0 = no limit */
 	uchar	*pszSizeLimitCmd;	/* command to carry out when size limit is reached */
+	off_t	iRotateSize;		/* built-in rotation: rotate at this size, 0 = never */
+	int	iRotateInterval;	/* built-in rotation: rotate on this time boundary (secs), 0 = never */
+	int	iRotateMaxFiles;	/* built-in rotation: number of rotated files to keep, 0 = all */
+	sbool	bRotateCompress;	/* built-in rotation: gzip rotated files in background? */
 	int 	iZipLevel;		/* zip mode to use for this selector */
 	int	iIOBufSize;		/* size of associated io buffer */
 	int	iFlushInterval;		/* how fast flush buffer on inactivity? */
@@ -178,6 +182,7 @@ typedef struct _instanceData {
 	sbool	bFlushOnTXEnd;		/* flush write buffers when transaction has ended? */
 	sbool	bUseAsyncWriter;	/* use async stream writer? */
 	sbool	bVeryRobustZip;
+	sbool	bGroupByFile;		/* dynafiles: write a batch grouped by target file? */
 	statsobj_t *stats;		/* dynafile, primarily cache stats */
 	STATSCOUNTER_DEF(ctrRequests, mutCtrRequests);
 	STATSCOUNTER_DEF(ctrLevel0, mutCtrLevel0);
@@ -189,8 +194,16 @@ typedef struct _instanceData {
 } instanceData;
 
 
+/* entry for sorting a batch by target file name (see writeGroupedByFile()) */
+typedef struct fileGrpEntry_s {
+	const uchar *pszFName;
+	unsigned iMsg;
+} fileGrpEntry_t;
+
 typedef struct wrkrInstanceData {
 	instanceData *pData;
+	fileGrpEntry_t *grpEntries;	/* scratch space for grouping a batch by file */
+	unsigned maxGrpEntries;
 } wrkrInstanceData_t;
 
 
@@ -279,6 +292,11 @@ static struct cnfparamdescr actpdescr[] = {
 	{ "sig.provider", eCmdHdlrGetWord, 0 },
 	{ "cry.provider", eCmdHdlrGetWord, 0 },
 	{ "closetimeout", eCmdHdlrPositiveInt, 0 },
+	{ "rotation.sizelimit", eCmdHdlrSize, 0 },
+	{ "rotation.interval", eCmdHdlrPositiveInt, 0 },
+	{ "rotation.maxfiles", eCmdHdlrNonNegInt, 0 },
+	{ "rotation.compress", eCmdHdlrBinary, 0 },
+	{ "dynafile.groupbyfile", eCmdHdlrBinary, 0 },
 	{ "template", eCmdHdlrGetWord, 0 }
 };
 static struct cnfparamblk actpblk =
@@ -328,6 +346,7 @@ CODESTARTdbgPrintInstInfo
 	dbgprintf("\ttemplate='%s'\n", pData->fname);
 	dbgprintf("\tuse async writer=%d\n", pData->bUseAsyncWriter);
 	dbgprintf("\tflush on TX end=%d\n", pData->bFlushOnTXEnd);
+	dbgprintf("\tgroup batch by file=%d\n", pData->bGroupByFile);
 	dbgprintf("\tflush interval=%d\n", pData->iFlushInterval);
 	dbgprintf("\tfile cache size=%d\n", pData->iDynaFileCacheSize);
 	dbgprintf("\tcreate directories: %s\n", pData->bCreateDirs ? "on" : "off");
@@ -337,6 +356,9 @@ CODESTARTdbgPrintInstInfo
 	dbgprintf("\tdir create mode 0%3.3o, file create mode 0%3.3o\n",
 		  pData->fDirCreateMode, pData->fCreateMode);
 	dbgprintf("\tfail if owner/group can not be set: %s\n", pData->bFailOnChown ? "yes" : "no");
+	dbgprintf("\trotation: size %lld, interval %d, max files %d, compress %d\n",
+		  (long long) pData->iRotateSize, pData->iRotateInterval,
+		  pData->iRotateMaxFiles, pData->bRotateCompress);
 ENDdbgPrintInstInfo
 
 
@@ -634,6 +656,10 @@ prepareFile(instanceData *__restrict__ const pData, const uchar *__restrict__ co
 	CHKiRet(strm.SetbSync(pData->pStrm, pData->bSyncFile));
 	CHKiRet(strm.SetsType(pData->pStrm, STREAMTYPE_FILE_SINGLE));
 	CHKiRet(strm.SetiSizeLimit(pData->pStrm, pData->iSizeLimit));
+	CHKiRet(strm.SetiRotateSize(pData->pStrm, pData->iRotateSize));
+	CHKiRet(strm.SetiRotateInterval(pData->pStrm, pData->iRotateInterval));
+	CHKiRet(strm.SetiRotateMaxFiles(pData->pStrm, pData->iRotateMaxFiles));
+	CHKiRet(strm.SetbRotateCompress(pData->pStrm, pData->bRotateCompress));
 	if(pData->useCryprov) {
 		CHKiRet(strm.Setcryprov(pData->pStrm, &pData->cryprov));
 		CHKiRet(strm.SetcryprovData(pData->pStrm, pData->cryprovData));
@@ -845,6 +871,73 @@ finalize_it:
 }
 
 
+static int
+cmpFileGrpEntry(const void *p1, const void *p2)
+{
+	const fileGrpEntry_t *const e1 = (const fileGrpEntry_t*) p1;
+	const fileGrpEntry_t *const e2 = (const fileGrpEntry_t*) p2;
+	const int r = ustrcmp(e1->pszFName, e2->pszFName);
+
+	if(r != 0)
+		return r;
+	/* keep the original order of messages for the same file */
+	return (e1->iMsg < e2->iMsg) ? -1 : (e1->iMsg > e2->iMsg);
+}
+
+
+/* write a batch to dynafiles, grouped by target file. The batch is sorted
+ * by file name (keeping message order within each file), so each file is
+ * looked up in the cache only once per batch and its messages are appended
+ * back-to-back to the same stream buffer, instead of interleaving small
+ * appends across many files. If flushOnTXEnd is set, each file written
+ * to is flushed once after its group.
+ * As with writeFile(), errors for individual files are not propagated,
+ * except for flush errors.
+ */
+static rsRetVal
+writeGroupedByFile(wrkrInstanceData_t *__restrict__ const pWrkrData,
+	const actWrkrIParams_t *__restrict__ const pParams,
+	const unsigned nParams)
+{
+	instanceData *__restrict__ const pData = pWrkrData->pData;
+	fileGrpEntry_t *newEntries;
+	unsigned i, j;
+	rsRetVal localRet;
+	DEFiRet;
+
+	if(nParams > pWrkrData->maxGrpEntries) {
+		CHKmalloc(newEntries = realloc(pWrkrData->grpEntries, nParams * sizeof(fileGrpEntry_t)));
+		pWrkrData->grpEntries = newEntries;
+		pWrkrData->maxGrpEntries = nParams;
+	}
+	for(i = 0 ; i < nParams ; ++i) {
+		pWrkrData->grpEntries[i].pszFName = actParam(pParams, pData->iNumTpls, i, 1).param;
+		pWrkrData->grpEntries[i].iMsg = i;
+	}
+	qsort(pWrkrData->grpEntries, nParams, sizeof(fileGrpEntry_t), cmpFileGrpEntry);
+
+	for(i = 0 ; i < nParams ; i = j) {
+		const uchar *const pszFName = pWrkrData->grpEntries[i].pszFName;
+		STATSCOUNTER_INC(pData->ctrRequests, pData->mutCtrRequests);
+		DBGPRINTF("omfile: file to log to: %s\n", pszFName);
+		localRet = prepareDynFile(pData, pszFName);
+		for(j = i ; j < nParams && !ustrcmp(pWrkrData->grpEntries[j].pszFName, pszFName) ; ++j) {
+			if(localRet == RS_RET_OK) {
+				const unsigned iMsg = pWrkrData->grpEntries[j].iMsg;
+				doWrite(pData, actParam(pParams, pData->iNumTpls, iMsg, 0).param,
+					actParam(pParams, pData->iNumTpls, iMsg, 0).lenStr);
+			}
+		}
+		if(localRet == RS_RET_OK && pData->bFlushOnTXEnd && pData->pStrm != NULL) {
+			CHKiRet(strm.Flush(pData->pStrm));
+		}
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+
 BEGINbeginCnfLoad
 CODESTARTbeginCnfLoad
 	loadModConf = pModConf;
@@ -1034,6 +1127,7 @@ ENDfreeInstance
 
 BEGINfreeWrkrInstance
 CODESTARTfreeWrkrInstance
+	free(pWrkrData->grpEntries);
 ENDfreeWrkrInstance
 
 
@@ -1053,6 +1147,11 @@ BEGINcommitTransaction
 CODESTARTcommitTransaction
 	pthread_mutex_lock(&pData->mutWrite);
 
+	if(pData->bDynamicName && pData->bGroupByFile && nParams > 1) {
+		CHKiRet(writeGroupedByFile(pWrkrData, pParams, nParams));
+		FINALIZE; /* files have already been flushed, if requested */
+	}
+
 	for(i = 0 ; i < nParams ; ++i) {
 		writeFile(pData, pParams, i);
 	}
@@ -1104,6 +1203,11 @@ setInstParamDefaults(instanceData *__restrict__ const pData)
 	pData->useSigprov = 0;
 	pData->useCryprov = 0;
 	pData->iCloseTimeout = -1;
+	pData->iRotateSize = 0;
+	pData->iRotateInterval = 0;
+	pData->iRotateMaxFiles = 0;
+	pData->bRotateCompress = 0;
+	pData->bGroupByFile = 0;
 }
 
 
@@ -1270,6 +1374,8 @@ CODESTARTnewActInst
 			pData->bUseAsyncWriter = pvals[i].val.d.n;
 		} else if(!strcmp(actpblk.descr[i].name, "flushontxend")) {
 			pData->bFlushOnTXEnd = pvals[i].val.d.n;
+		} else if(!strcmp(actpblk.descr[i].name, "dynafile.groupbyfile")) {
+			pData->bGroupByFile = pvals[i].val.d.n;
 		} else if(!strcmp(actpblk.descr[i].name, "iobuffersize")) {
 			pData->iIOBufSize = (int) pvals[i].val.d.n;
 		} else if(!strcmp(actpblk.descr[i].name, "dirowner")) {
@@ -1317,6 +1423,14 @@ CODESTARTnewActInst
 			pData->cryprovName = (uchar*)es_str2cstr(pvals[i].val.d.estr, NULL);
 		} else if(!strcmp(actpblk.descr[i].name, "closetimeout")) {
 			pData->iCloseTimeout = (int) pvals[i].val.d.n;
+		} else if(!strcmp(actpblk.descr[i].name, "rotation.sizelimit")) {
+			pData->iRotateSize = (off_t) pvals[i].val.d.n;
+		} else if(!strcmp(actpblk.descr[i].name, "rotation.interval")) {
+			pData->iRotateInterval = (int) pvals[i].val.d.n;
+		} else if(!strcmp(actpblk.descr[i].name, "rotation.maxfiles")) {
+			pData->iRotateMaxFiles = (int) pvals[i].val.d.n;
+		} else if(!strcmp(actpblk.descr[i].name, "rotation.compress")) {
+			pData->bRotateCompress = (sbool) pvals[i].val.d.n;
 		} else {
 			dbgprintf("omfile: program error, non-handled "
 			  "param '%s'\n", actpblk.descr[i].name);
@@ -1337,6 +1451,15 @@ CODESTARTnewActInst
 		CHKiRet(initCryprov(pData, lst));
 	}
 
+	if((pData->iRotateSize != 0 || pData->iRotateInterval != 0)
+	   && (pData->useSigprov || pData->useCryprov)) {
+		parser_errmsg("omfile: built-in rotation can not be used together with "
+			"signature or crypto providers - rotation disabled for file '%s'",
+			pData->fname);
+		pData->iRotateSize = 0;
+		pData->iRotateInterval = 0;
+	}
+
 	tplToUse = ustrdup((pData->tplName == NULL) ? getDfltTpl() : pData->tplName);
 	CHKiRet(OMSRsetEntry(*ppOMSR, 0, tplToUse, OMSR_NO_RQD_TPL_OPTS));
 	pData->iNumTpls = 1;